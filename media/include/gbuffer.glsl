@@ -0,0 +1,24 @@
+// Format:
+// | R | G | B | A |
+// | Diffuse   |
+// | Position  |
+// | Normal    |
+uniform sampler2D gb0;
+uniform sampler2D gb1;
+uniform sampler2D gb2;
+
+struct GBufferSample
+{
+    vec3 diffuse;
+    vec3 position;
+    vec3 normal;
+};
+
+GBufferSample readGBuffer(vec2 texcoord)
+{
+    GBufferSample s;
+    s.diffuse = texture(gb0, texcoord).rgb;
+    s.position = texture(gb1, texcoord).rgb;
+    s.normal = texture(gb2, texcoord).rgb;
+    return s;
+}
@@ -0,0 +1,21 @@
+// Uniform blocks shared by every program. These must match the std140 structs on the C++ side
+
+layout (std140) uniform PerFrame
+{
+    vec2 screenSize;
+    float time;
+};
+
+layout (std140) uniform PerView
+{
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    vec3 cameraPosition;
+};
+
+layout (std140) uniform PerObject
+{
+    mat4 world;
+    mat4 worldViewProj;
+};
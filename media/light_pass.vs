@@ -1,10 +1,19 @@
 #version 330 core
 
-uniform mat4 worldViewProj;
+#include "include/uniforms.glsl"
 
 layout (location = 0) in vec3 position;
 
+// Per-instance
+layout (location = 1) in vec4 lightPosRange;
+layout (location = 2) in vec3 lightAttenuation;
+
+flat out vec3 oLightPos;
+flat out vec3 oLightAttenuation;
+
 void main()
 {
-    gl_Position = worldViewProj * vec4(position, 1.0);
+    gl_Position = viewProj * vec4(lightPosRange.xyz + position * lightPosRange.w, 1.0);
+    oLightPos = lightPosRange.xyz;
+    oLightAttenuation = lightAttenuation;
 }
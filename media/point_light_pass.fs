@@ -2,16 +2,11 @@
 
 out vec4 oColour;
 
-uniform sampler2D gb0;
-uniform sampler2D gb1;
-uniform sampler2D gb2;
-uniform vec2 screenSize;
+#include "include/gbuffer.glsl"
+#include "include/uniforms.glsl"
 
-uniform vec3 lightPos;
-
-uniform float constant;
-uniform float linear;
-uniform float exponent;
+flat in vec3 oLightPos;
+flat in vec3 oLightAttenuation; // Constant, linear, exponent
 
 vec2 calcScreenCoord()
 {
@@ -22,15 +17,16 @@ void main()
 {
     vec2 screenCoord = calcScreenCoord();
 
-    vec3 colour = texture(gb0, screenCoord).rgb;
-    vec3 position = texture(gb1, screenCoord).rgb;
-    vec3 normal = texture(gb2, screenCoord).rgb;
+    GBufferSample gbuffer = readGBuffer(screenCoord);
+    vec3 colour = gbuffer.diffuse;
+    vec3 position = gbuffer.position;
+    vec3 normal = gbuffer.normal;
 
     // Calculate shading
-    vec3 lightDir = lightPos - position;
+    vec3 lightDir = oLightPos - position;
     float diffuse = max(dot(normal, normalize(lightDir)), 0.0);
     float distance = length(lightDir);
-    float attenuation = constant + linear + exponent;
+    float attenuation = oLightAttenuation.x + oLightAttenuation.y + oLightAttenuation.z;
     vec3 result = colour * diffuse / attenuation;
 
     oColour = vec4(result, 1.0);
@@ -4,16 +4,13 @@ in vec2 oTexcoord;
 
 out vec4 colour;
 
-uniform sampler2D gb0;
-uniform sampler2D gb1;
-uniform sampler2D gb2;
+#include "include/gbuffer.glsl"
 
 void main()
 {
-    vec3 diffuse = texture(gb0, oTexcoord).rgb;
-    vec3 normal = texture(gb2, oTexcoord).rgb;
+    GBufferSample gbuffer = readGBuffer(oTexcoord);
 
     // Perform directional lighting
-    float lighting = clamp(dot(normal, vec3(1.0, 0.0, 0.0)), 0.0, 1.0);
-    colour = vec4(diffuse * lighting, 1.0);
+    float lighting = clamp(dot(gbuffer.normal, vec3(1.0, 0.0, 0.0)), 0.0, 1.0);
+    colour = vec4(gbuffer.diffuse * lighting, 1.0);
 }
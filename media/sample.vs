@@ -1,20 +1,47 @@
 #version 330 core
 
-uniform mat4 worldViewProj;
-uniform mat4 world;
+#include "include/uniforms.glsl"
 
+#ifdef QUANTISED_VERTICES
+// Bounding box used to dequantise positions
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+layout (location = 0) in vec3 position; // unorm16, relative to the bounding box
+layout (location = 1) in vec2 normal;   // snorm16, octahedral encoded
+layout (location = 2) in vec2 texcoord; // half float
+#else
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 texcoord;
+#endif
 
 out vec3 oWorldPos;
 out vec3 oNormal;
 out vec2 oTexcoord;
 
+#ifdef QUANTISED_VERTICES
+vec3 decodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+#endif
+
 void main()
 {
-    gl_Position = worldViewProj * vec4(position, 1.0);
-    oWorldPos = (world * vec4(position, 1.0)).xyz;
-    oNormal = (world * vec4(normal, 0.0)).xyz;
+#ifdef QUANTISED_VERTICES
+    vec3 localPos = positionOffset + position * positionScale;
+    vec3 localNormal = decodeOctahedral(normal);
+#else
+    vec3 localPos = position;
+    vec3 localNormal = normal;
+#endif
+
+    gl_Position = worldViewProj * vec4(localPos, 1.0);
+    oWorldPos = (world * vec4(localPos, 1.0)).xyz;
+    oNormal = (world * vec4(localNormal, 0.0)).xyz;
     oTexcoord = texcoord;
 }
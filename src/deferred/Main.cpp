@@ -3,26 +3,82 @@
  * Copyright (c) David Avedissian 2014-2015
  */
 #include <ctime>
+#include <stb_image.h>
 
 #include "framework/Common.h"
 #include "framework/Application.h"
+#include "framework/AsyncTextureLoader.h"
 #include "framework/Framebuffer.h"
+#include "framework/GLState.h"
 #include "framework/Shader.h"
 #include "framework/Texture.h"
+#include "framework/LightVolumeCache.h"
 #include "framework/Mesh.h"
+#include "framework/MeshQuantiser.h"
+#include "framework/MipGenerator.h"
+#include "framework/ParameterBlock.h"
+#include "framework/ProgramBinaryCache.h"
+#include "framework/ResourceRegistry.h"
+#include "framework/ShaderBatch.h"
+#include "framework/ShaderLibrary.h"
+#include "framework/StreamBuffer.h"
+#include "framework/TextureCompressor.h"
+#include "framework/ThreadPool.h"
+#include "framework/UniformBuffer.h"
 
 #define WIDTH 1024
 #define HEIGHT 768
 
 Mesh* generateFullscreenQuad();
-Mesh* generateBox(float halfSize);
-Mesh* generateLightSphere(float radius, int rings, int segments);
+vector<GLfloat> generateBoxVertices(float halfSize);
 
 float timeSinceEpoch()
 {
 	return (float)clock() / (float)CLOCKS_PER_SEC;
 }
 
+// std140 uniform blocks, matching the declarations in the shaders
+struct PerFrameBlock
+{
+    glm::vec2 screenSize;
+    float time;
+    float padding;
+};
+STD140_OFFSET(PerFrameBlock, screenSize, 0);
+STD140_OFFSET(PerFrameBlock, time, 8);
+STD140_SIZE(PerFrameBlock, 16);
+
+struct PerViewBlock
+{
+    glm::mat4 view;
+    glm::mat4 proj;
+    glm::mat4 viewProj;
+    glm::vec3 cameraPosition;
+    float padding;
+};
+STD140_OFFSET(PerViewBlock, view, 0);
+STD140_OFFSET(PerViewBlock, proj, 64);
+STD140_OFFSET(PerViewBlock, viewProj, 128);
+STD140_OFFSET(PerViewBlock, cameraPosition, 192);
+STD140_SIZE(PerViewBlock, 208);
+
+struct PerObjectBlock
+{
+    glm::mat4 world;
+    glm::mat4 worldViewProj;
+};
+STD140_OFFSET(PerObjectBlock, world, 0);
+STD140_OFFSET(PerObjectBlock, worldViewProj, 64);
+STD140_SIZE(PerObjectBlock, 128);
+
+// Per-instance attributes of a point light volume
+struct PointLightInstance
+{
+    glm::vec3 position;
+    float range;
+    glm::vec3 attenuation;
+};
+
 class PointLight
 {
 public:
@@ -31,82 +87,53 @@ public:
           mAtten1(a1),
           mAtten2(a2)
     {
-        mShader = new Shader("media/light_pass.vs", "media/point_light_pass.fs");
-        mShader->bind();
-        mShader->setUniform("screenSize", glm::vec2(WIDTH, HEIGHT));
-        mShader->setUniform("gb0", 0);
-        mShader->setUniform("gb1", 1);
-        mShader->setUniform("gb2", 2);
-        mShader->setUniform("constant", a0);
-        mShader->setUniform("linear", a1);
-        mShader->setUniform("exponent", a2);
-
         // Calculate range
         // Solve 'a2 * d^2 + a1 * d + a0 = 256' for d
         // 256 is the number of distinct light levels in an 8 bit component (2^8)
-        float range;
         if (a2 == 0.0f)
         {
             if (a1 == 0.0f)
             {
                 // For constant attenuation point lights, set the range to infinity
-                range = 100000000000000000.0f;
+                mRange = 100000000000000000.0f;
             }
             else
             {
-                range = (256.0f - a0) / a1;
+                mRange = (256.0f - a0) / a1;
             }
         }
         else
         {
-            range = (-a1 + sqrtf(a1 * a1 - 4.0f * a2 * (a0 - 256.0f))) / (2.0f * a2);
+            mRange = (-a1 + sqrtf(a1 * a1 - 4.0f * a2 * (a0 - 256.0f))) / (2.0f * a2);
         }
-
-		mVertices = generateLightSphere(range, 8, 8);
-    }
-
-    ~PointLight()
-    {
-        delete mShader;
-        delete mVertices;
     }
 
     void setPosition(const glm::vec3& position)
     {
         mPosition = position;
-        mWorld = glm::translate(glm::mat4(), position);
     }
 
-    void draw(const glm::mat4& view, const glm::mat4& proj)
+    PointLightInstance getInstance() const
     {
-        glm::mat4 wvp = proj * view * mWorld;
-
-        // Bind shader
-        mShader->bind();
-        mShader->setUniform("worldViewProj", wvp);
-        mShader->setUniform("lightPos", mPosition);
-
-        // Draw light
-        mVertices->bind();
-        mVertices->draw();
+        PointLightInstance instance = {mPosition, mRange, glm::vec3(mAtten0, mAtten1, mAtten2)};
+        return instance;
     }
 
 private:
-    Mesh* mVertices;
-    Shader* mShader;
-
     float mAtten0;
     float mAtten1;
     float mAtten2;
+    float mRange;
 
     glm::vec3 mPosition;
-    glm::mat4 mWorld;
 
 };
 
 class DeferredShadingApp : public Application
 {
 private:
+    ShaderLibrary* mShaders;
+
     // Post process
     Framebuffer* mGBuffer;
     Mesh* mQuad;
@@ -114,35 +141,89 @@ private:
 
     // Mesh
     Mesh* mMesh;
+    AsyncTextureLoader* mTextureLoader;
     Texture* mTexture;
     Shader* mShader;
+    ParameterBlock* mMaterial;
 
     // Light
     vector<PointLight*> lights;
+    vector<PointLightInstance> mLightInstances;
+    LightVolumeCache* mLightVolumes;
+    Mesh* mLightVolume;
+    Shader* mLightShader;
+
+    // Uniform blocks
+    UniformBuffer* mPerFrameUniforms;
+    UniformBuffer* mPerViewUniforms;
+    StreamBuffer* mPerObjectUniforms;
+
+    // Frame timing for the light count benchmark
+    uint64 mTimingStart;
+    uint mTimingFrames;
 
 public:
     virtual void startup() override
     {
+        ProgramBinaryCache::setDirectory("shadercache");
+
+        // Submit every program up front, so that they compile while the rest of the scene loads
+        mShaders = new ShaderLibrary();
+        ShaderBatch batch;
+        mPostShader = mShaders->get("media/quad.vs", "media/post.fs", &batch);
+        mShader = mShaders->get("media/sample.vs", "media/sample.fs",
+                                ShaderDefines().set("QUANTISED_VERTICES"), &batch);
+        mLightShader = mShaders->get("media/light_pass.vs", "media/point_light_pass.fs", &batch);
+        batch.submit(ThreadPool::getDefault());
+
         mCameraMan.setPosition(glm::vec3(0.0f, 1.0f, 2.5f));
         mProjMatrix = glm::perspective(45.0f, (float)WIDTH / HEIGHT, 0.1f, 10000.0f);
 
+        // Per-frame and per-view blocks are bound once, and each object gets a range of a
+        // streamed buffer
+        mPerFrameUniforms = new UniformBuffer(sizeof(PerFrameBlock));
+        mPerViewUniforms = new UniformBuffer(sizeof(PerViewBlock));
+        mPerObjectUniforms = new StreamBuffer(GL_UNIFORM_BUFFER, 64 * 1024);
+
 		// Set up the g-buffer
 		mGBuffer = new Framebuffer(mWindowWidth, mWindowHeight, 3);
 
         // Set up post processing
 		mQuad = generateFullscreenQuad();
-        mPostShader = new Shader("media/quad.vs", "media/post.fs");
-        mPostShader->bind();
-        mPostShader->setUniform("gb0", 0);
-        mPostShader->setUniform("gb1", 1);
-        mPostShader->setUniform("gb2", 2);
 
         // Set up scene
-        mShader = new Shader("media/sample.vs", "media/sample.fs");
-        mTexture = new Texture("media/wall.jpg");
-
-        // Scene
-        mMesh = generateBox(0.5f);
+        mTextureLoader = new AsyncTextureLoader(ThreadPool::getDefault());
+        mTexture = mTextureLoader->load("media/wall.jpg", [this](Texture*) {
+            mTextureLoader->printReport();
+        });
+        QuantisedVertices box = quantiser::quantiseVertices(generateBoxVertices(0.5f), {8, 0, 3, 6});
+        quantiser::printReport("box", box);
+        mMesh = new Mesh(box.data.data(), box.vertexCount, box.layout);
+
+        // Set up the shaders. These are the first uses, so they wait for the builds to finish
+        mPostShader->bind();
+        mPostShader->setSampler("gb0", 0);
+        mPostShader->setSampler("gb1", 1);
+        mPostShader->setSampler("gb2", 2);
+        mPostShader->validateSamplers();
+        mShader->bindUniformBlock("PerObject", UNIFORM_BLOCK_PER_OBJECT);
+        mMaterial = new ParameterBlock(mShader);
+        mMaterial->set("positionOffset", box.positionOffset);
+        mMaterial->set("positionScale", box.positionScale);
+        mMaterial->set("tex", 0);
+
+        // All point lights are drawn in a single instanced draw of a shared unit sphere, scaled
+        // by range
+        mLightVolumes = new LightVolumeCache();
+        mLightVolume = mLightVolumes->getSphere(1);
+        mLightVolume->setInstanceLayout(VertexLayout().add(4, GL_FLOAT).add(3, GL_FLOAT));
+        mLightShader->bindUniformBlock("PerFrame", UNIFORM_BLOCK_PER_FRAME);
+        mLightShader->bindUniformBlock("PerView", UNIFORM_BLOCK_PER_VIEW);
+        mLightShader->bind();
+        mLightShader->setSampler("gb0", 0);
+        mLightShader->setSampler("gb1", 1);
+        mLightShader->setSampler("gb2", 2);
+        mLightShader->validateSamplers();
 
         // Lights
         for (int x = -1; x <= 1; x++)
@@ -159,6 +240,12 @@ public:
                 }
             }
         }
+
+        ResourceRegistry::printReport();
+        ProgramBinaryCache::printReport();
+
+        mTimingStart = SDL_GetPerformanceCounter();
+        mTimingFrames = 0;
     }
 
 	virtual bool render() override
@@ -166,31 +253,51 @@ public:
         // Update the camera
         mCameraMan.update(0.0f);
 
+        // Update the shared uniform blocks
+        PerFrameBlock perFrame;
+        perFrame.screenSize = glm::vec2(WIDTH, HEIGHT);
+        perFrame.time = timeSinceEpoch();
+        mPerFrameUniforms->update(perFrame);
+        mPerFrameUniforms->bindBase(UNIFORM_BLOCK_PER_FRAME);
+        PerViewBlock perView;
+        perView.view = mCameraMan.getViewMatrix();
+        perView.proj = mProjMatrix;
+        perView.viewProj = mProjMatrix * perView.view;
+        perView.cameraPosition = glm::vec3(glm::inverse(perView.view)[3]);
+        mPerViewUniforms->update(perView);
+        mPerViewUniforms->bindBase(UNIFORM_BLOCK_PER_VIEW);
+        mPerObjectUniforms->beginFrame();
+        mTextureLoader->update();
+
         // Start rendering to the g-buffer
         mGBuffer->bind();
-        glEnable(GL_DEPTH_TEST);
+        GLState::enable(GL_DEPTH_TEST);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         {
             // Set up the shader parameters
-            mShader->bind();
             static glm::mat4 world;
 			world = glm::rotate(world, 0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
-            mShader->setUniform("worldViewProj", mProjMatrix * mCameraMan.getViewMatrix() * world);
-            mShader->setUniform("world", world);
+            StreamAllocation allocation = mPerObjectUniforms->allocate(
+                sizeof(PerObjectBlock), UniformBuffer::getOffsetAlignment());
+            PerObjectBlock* perObject = static_cast<PerObjectBlock*>(allocation.data);
+            perObject->world = world;
+            perObject->worldViewProj = perView.viewProj * world;
+            mPerObjectUniforms->flush();
+            mPerObjectUniforms->bindRange(UNIFORM_BLOCK_PER_OBJECT, allocation);
+            mMaterial->bind();
 
             // Draw the mesh
-            glActiveTexture(GL_TEXTURE0);
             mTexture->bind(0);
             mMesh->bind();
             mMesh->draw();
         }
-        glDisable(GL_DEPTH_TEST);
+        GLState::disable(GL_DEPTH_TEST);
 
 		// Draw lights
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glEnable(GL_BLEND);
-        glBlendEquation(GL_FUNC_ADD);
-        glBlendFunc(GL_ONE, GL_ONE);
+		GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::enable(GL_BLEND);
+        GLState::blendEquation(GL_FUNC_ADD);
+        GLState::blendFunc(GL_ONE, GL_ONE);
         glClear(GL_COLOR_BUFFER_BIT);
         {
             // Bind G-Buffer
@@ -198,11 +305,18 @@ public:
             mGBuffer->getColourBuffer(1)->bind(1);
             mGBuffer->getColourBuffer(2)->bind(2);
 
-            // Draw point light
-            for (auto i = lights.begin(); i != lights.end(); i++)
-                (*i)->draw(mCameraMan.getViewMatrix(), mProjMatrix);
+            // Draw all point lights at once
+            mLightInstances.resize(lights.size());
+            for (uint i = 0; i < lights.size(); i++)
+                mLightInstances[i] = lights[i]->getInstance();
+            mLightShader->bind();
+            mLightVolume->bind();
+            mLightVolume->setInstanceData(mLightInstances.data(), mLightInstances.size());
+            mLightVolume->drawInstanced(mLightInstances.size());
         }
-        glDisable(GL_BLEND);
+        GLState::disable(GL_BLEND);
+        mPerObjectUniforms->endFrame();
+        mTimingFrames++;
 
         // Check for GL errors
         GLuint err = glGetError();
@@ -217,13 +331,89 @@ public:
 
 	virtual void shutdown() override
     {
-        delete mShader;
+        for (auto i = lights.begin(); i != lights.end(); i++)
+            delete *i;
+        delete mLightVolumes;
+
+        delete mPerObjectUniforms;
+        delete mPerViewUniforms;
+        delete mPerFrameUniforms;
+
+        delete mMaterial;
         delete mTexture;
+        delete mTextureLoader;
         delete mMesh;
 
-        delete mPostShader;
         delete mQuad;
         delete mGBuffer;
+        delete mShaders;
+    }
+
+    virtual void onKeyDown(SDL_Keycode kc) override
+    {
+        Application::onKeyDown(kc);
+
+        // Scale the number of lights between 10 and 100k to benchmark the light pass
+        uint lightCount = lights.size();
+        if (kc == SDLK_EQUALS)
+            lightCount = glm::clamp(lightCount * 10, 10u, 100000u);
+        else if (kc == SDLK_MINUS)
+            lightCount = glm::clamp(lightCount / 10, 10u, 100000u);
+        if (lightCount != lights.size())
+            setLightCount(lightCount);
+
+        // Compare the SIMD mip generator against the scalar reference, and each block
+        // compression format on the wall texture. None of this touches the GPU
+        if (kc == SDLK_m)
+        {
+            MipFilter filters[] = {MIP_FILTER_BOX, MIP_FILTER_KAISER, MIP_FILTER_LANCZOS};
+            for (uint i = 0; i < 3; i++)
+            {
+                MipThroughput throughput = mipgen::measureThroughput(1024, 1024, filters[i]);
+                INFO << mipgen::getFilterName(filters[i]) << " mips: " << throughput.simd
+                     << " MP/s SIMD, " << throughput.scalar << " MP/s scalar" << endl;
+            }
+
+            int width, height, components;
+            uint8_t* pixels = stbi_load("media/wall.jpg", &width, &height, &components, 4);
+            if (pixels)
+            {
+                BlockFormat formats[] = {BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC4,
+                                         BLOCK_FORMAT_BC5};
+                for (uint i = 0; i < 4; i++)
+                {
+                    compressor::printReport("media/wall.jpg",
+                                            compressor::benchmark(pixels, width, height, formats[i]));
+                }
+                stbi_image_free(pixels);
+            }
+        }
+    }
+
+private:
+    void setLightCount(uint count)
+    {
+        // Report the frame time with the current number of lights
+        float seconds = (float)(SDL_GetPerformanceCounter() - mTimingStart) /
+            SDL_GetPerformanceFrequency();
+        INFO << lights.size() << " lights: " << seconds * 1000.0f / glm::max(mTimingFrames, 1u)
+             << "ms per frame" << endl;
+        GLState::printReport();
+
+        // Scatter small lights around the scene
+        for (auto i = lights.begin(); i != lights.end(); i++)
+            delete *i;
+        lights.clear();
+        srand(0);
+        for (uint i = 0; i < count; i++)
+        {
+            PointLight* light = new PointLight(1.0f, 0.0f, 200.0f);
+            light->setPosition(glm::vec3(rand(), rand(), rand()) / (float)RAND_MAX * 4.0f - 2.0f);
+            lights.push_back(light);
+        }
+
+        mTimingStart = SDL_GetPerformanceCounter();
+        mTimingFrames = 0;
     }
 };
 
@@ -244,10 +434,10 @@ Mesh* generateFullscreenQuad()
 	return new Mesh(quadVertices, quadElements, quadLayout);
 }
 
-Mesh* generateBox(float halfSize)
+vector<GLfloat> generateBoxVertices(float halfSize)
 {
-    return new Mesh({
-		// Position						| UVs		  | Normals
+    return {
+		// Position						| Normals		  | UVs
         -halfSize, -halfSize, -halfSize,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f,
         halfSize, -halfSize, -halfSize,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f,
         halfSize,  halfSize, -halfSize,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f,
@@ -289,47 +479,5 @@ Mesh* generateBox(float halfSize)
         halfSize,  halfSize,  halfSize,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f,
         -halfSize,  halfSize,  halfSize,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f,
         -halfSize,  halfSize, -halfSize,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f
-	}, {{3, GL_FLOAT}, {3, GL_FLOAT}, {2, GL_FLOAT}});
-}
-
-Mesh* generateLightSphere(float radius, int rings, int segments)
-{
-    vector<GLfloat> vertexData;
-    vector<GLuint> indexData;
-
-    // Generate the group of rings for the sphere
-    float deltaRingAngle = (float)M_PI / rings;
-    float deltaSegAngle = 2.0f * (float)M_PI / segments;
-    unsigned short vertexIndex = 0;
-    for (int ring = 0; ring <= rings; ring++)
-    {
-        float r0 = radius * sinf(ring * deltaRingAngle);
-        float y0 = radius * cosf(ring * deltaRingAngle);
-
-        // Generate the group of segments for the current ring
-        for (int seg = 0; seg <= segments; seg++)
-        {
-            float x0 = r0 * sinf(seg * deltaSegAngle);
-            float z0 = r0 * cosf(seg * deltaSegAngle);
-
-            // Add one vertex to the strip which makes up the sphere
-            vertexData.push_back(x0);
-            vertexData.push_back(y0);
-            vertexData.push_back(z0);
-
-            if (ring != rings)
-            {
-                // each vertex (except the last) has six indices pointing to it
-                indexData.push_back(vertexIndex + segments + 1);
-                indexData.push_back(vertexIndex);
-                indexData.push_back(vertexIndex + segments);
-                indexData.push_back(vertexIndex + segments + 1);
-                indexData.push_back(vertexIndex + 1);
-                indexData.push_back(vertexIndex);
-                vertexIndex++;
-            }
-        }
-    }
-
-	return new Mesh(vertexData, indexData, {{3, GL_FLOAT}});
+	};
 }
@@ -4,6 +4,8 @@
  */
 #include "Common.h"
 #include "Application.h"
+#include "GLState.h"
+#include "ResourceRegistry.h"
 
 Application::Application() : mWindow(nullptr), mWindowWidth(0), mWindowHeight(0)
 {
@@ -118,6 +120,7 @@ int Application::run(const string& windowTitle, uint width, uint height)
 			}
 
 			// Render a frame
+            GLState::beginFrame();
 			if (!render())
 				quit = true;
 
@@ -126,6 +129,7 @@ int Application::run(const string& windowTitle, uint width, uint height)
 		}
 
 		shutdown();
+		ResourceRegistry::reportLeaks();
 		destroyWindow();
 		return 0;
 	}
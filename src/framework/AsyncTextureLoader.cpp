@@ -0,0 +1,320 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "ResourceRegistry.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "AsyncTextureLoader.h"
+
+#include <chrono>
+#include <cstring>
+#include <stb_image.h>
+
+namespace
+{
+
+// Mid grey, so that placeholders don't stand out in the lit scene
+const uint8_t kPlaceholderColour[4] = {128, 128, 128, 255};
+
+const uint kPageSize = 4096;
+
+float secondsSince(uint64 startTime)
+{
+    return (float)(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+}
+
+}
+
+AsyncTextureLoader::AsyncTextureLoader(ThreadPool& pool, uint uploadBudget)
+    : mPool(pool),
+      mUploadBudget(uploadBudget),
+      mMipFilter(MIP_FILTER_KAISER),
+      mSrgb(true),
+      mCompression(true),
+      mPixelBuffer(0),
+      mPixelBufferSize(0),
+      mStatistics(AsyncTextureStatistics())
+{
+    glGenBuffers(1, &mPixelBuffer);
+}
+
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+    glDeleteBuffers(1, &mPixelBuffer);
+    ResourceRegistry::release(this);
+}
+
+Texture* AsyncTextureLoader::load(const string& filename, TextureCallback callback)
+{
+    Texture* texture = new Texture(1, 1, GL_RGBA8);
+    texture->setData(1, 1, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, kPlaceholderColour);
+    texture->mLoaded = false;
+    ResourceRegistry::track(RESOURCE_TEXTURE, texture,
+                            ResourceRegistry::getTextureSize(GL_RGBA8, 1, 1), filename);
+
+    Request request;
+    request.texture = texture;
+    request.filename = filename;
+    request.callback = callback;
+    request.startTime = SDL_GetPerformanceCounter();
+    MipFilter filter = mMipFilter;
+    bool srgb = mSrgb;
+    bool compression = mCompression;
+    bool s3tcSupported = compressor::isFormatSupported(BLOCK_FORMAT_BC1);
+    request.image = mPool.submit([filename, filter, srgb, compression, s3tcSupported]() {
+        uint64 startTime = SDL_GetPerformanceCounter();
+        DecodedImage image;
+        if (TextureFile::isTextureFile(filename))
+        {
+            // Touch every page of the mapping, so that the upload on the main thread doesn't
+            // block on disk reads
+            image.file.reset(new TextureFile(filename));
+            for (uint i = 0; i < image.file->getLevelCount(); i++)
+            {
+                const TextureFileLevel& level = image.file->getLevel(i);
+                const volatile uint8_t* data = level.data;
+                for (uint offset = 0; offset < level.size; offset += kPageSize)
+                    data[offset];
+            }
+            image.width = image.file->getWidth();
+            image.height = image.file->getHeight();
+            image.decodeSeconds = secondsSince(startTime);
+            image.mipSeconds = image.compressSeconds = 0.0f;
+            return image;
+        }
+
+        int width, height, numComponents;
+        unsigned char* data = stbi_load(filename.c_str(), &width, &height, &numComponents, 4);
+        if (!data)
+        {
+            // stbi_failure_reason is a global shared by every thread, so another failing decode
+            // could replace it before it was read here. Report only what this thread can check
+            std::ifstream file(filename.c_str(), std::ios::binary);
+            stringstream err;
+            err << "Error: Failed to load texture '" << filename << "': "
+                << (file.is_open() ? "unsupported or corrupt image" : "unable to open file")
+                << endl;
+            throw std::runtime_error(err.str());
+        }
+
+        image.width = width;
+        image.height = height;
+        image.pixels.assign(data, data + width * height * 4);
+        stbi_image_free(data);
+        image.decodeSeconds = secondsSince(startTime);
+
+        startTime = SDL_GetPerformanceCounter();
+        image.mips = mipgen::generateMipChain(image.pixels.data(), width, height, filter, srgb);
+        image.mipSeconds = secondsSince(startTime);
+
+        image.compressSeconds = 0.0f;
+        BlockFormat format =
+            compressor::chooseFormat(compressor::analyseChannels(image.pixels.data(), width, height));
+        bool needsS3tc = format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC3;
+        if (compression && (s3tcSupported || !needsS3tc))
+        {
+            startTime = SDL_GetPerformanceCounter();
+            image.compressed.push_back(
+                compressor::compress(image.pixels.data(), width, height, format));
+            for (auto i = image.mips.begin(); i != image.mips.end(); i++)
+                image.compressed.push_back(
+                    compressor::compress(i->pixels.data(), i->width, i->height, format));
+            image.compressSeconds = secondsSince(startTime);
+
+            // Only the compressed levels are uploaded
+            image.pixels.clear();
+            image.mips.clear();
+        }
+        return image;
+    });
+    mRequests.push_back(std::move(request));
+    return texture;
+}
+
+void AsyncTextureLoader::setMipFilter(MipFilter filter, bool srgb)
+{
+    mMipFilter = filter;
+    mSrgb = srgb;
+}
+
+void AsyncTextureLoader::setCompression(bool enabled)
+{
+    mCompression = enabled;
+}
+
+void AsyncTextureLoader::update()
+{
+    uploadReady(mUploadBudget);
+}
+
+void AsyncTextureLoader::finish()
+{
+    for (auto i = mRequests.begin(); i != mRequests.end(); i++)
+        i->image.wait();
+    uploadReady(~0ull);
+}
+
+uint AsyncTextureLoader::getPendingCount() const
+{
+    return mRequests.size();
+}
+
+const AsyncTextureStatistics& AsyncTextureLoader::getStatistics() const
+{
+    return mStatistics;
+}
+
+void AsyncTextureLoader::printReport() const
+{
+    uint count = glm::max(mStatistics.loadedCount, 1u);
+    INFO << "Async textures: " << mStatistics.loadedCount << " loaded, " << mRequests.size()
+         << " pending, " << mStatistics.uploadedBytes / (1024 * 1024) << " MB uploaded" << endl;
+    INFO << "    Average decode " << mStatistics.decodeSeconds * 1000.0f / count
+         << "ms, average latency " << mStatistics.latencySeconds * 1000.0f / count << "ms" << endl;
+    if (mStatistics.mipSeconds > 0.0f)
+    {
+        INFO << "    Mip generation: " << mStatistics.mipMegapixels / mStatistics.mipSeconds
+             << " megapixels per second" << endl;
+    }
+    if (mStatistics.compressSeconds > 0.0f)
+    {
+        INFO << "    Block compression: " << mStatistics.compressedCount << " textures, "
+             << mStatistics.compressSeconds * 1000.0f / mStatistics.compressedCount
+             << "ms average" << endl;
+    }
+}
+
+void AsyncTextureLoader::uploadReady(uint64 budget)
+{
+    uint64 uploaded = 0;
+    auto i = mRequests.begin();
+    while (i != mRequests.end() && uploaded < budget)
+    {
+        if (i->image.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            i++;
+            continue;
+        }
+
+        // Remove the request before fetching the image, in case decoding threw
+        Request request = std::move(*i);
+        i = mRequests.erase(i);
+        DecodedImage image = request.image.get();
+        uploaded += upload(request, image);
+    }
+}
+
+uint AsyncTextureLoader::upload(Request& request, DecodedImage& image)
+{
+    Texture* texture = request.texture;
+    uint size;
+    if (image.file)
+    {
+        // Containers go straight from the mapping, which the worker has already read in
+        texture->setData(*image.file);
+        size = image.file->getSize();
+    }
+    else
+    {
+        size = uploadPixels(texture, image);
+    }
+    texture->mLoaded = true;
+
+    mStatistics.loadedCount++;
+    mStatistics.uploadedBytes += size;
+    mStatistics.decodeSeconds += image.decodeSeconds;
+    mStatistics.mipSeconds += image.mipSeconds;
+    if (image.mipSeconds > 0.0f)
+        mStatistics.mipMegapixels += image.width * image.height / 1000000.0f;
+    if (!image.compressed.empty())
+    {
+        mStatistics.compressSeconds += image.compressSeconds;
+        mStatistics.compressedCount++;
+    }
+    mStatistics.latencySeconds += secondsSince(request.startTime);
+    if (request.callback)
+        request.callback(texture);
+    return size;
+}
+
+uint AsyncTextureLoader::uploadPixels(Texture* texture, DecodedImage& image)
+{
+    // Every level is packed into the pixel buffer one after another
+    bool compressed = !image.compressed.empty();
+    vector<const vector<uint8_t>*> levels;
+    if (compressed)
+    {
+        for (auto i = image.compressed.begin(); i != image.compressed.end(); i++)
+            levels.push_back(&i->data);
+    }
+    else
+    {
+        levels.push_back(&image.pixels);
+        for (auto i = image.mips.begin(); i != image.mips.end(); i++)
+            levels.push_back(&i->pixels);
+    }
+    uint size = 0;
+    for (auto i = levels.begin(); i != levels.end(); i++)
+        size += (*i)->size();
+
+    // Orphan the previous contents of the pixel buffer rather than waiting for the GPU to finish
+    // reading them
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mPixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    if (size != mPixelBufferSize)
+    {
+        mPixelBufferSize = size;
+        ResourceRegistry::track(RESOURCE_BUFFER, this, size, "AsyncTextureLoader");
+    }
+    uint8_t* data = static_cast<uint8_t*>(glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    uint offset = 0;
+    if (data)
+    {
+        for (auto i = levels.begin(); i != levels.end(); i++)
+        {
+            memcpy(data + offset, (*i)->data(), (*i)->size());
+            offset += (*i)->size();
+        }
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    else
+    {
+        // Upload straight from the levels instead, which waits for the driver to copy them
+        WARNING << "Unable to map the texture upload buffer, uploading from client memory"
+                << endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // The levels are read from the pixel buffer, so this returns before the transfer is done
+    offset = 0;
+    for (uint i = 0; i < levels.size(); i++)
+    {
+        const void* levelData = data ? (const void*)(size_t)offset : levels[i]->data();
+        if (compressed)
+        {
+            const CompressedImage& level = image.compressed[i];
+            texture->setCompressedMipLevel(i, level.width, level.height,
+                                           compressor::getInternalFormat(level.format),
+                                           level.data.size(), levelData);
+        }
+        else
+        {
+            uint width = i == 0 ? image.width : image.mips[i - 1].width;
+            uint height = i == 0 ? image.height : image.mips[i - 1].height;
+            texture->setMipLevel(i, width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, levelData);
+        }
+        offset += levels[i]->size();
+    }
+    if (compressed)
+    {
+        GLint swizzle[4];
+        compressor::getSwizzle(image.compressed[0].format, swizzle);
+        texture->setSwizzle(swizzle);
+    }
+    texture->setLevelCount(levels.size());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return size;
+}
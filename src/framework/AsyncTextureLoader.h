@@ -0,0 +1,113 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <functional>
+#include <future>
+
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+#include "TextureFile.h"
+
+class Texture;
+class ThreadPool;
+
+// Called on the main thread once a texture has been uploaded
+typedef std::function<void(Texture*)> TextureCallback;
+
+struct AsyncTextureStatistics
+{
+    uint loadedCount;
+    uint64 uploadedBytes;
+    float decodeSeconds;  // Total time spent decoding, or reading texture files, on worker threads
+    float mipSeconds;     // Total time spent generating mip chains on worker threads
+    float mipMegapixels;  // Source pixels the mip chains were generated from
+    float compressSeconds; // Total time spent block compressing on worker threads
+    uint compressedCount;
+    float latencySeconds; // Total time from the load request to the texture being ready
+};
+
+// Loads textures without blocking the main thread. Images are decoded, their mip chains generated
+// and optionally block compressed on a thread pool, then every level is copied into a pixel
+// unpack buffer so that glTexImage2D returns without waiting for the
+// transfer. DDS and KTX2 files skip all of that: a worker maps the file and reads its pages in,
+// and the levels are uploaded straight from the mapping. Each texture holds a 1x1 placeholder
+// until its image has been uploaded, so it can be bound straight away
+class AsyncTextureLoader
+{
+public:
+    // 'uploadBudget' limits the bytes uploaded per update, to spread the cost of many textures
+    // finishing at once over several frames. The first upload of an update is always allowed
+    AsyncTextureLoader(ThreadPool& pool, uint uploadBudget = 16 * 1024 * 1024);
+
+    // Textures which haven't been uploaded yet keep their placeholder
+    ~AsyncTextureLoader();
+
+    // Queue a texture to be loaded. The texture is owned by the caller, and must not be deleted
+    // until it is loaded
+    Texture* load(const string& filename, TextureCallback callback = TextureCallback());
+
+    // Filter used for the mip chains of textures loaded after this call. Textures are treated as
+    // sRGB colour unless 'srgb' is false
+    void setMipFilter(MipFilter filter, bool srgb = true);
+
+    // Block compress textures loaded after this call, in the smallest format which keeps the
+    // channels each texture uses. Formats the driver doesn't support are left uncompressed
+    void setCompression(bool enabled);
+
+    // Upload any textures which have finished decoding and run their callbacks. Call this once
+    // per frame. Throws if an image failed to decode
+    void update();
+
+    // Block until every queued texture has been uploaded
+    void finish();
+
+    uint getPendingCount() const;
+    const AsyncTextureStatistics& getStatistics() const;
+
+    // Log the load counts and timings
+    void printReport() const;
+
+private:
+    struct DecodedImage
+    {
+        uint width;
+        uint height;
+        vector<uint8_t> pixels;
+        vector<MipLevel> mips;
+        vector<CompressedImage> compressed; // Every level including the first, if compressed
+        unique_ptr<TextureFile> file;       // Set instead of the levels for DDS and KTX2 files
+        float decodeSeconds;
+        float mipSeconds;
+        float compressSeconds;
+    };
+
+    struct Request
+    {
+        Texture* texture;
+        string filename;
+        TextureCallback callback;
+        std::future<DecodedImage> image;
+        uint64 startTime;
+    };
+
+    ThreadPool& mPool;
+    uint mUploadBudget;
+    MipFilter mMipFilter;
+    bool mSrgb;
+    bool mCompression;
+    vector<Request> mRequests;
+
+    GLuint mPixelBuffer;
+    uint mPixelBufferSize;
+
+    AsyncTextureStatistics mStatistics;
+
+    // Upload decoded images until 'budget' bytes have been uploaded
+    void uploadReady(uint64 budget);
+    // Returns the number of bytes uploaded
+    uint upload(Request& request, DecodedImage& image);
+    uint uploadPixels(Texture* texture, DecodedImage& image);
+};
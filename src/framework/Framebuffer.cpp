@@ -3,6 +3,8 @@
  * Copyright (c) David Avedissian 2014-2015
  */
 #include "Common.h"
+#include "GLState.h"
+#include "ResourceRegistry.h"
 #include "Texture.h"
 #include "Framebuffer.h"
 
@@ -11,7 +13,7 @@ Framebuffer::Framebuffer(uint width, uint height, uint textureCount)
       mHeight(height)
 {
     glGenFramebuffers(1, &mFramebuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
 
     // Bind colour buffers
     for (uint i = 0; i < textureCount; i++)
@@ -28,6 +30,10 @@ Framebuffer::Framebuffer(uint width, uint height, uint textureCount)
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, mDepthBuffer);
 
+    // The colour buffers are tracked as textures, so only the depth buffer is counted here
+    ResourceRegistry::track(RESOURCE_FRAMEBUFFER, this,
+                            ResourceRegistry::getTextureSize(GL_DEPTH24_STENCIL8, width, height));
+
     // Set the list of draw buffers
     vector<GLenum> drawBuffers;
     for (uint i = 0; i < textureCount; i++)
@@ -44,18 +50,21 @@ Framebuffer::Framebuffer(uint width, uint height, uint textureCount)
     }
 
     // Unbind
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 Framebuffer::~Framebuffer()
 {
     mTextures.clear();
+    glDeleteRenderbuffers(1, &mDepthBuffer);
+    GLState::forgetFramebuffer(mFramebuffer);
     glDeleteFramebuffers(1, &mFramebuffer);
+    ResourceRegistry::release(this);
 }
 
 void Framebuffer::bind()
 {
-    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+    GLState::bindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
 }
 
 Texture* Framebuffer::getColourBuffer(uint i)
@@ -0,0 +1,41 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4& viewProj)
+{
+    // Gribb and Hartmann: each plane is the sum or difference of the fourth row and one other
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++)
+        row[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+
+    mPlanes[0] = row[3] + row[0]; // Left
+    mPlanes[1] = row[3] - row[0]; // Right
+    mPlanes[2] = row[3] + row[1]; // Bottom
+    mPlanes[3] = row[3] - row[1]; // Top
+    mPlanes[4] = row[3] + row[2]; // Near
+    mPlanes[5] = row[3] - row[2]; // Far
+
+    // Normalise so plane distances are in world units
+    for (int i = 0; i < 6; i++)
+        mPlanes[i] /= glm::length(glm::vec3(mPlanes[i]));
+}
+
+bool Frustum::containsSphere(const glm::vec3& centre, float radius) const
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (glm::dot(glm::vec3(mPlanes[i]), centre) + mPlanes[i].w < -radius)
+            return false;
+    }
+    return true;
+}
+
+const glm::vec4& Frustum::getPlane(uint index) const
+{
+    assert(index < 6);
+    return mPlanes[index];
+}
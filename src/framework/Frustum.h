@@ -0,0 +1,20 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// The six clipping planes of a view-projection matrix, pointing inwards
+class Frustum
+{
+public:
+    Frustum(const glm::mat4& viewProj);
+
+    bool containsSphere(const glm::vec3& centre, float radius) const;
+
+    // Normalised plane equation. Planes are ordered left, right, bottom, top, near, far
+    const glm::vec4& getPlane(uint index) const;
+
+private:
+    glm::vec4 mPlanes[6];
+};
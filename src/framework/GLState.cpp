@@ -0,0 +1,314 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "GLState.h"
+
+#include <map>
+
+namespace
+{
+
+// Marks state which hasn't been set through GLState, so the next call must be issued
+const GLuint kUnknown = ~0u;
+
+// Units beyond this are passed straight through without caching
+const uint kMaxTextureUnits = 32;
+
+// Texture targets with a shadow copy per unit. Other targets are passed straight through
+const GLenum kTextureTargets[] = {GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP,
+                                  GL_TEXTURE_3D};
+const uint kTextureTargetCount = sizeof(kTextureTargets) / sizeof(kTextureTargets[0]);
+
+GLuint gProgram = kUnknown;
+GLuint gVertexArray = kUnknown;
+GLuint gActiveTextureUnit = kUnknown;
+GLuint gTextures[kMaxTextureUnits][kTextureTargetCount];
+GLuint gDrawFramebuffer = kUnknown;
+GLuint gReadFramebuffer = kUnknown;
+GLenum gBlendEquation = kUnknown;
+GLenum gBlendSource = kUnknown;
+GLenum gBlendDestination = kUnknown;
+std::map<GLenum, bool> gCapabilities;
+
+GLStateStatistics gFrame = GLStateStatistics();
+GLStateStatistics gLastFrame = GLStateStatistics();
+
+// Count a call, returning true if it needs to be issued
+bool update(GLStateCategory category, GLuint& shadow, GLuint value)
+{
+    if (shadow == value)
+    {
+        gFrame.skipped[category]++;
+        return false;
+    }
+
+    shadow = value;
+    gFrame.issued[category]++;
+    return true;
+}
+
+int getTextureTargetIndex(GLenum target)
+{
+    for (uint i = 0; i < kTextureTargetCount; i++)
+    {
+        if (kTextureTargets[i] == target)
+            return i;
+    }
+    return -1;
+}
+
+void resetTextures()
+{
+    for (uint unit = 0; unit < kMaxTextureUnits; unit++)
+    {
+        for (uint i = 0; i < kTextureTargetCount; i++)
+            gTextures[unit][i] = kUnknown;
+    }
+}
+
+// Texture bindings start out unknown
+struct TextureInitialiser
+{
+    TextureInitialiser()
+    {
+        resetTextures();
+    }
+} gTextureInitialiser;
+
+void setActiveTextureUnit(uint unit)
+{
+    if (gActiveTextureUnit != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        gActiveTextureUnit = unit;
+        gFrame.issued[STATE_TEXTURE]++;
+    }
+}
+
+}
+
+uint GLStateStatistics::getTotalIssued() const
+{
+    uint total = 0;
+    for (int i = 0; i < STATE_CATEGORY_COUNT; i++)
+        total += issued[i];
+    return total;
+}
+
+uint GLStateStatistics::getTotalSkipped() const
+{
+    uint total = 0;
+    for (int i = 0; i < STATE_CATEGORY_COUNT; i++)
+        total += skipped[i];
+    return total;
+}
+
+void GLState::useProgram(GLuint program)
+{
+    if (update(STATE_PROGRAM, gProgram, program))
+        glUseProgram(program);
+}
+
+void GLState::bindVertexArray(GLuint vertexArray)
+{
+    if (update(STATE_VERTEX_ARRAY, gVertexArray, vertexArray))
+        glBindVertexArray(vertexArray);
+}
+
+bool GLState::getVertexArray(GLuint& vertexArray)
+{
+    vertexArray = gVertexArray;
+    return gVertexArray != kUnknown;
+}
+
+void GLState::bindTexture(uint unit, GLenum target, GLuint texture)
+{
+    int targetIndex = getTextureTargetIndex(target);
+    if (unit >= kMaxTextureUnits || targetIndex < 0)
+    {
+        setActiveTextureUnit(unit);
+        glBindTexture(target, texture);
+        gFrame.issued[STATE_TEXTURE]++;
+        return;
+    }
+
+    // Only switch the active unit if the binding actually changes
+    if (gTextures[unit][targetIndex] == texture)
+    {
+        gFrame.skipped[STATE_TEXTURE]++;
+        return;
+    }
+    setActiveTextureUnit(unit);
+    update(STATE_TEXTURE, gTextures[unit][targetIndex], texture);
+    glBindTexture(target, texture);
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture)
+{
+    if (gActiveTextureUnit == kUnknown)
+        setActiveTextureUnit(0);
+    bindTexture(gActiveTextureUnit, target, texture);
+}
+
+void GLState::bindFramebuffer(GLenum target, GLuint framebuffer)
+{
+    if (target == GL_DRAW_FRAMEBUFFER)
+    {
+        if (update(STATE_FRAMEBUFFER, gDrawFramebuffer, framebuffer))
+            glBindFramebuffer(target, framebuffer);
+    }
+    else if (target == GL_READ_FRAMEBUFFER)
+    {
+        if (update(STATE_FRAMEBUFFER, gReadFramebuffer, framebuffer))
+            glBindFramebuffer(target, framebuffer);
+    }
+    else if (gDrawFramebuffer == framebuffer && gReadFramebuffer == framebuffer)
+    {
+        gFrame.skipped[STATE_FRAMEBUFFER]++;
+    }
+    else
+    {
+        gDrawFramebuffer = gReadFramebuffer = framebuffer;
+        gFrame.issued[STATE_FRAMEBUFFER]++;
+        glBindFramebuffer(target, framebuffer);
+    }
+}
+
+void GLState::enable(GLenum capability)
+{
+    setEnabled(capability, true);
+}
+
+void GLState::disable(GLenum capability)
+{
+    setEnabled(capability, false);
+}
+
+void GLState::setEnabled(GLenum capability, bool enabled)
+{
+    auto existing = gCapabilities.find(capability);
+    if (existing != gCapabilities.end() && existing->second == enabled)
+    {
+        gFrame.skipped[STATE_CAPABILITY]++;
+        return;
+    }
+
+    gCapabilities[capability] = enabled;
+    gFrame.issued[STATE_CAPABILITY]++;
+    if (enabled)
+        glEnable(capability);
+    else
+        glDisable(capability);
+}
+
+void GLState::blendEquation(GLenum mode)
+{
+    if (update(STATE_BLEND, gBlendEquation, mode))
+        glBlendEquation(mode);
+}
+
+void GLState::blendFunc(GLenum source, GLenum destination)
+{
+    if (gBlendSource == source && gBlendDestination == destination)
+    {
+        gFrame.skipped[STATE_BLEND]++;
+        return;
+    }
+
+    gBlendSource = source;
+    gBlendDestination = destination;
+    gFrame.issued[STATE_BLEND]++;
+    glBlendFunc(source, destination);
+}
+
+void GLState::forgetProgram(GLuint program)
+{
+    // A deleted program stays in use until another is bound, so the name can't be trusted
+    if (gProgram == program)
+        gProgram = kUnknown;
+}
+
+void GLState::forgetVertexArray(GLuint vertexArray)
+{
+    if (gVertexArray == vertexArray)
+        gVertexArray = 0;
+}
+
+void GLState::forgetTexture(GLuint texture)
+{
+    for (uint unit = 0; unit < kMaxTextureUnits; unit++)
+    {
+        for (uint i = 0; i < kTextureTargetCount; i++)
+        {
+            if (gTextures[unit][i] == texture)
+                gTextures[unit][i] = 0;
+        }
+    }
+}
+
+void GLState::forgetFramebuffer(GLuint framebuffer)
+{
+    if (gDrawFramebuffer == framebuffer)
+        gDrawFramebuffer = 0;
+    if (gReadFramebuffer == framebuffer)
+        gReadFramebuffer = 0;
+}
+
+void GLState::invalidate()
+{
+    gProgram = kUnknown;
+    gVertexArray = kUnknown;
+    gActiveTextureUnit = kUnknown;
+    resetTextures();
+    gDrawFramebuffer = kUnknown;
+    gReadFramebuffer = kUnknown;
+    gBlendEquation = kUnknown;
+    gBlendSource = kUnknown;
+    gBlendDestination = kUnknown;
+    gCapabilities.clear();
+}
+
+void GLState::beginFrame()
+{
+    gLastFrame = gFrame;
+    gFrame = GLStateStatistics();
+}
+
+const GLStateStatistics& GLState::getLastFrameStatistics()
+{
+    return gLastFrame;
+}
+
+void GLState::printReport()
+{
+    INFO << "GL state changes: " << gLastFrame.getTotalIssued() << " issued, "
+         << gLastFrame.getTotalSkipped() << " skipped" << endl;
+    for (int i = 0; i < STATE_CATEGORY_COUNT; i++)
+    {
+        INFO << "    " << getCategoryName((GLStateCategory)i) << ": " << gLastFrame.issued[i]
+             << " issued, " << gLastFrame.skipped[i] << " skipped" << endl;
+    }
+}
+
+const char* GLState::getCategoryName(GLStateCategory category)
+{
+    switch (category)
+    {
+    case STATE_PROGRAM:
+        return "Program";
+    case STATE_VERTEX_ARRAY:
+        return "Vertex array";
+    case STATE_TEXTURE:
+        return "Texture";
+    case STATE_FRAMEBUFFER:
+        return "Framebuffer";
+    case STATE_CAPABILITY:
+        return "Capability";
+    case STATE_BLEND:
+        return "Blend";
+    default:
+        return "Unknown";
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+enum GLStateCategory
+{
+    STATE_PROGRAM,
+    STATE_VERTEX_ARRAY,
+    STATE_TEXTURE,
+    STATE_FRAMEBUFFER,
+    STATE_CAPABILITY,
+    STATE_BLEND,
+    STATE_CATEGORY_COUNT
+};
+
+struct GLStateStatistics
+{
+    uint issued[STATE_CATEGORY_COUNT];
+    uint skipped[STATE_CATEGORY_COUNT];
+
+    uint getTotalIssued() const;
+    uint getTotalSkipped() const;
+};
+
+// Shadow copy of the GL binding and render state. Every framework bind goes through here, so
+// calls which would not change anything are skipped instead of reaching the driver. State which
+// hasn't been set through GLState yet is unknown, and the first call to set it is always issued
+class GLState
+{
+public:
+    static void useProgram(GLuint program);
+    static void bindVertexArray(GLuint vertexArray);
+
+    // The vertex array bound through GLState. Returns false if it isn't known
+    static bool getVertexArray(GLuint& vertexArray);
+
+    // Bind a texture to a texture unit, switching the active unit if needed
+    static void bindTexture(uint unit, GLenum target, GLuint texture);
+
+    // Bind a texture to the active unit, for creating and updating it
+    static void bindTexture(GLenum target, GLuint texture);
+
+    // GL_FRAMEBUFFER binds both the draw and read framebuffer
+    static void bindFramebuffer(GLenum target, GLuint framebuffer);
+
+    static void enable(GLenum capability);
+    static void disable(GLenum capability);
+    static void setEnabled(GLenum capability, bool enabled);
+
+    static void blendEquation(GLenum mode);
+    static void blendFunc(GLenum source, GLenum destination);
+
+    // Called before deleting an object, as GL unbinds it and its name can be reused
+    static void forgetProgram(GLuint program);
+    static void forgetVertexArray(GLuint vertexArray);
+    static void forgetTexture(GLuint texture);
+    static void forgetFramebuffer(GLuint framebuffer);
+
+    // Mark all state as unknown, for when GL state has been changed behind GLState's back
+    static void invalidate();
+
+    // Start counting calls for a new frame, keeping the counts for the frame which just ended
+    static void beginFrame();
+    static const GLStateStatistics& getLastFrameStatistics();
+
+    // Log the issued and skipped calls for each category in the last frame
+    static void printReport();
+
+    static const char* getCategoryName(GLStateCategory category);
+};
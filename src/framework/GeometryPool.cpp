@@ -0,0 +1,176 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "GLState.h"
+#include "ResourceRegistry.h"
+#include "GeometryPool.h"
+
+GeometryPool::GeometryPool(const VertexLayout& layout, uint maxVertices, uint maxIndices,
+                           GLenum indexType)
+    : mLayout(layout),
+      mIndexType(indexType),
+      mIndexSize(indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint)),
+      mVertexArrayObject(0),
+      mVertexBufferObject(0),
+      mElementBufferObject(0),
+      mIndirectBufferObject(0),
+      mIndirectBufferSize(0),
+      mMaxVertices(maxVertices),
+      mMaxIndices(maxIndices),
+      mVertexCount(0),
+      mIndexCount(0),
+      mMultiDrawIndirect(gl3wIsSupported(4, 3) != 0),
+      mBaseInstance(gl3wIsSupported(4, 2) != 0)
+{
+    assert(indexType == GL_UNSIGNED_SHORT || indexType == GL_UNSIGNED_INT);
+
+    glGenVertexArrays(1, &mVertexArrayObject);
+    GLState::bindVertexArray(mVertexArrayObject);
+
+    // Allocate the storage up front, meshes are copied in with glBufferSubData
+    glGenBuffers(1, &mVertexBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)maxVertices * mLayout.getStride(), nullptr,
+                 GL_STATIC_DRAW);
+    mLayout.apply();
+
+    glGenBuffers(1, &mElementBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBufferObject);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)maxIndices * mIndexSize, nullptr,
+                 GL_STATIC_DRAW);
+
+    ResourceRegistry::track(RESOURCE_BUFFER, this, (uint64)maxVertices * mLayout.getStride() +
+                                                   (uint64)maxIndices * mIndexSize);
+
+    if (mMultiDrawIndirect)
+        glGenBuffers(1, &mIndirectBufferObject);
+    else
+        WARNING << "glMultiDrawElementsIndirect is unavailable, GeometryPool will draw each "
+                   "mesh separately" << endl;
+}
+
+GeometryPool::~GeometryPool()
+{
+    glDeleteBuffers(1, &mIndirectBufferObject);
+    glDeleteBuffers(1, &mElementBufferObject);
+    glDeleteBuffers(1, &mVertexBufferObject);
+    GLState::forgetVertexArray(mVertexArrayObject);
+    glDeleteVertexArrays(1, &mVertexArrayObject);
+    ResourceRegistry::release(this);
+}
+
+GeometryAllocation GeometryPool::allocate(const void* vertexData, uint vertexCount,
+                                          const vector<GLuint>& indices)
+{
+    if (mVertexCount + vertexCount > mMaxVertices || mIndexCount + indices.size() > mMaxIndices)
+        throw std::runtime_error("Error: GeometryPool is full");
+    if (mIndexType == GL_UNSIGNED_SHORT && vertexCount > 0x10000)
+        throw std::runtime_error("Error: Mesh has too many vertices for a 16 bit GeometryPool");
+    for (auto i = indices.begin(); i != indices.end(); i++)
+    {
+        if (*i >= vertexCount)
+            throw std::runtime_error("Error: Mesh indices refer to vertices which don't exist");
+    }
+
+    GeometryAllocation allocation = {mVertexCount, vertexCount, mIndexCount, (uint)indices.size()};
+
+    // Copy vertices
+    uint stride = mLayout.getStride();
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
+    glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)mVertexCount * stride,
+                    (GLsizeiptr)vertexCount * stride, vertexData);
+
+    // Copy indices, narrowing them if necessary
+    GLState::bindVertexArray(mVertexArrayObject);
+    if (mIndexType == GL_UNSIGNED_SHORT)
+    {
+        vector<GLushort> shortIndices(indices.begin(), indices.end());
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)mIndexCount * mIndexSize,
+                        shortIndices.size() * mIndexSize, shortIndices.data());
+    }
+    else
+    {
+        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, (GLintptr)mIndexCount * mIndexSize,
+                        indices.size() * mIndexSize, indices.data());
+    }
+
+    mVertexCount += vertexCount;
+    mIndexCount += indices.size();
+    return allocation;
+}
+
+void GeometryPool::clear()
+{
+    mVertexCount = 0;
+    mIndexCount = 0;
+    mCommands.clear();
+}
+
+void GeometryPool::addDraw(const GeometryAllocation& allocation, uint instanceCount,
+                           uint baseInstance)
+{
+    if (baseInstance != 0 && !mBaseInstance)
+        throw std::runtime_error("Error: GeometryPool needs GL 4.2 to draw with a base instance");
+    DrawElementsIndirectCommand command = {allocation.indexCount, instanceCount,
+                                           allocation.firstIndex, (GLint)allocation.baseVertex,
+                                           baseInstance};
+    mCommands.push_back(command);
+}
+
+void GeometryPool::submit()
+{
+    if (mCommands.empty())
+        return;
+
+    GLState::bindVertexArray(mVertexArrayObject);
+    if (mMultiDrawIndirect)
+    {
+        // Upload the commands, growing the buffer if needed
+        uint size = mCommands.size() * sizeof(DrawElementsIndirectCommand);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBufferObject);
+        if (size > mIndirectBufferSize)
+        {
+            mIndirectBufferSize = size * 2;
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, mIndirectBufferSize, nullptr, GL_STREAM_DRAW);
+        }
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, size, mCommands.data());
+        glMultiDrawElementsIndirect(GL_TRIANGLES, mIndexType, nullptr, mCommands.size(), 0);
+    }
+    else
+    {
+        // Without GL 4.2, addDraw has already made sure that every base instance is 0
+        for (auto i = mCommands.begin(); i != mCommands.end(); i++)
+        {
+            void* offset = (void*)((size_t)i->firstIndex * mIndexSize);
+            if (mBaseInstance)
+            {
+                glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, i->count, mIndexType,
+                                                              offset, i->instanceCount,
+                                                              i->baseVertex, i->baseInstance);
+            }
+            else
+            {
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, i->count, mIndexType, offset,
+                                                  i->instanceCount, i->baseVertex);
+            }
+        }
+    }
+    mCommands.clear();
+}
+
+const VertexLayout& GeometryPool::getLayout() const
+{
+    return mLayout;
+}
+
+uint GeometryPool::getVertexCount() const
+{
+    return mVertexCount;
+}
+
+uint GeometryPool::getIndexCount() const
+{
+    return mIndexCount;
+}
@@ -0,0 +1,77 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include "VertexLayout.h"
+
+// The range of a GeometryPool's buffers which holds a single mesh
+struct GeometryAllocation
+{
+    uint baseVertex;
+    uint vertexCount;
+    uint firstIndex;
+    uint indexCount;
+};
+
+// Matches the layout consumed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+static_assert(sizeof(DrawElementsIndirectCommand) == 20, "Unexpected indirect command size");
+
+// Sub-allocates many meshes which share a vertex layout out of a single vertex buffer and index
+// buffer, with one vertex array object. Queued draws are submitted together with
+// glMultiDrawElementsIndirect, so drawing any number of meshes costs a handful of API calls.
+// Indices are relative to each mesh, so 16 bit indices work for meshes of up to 65536 vertices
+class GeometryPool
+{
+public:
+    GeometryPool(const VertexLayout& layout, uint maxVertices, uint maxIndices,
+                 GLenum indexType = GL_UNSIGNED_SHORT);
+    ~GeometryPool();
+
+    // Copy a mesh into the pool. Throws if it doesn't fit or an index is out of range
+    GeometryAllocation allocate(const void* vertexData, uint vertexCount,
+                                const vector<GLuint>& indices);
+
+    // Release every allocation
+    void clear();
+
+    // Queue a draw, which is issued by the next call to submit. A non-zero base instance needs
+    // GL 4.2, and throws without it
+    void addDraw(const GeometryAllocation& allocation, uint instanceCount = 1,
+                 uint baseInstance = 0);
+
+    // Bind the pool and issue all queued draws
+    void submit();
+
+    const VertexLayout& getLayout() const;
+    uint getVertexCount() const;
+    uint getIndexCount() const;
+
+private:
+    VertexLayout mLayout;
+    GLenum mIndexType;
+    uint mIndexSize;
+
+    GLuint mVertexArrayObject;
+    GLuint mVertexBufferObject;
+    GLuint mElementBufferObject;
+    GLuint mIndirectBufferObject;
+    uint mIndirectBufferSize;
+
+    uint mMaxVertices, mMaxIndices;
+    uint mVertexCount, mIndexCount;
+
+    vector<DrawElementsIndirectCommand> mCommands;
+    bool mMultiDrawIndirect;
+    bool mBaseInstance;
+};
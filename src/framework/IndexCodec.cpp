@@ -0,0 +1,93 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "IndexCodec.h"
+
+namespace codec
+{
+
+namespace
+{
+
+void writeVarint(vector<uint8_t>& data, uint value)
+{
+    while (value >= 0x80)
+    {
+        data.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back((uint8_t)value);
+}
+
+}
+
+vector<uint8_t> encodeIndices(const vector<GLuint>& indices)
+{
+    vector<uint8_t> data;
+    data.reserve(indices.size());
+
+    // Code 0 refers to the next vertex which hasn't been seen yet. Anything else is a zigzag
+    // encoded delta from the previous index, offset by 1
+    GLuint next = 0, last = 0;
+    for (auto i = indices.begin(); i != indices.end(); i++)
+    {
+        if (*i == next)
+        {
+            writeVarint(data, 0);
+            next++;
+        }
+        else
+        {
+            int32_t delta = (int32_t)(*i - last);
+            uint zigzag = ((uint)delta << 1) ^ (uint)(delta >> 31);
+            writeVarint(data, zigzag + 1);
+        }
+        last = *i;
+    }
+
+    return data;
+}
+
+bool decodeIndices(const uint8_t* data, size_t size, uint indexCount, uint vertexCount,
+                   vector<GLuint>& indices)
+{
+    indices.resize(indexCount);
+
+    const uint8_t* end = data + size;
+    GLuint next = 0, last = 0;
+    for (uint i = 0; i < indexCount; i++)
+    {
+        // Read a varint. The fifth byte only has room for the top 4 bits of a 32 bit code
+        uint code = 0;
+        for (uint shift = 0;; shift += 7)
+        {
+            if (data == end || shift > 28)
+                return false;
+            uint8_t byte = *data++;
+            if (shift == 28 && byte > 0x0F)
+                return false;
+            code |= (uint)(byte & 0x7F) << shift;
+            if (byte < 0x80)
+                break;
+        }
+
+        if (code == 0)
+        {
+            last = next++;
+        }
+        else
+        {
+            uint zigzag = code - 1;
+            last += (GLuint)((zigzag >> 1) ^ (0u - (zigzag & 1)));
+        }
+        if (last >= vertexCount)
+            return false;
+        indices[i] = last;
+    }
+
+    return data == end;
+}
+
+}
@@ -0,0 +1,20 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+namespace codec {
+
+// Compress an index buffer for storage. Each index is stored as a variable length integer,
+// either as a reference to the next unseen vertex or as a delta from the previous index. This
+// works best on buffers which have been through optimiser::optimiseVertexCache and
+// optimiser::optimiseVertexFetch, where most indices take a single byte
+vector<uint8_t> encodeIndices(const vector<GLuint>& indices);
+
+// Decompress an index buffer produced by encodeIndices. Returns false if the data is malformed or
+// refers to a vertex at or beyond 'vertexCount'
+bool decodeIndices(const uint8_t* data, size_t size, uint indexCount, uint vertexCount,
+                   vector<GLuint>& indices);
+
+}
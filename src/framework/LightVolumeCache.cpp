@@ -0,0 +1,111 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "Mesh.h"
+#include "MeshOptimiser.h"
+#include "LightVolumeCache.h"
+
+LightVolumeCache::LightVolumeCache()
+{
+}
+
+LightVolumeCache::~LightVolumeCache()
+{
+    for (auto i = mSpheres.begin(); i != mSpheres.end(); i++)
+        delete i->second;
+}
+
+Mesh* LightVolumeCache::getSphere(uint subdivisions)
+{
+    auto existing = mSpheres.find(subdivisions);
+    if (existing != mSpheres.end())
+        return existing->second;
+
+    Mesh* sphere = generateSphere(subdivisions);
+    mSpheres[subdivisions] = sphere;
+    return sphere;
+}
+
+Mesh* LightVolumeCache::generateSphere(uint subdivisions)
+{
+    // Start with an icosahedron
+    const float t = (1.0f + sqrtf(5.0f)) * 0.5f;
+    vector<glm::vec3> vertices = {
+        {-1.0f, t, 0.0f}, {1.0f, t, 0.0f}, {-1.0f, -t, 0.0f}, {1.0f, -t, 0.0f},
+        {0.0f, -1.0f, t}, {0.0f, 1.0f, t}, {0.0f, -1.0f, -t}, {0.0f, 1.0f, -t},
+        {t, 0.0f, -1.0f}, {t, 0.0f, 1.0f}, {-t, 0.0f, -1.0f}, {-t, 0.0f, 1.0f}
+    };
+    vector<GLuint> indices = {
+        0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+        1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+        3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+        4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1
+    };
+    for (auto v = vertices.begin(); v != vertices.end(); v++)
+        *v = glm::normalize(*v);
+
+    // Split each triangle into four, sharing the new vertices along each edge
+    for (uint i = 0; i < subdivisions; i++)
+    {
+        std::map<pair<GLuint, GLuint>, GLuint> midpoints;
+        vector<GLuint> subdivided;
+        subdivided.reserve(indices.size() * 4);
+        for (uint j = 0; j < indices.size(); j += 3)
+        {
+            GLuint corners[3] = {indices[j], indices[j + 1], indices[j + 2]};
+            GLuint mid[3];
+            for (uint k = 0; k < 3; k++)
+            {
+                GLuint a = corners[k], b = corners[(k + 1) % 3];
+                pair<GLuint, GLuint> edge = make_pair(glm::min(a, b), glm::max(a, b));
+                auto existing = midpoints.find(edge);
+                if (existing != midpoints.end())
+                {
+                    mid[k] = existing->second;
+                }
+                else
+                {
+                    mid[k] = vertices.size();
+                    vertices.push_back(glm::normalize(vertices[a] + vertices[b]));
+                    midpoints[edge] = mid[k];
+                }
+            }
+            GLuint triangles[12] = {
+                corners[0], mid[0], mid[2],
+                corners[1], mid[1], mid[0],
+                corners[2], mid[2], mid[1],
+                mid[0], mid[1], mid[2]
+            };
+            subdivided.insert(subdivided.end(), triangles, triangles + 12);
+        }
+        indices.swap(subdivided);
+    }
+
+    // The vertices lie on the unit sphere, so the facets cut inside it. Push them out until the
+    // closest facet touches the sphere
+    float minDistance = 1.0f;
+    for (uint i = 0; i < indices.size(); i += 3)
+    {
+        const glm::vec3& p0 = vertices[indices[i]];
+        glm::vec3 normal = glm::normalize(glm::cross(vertices[indices[i + 1]] - p0,
+                                                     vertices[indices[i + 2]] - p0));
+        minDistance = glm::min(minDistance, glm::abs(glm::dot(normal, p0)));
+    }
+    vector<GLfloat> vertexData;
+    vertexData.reserve(vertices.size() * 3);
+    for (auto v = vertices.begin(); v != vertices.end(); v++)
+    {
+        glm::vec3 p = *v / minDistance;
+        vertexData.push_back(p.x);
+        vertexData.push_back(p.y);
+        vertexData.push_back(p.z);
+    }
+
+    uint vertexCount = vertices.size();
+    optimiser::optimiseVertexCache(indices, vertexCount);
+    optimiser::optimiseOverdraw(indices, vertexData.data(), 3, vertexCount);
+    optimiser::optimiseVertexFetch(vertexData.data(), vertexCount, 3 * sizeof(GLfloat), indices);
+    return new Mesh(vertexData, indices, {{3, GL_FLOAT}});
+}
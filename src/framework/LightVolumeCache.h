@@ -0,0 +1,28 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <map>
+
+class Mesh;
+
+// Owns the geometry shared by every light volume of a given kind. Lights only store their
+// parameters, and are scaled into place through per-instance data. Light programs are shared
+// through a ShaderLibrary
+class LightVolumeCache
+{
+public:
+    LightVolumeCache();
+    ~LightVolumeCache();
+
+    // An icosphere which encloses the unit sphere, so that a light's range is never clipped by
+    // the facets. Each subdivision level quadruples the triangle count
+    Mesh* getSphere(uint subdivisions = 1);
+
+private:
+    std::map<uint, Mesh*> mSpheres;
+
+    static Mesh* generateSphere(uint subdivisions);
+};
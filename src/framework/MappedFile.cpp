@@ -0,0 +1,121 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include "Common.h"
+#include "MappedFile.h"
+
+namespace
+{
+
+void throwMapError(const string& file)
+{
+    stringstream err;
+    err << "Error: Unable to map file '" << file << "'" << endl;
+    throw std::runtime_error(err.str());
+}
+
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const string& file)
+    : mData(nullptr),
+      mSize(0),
+      mFileHandle(INVALID_HANDLE_VALUE),
+      mMappingHandle(nullptr)
+{
+    mFileHandle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mFileHandle == INVALID_HANDLE_VALUE)
+        throwMapError(file);
+
+    LARGE_INTEGER size;
+    GetFileSizeEx(mFileHandle, &size);
+    mSize = (size_t)size.QuadPart;
+    if (mSize == 0)
+        return;
+
+    mMappingHandle = CreateFileMappingA(mFileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mMappingHandle == nullptr)
+    {
+        CloseHandle(mFileHandle);
+        throwMapError(file);
+    }
+    mData = static_cast<const uint8_t*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (mData == nullptr)
+    {
+        CloseHandle(mMappingHandle);
+        CloseHandle(mFileHandle);
+        throwMapError(file);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+        UnmapViewOfFile(mData);
+    if (mMappingHandle)
+        CloseHandle(mMappingHandle);
+    CloseHandle(mFileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const string& file)
+    : mData(nullptr),
+      mSize(0),
+      mFileDescriptor(-1)
+{
+    mFileDescriptor = open(file.c_str(), O_RDONLY);
+    if (mFileDescriptor == -1)
+        throwMapError(file);
+
+    struct stat info;
+    if (fstat(mFileDescriptor, &info) != 0)
+    {
+        close(mFileDescriptor);
+        throwMapError(file);
+    }
+    mSize = (size_t)info.st_size;
+    if (mSize == 0)
+        return;
+
+    void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFileDescriptor, 0);
+    if (data == MAP_FAILED)
+    {
+        close(mFileDescriptor);
+        throwMapError(file);
+    }
+    mData = static_cast<const uint8_t*>(data);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mData)
+        munmap(const_cast<uint8_t*>(mData), mSize);
+    close(mFileDescriptor);
+}
+
+#endif
+
+const uint8_t* MappedFile::getData() const
+{
+    return mData;
+}
+
+size_t MappedFile::getSize() const
+{
+    return mSize;
+}
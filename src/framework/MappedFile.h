@@ -0,0 +1,32 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// A read only memory mapping of an entire file. Pages are loaded on demand by the OS, so the
+// contents can be handed to GL without reading them into an intermediate buffer first
+class MappedFile
+{
+public:
+    MappedFile(const string& file);
+    ~MappedFile();
+
+    const uint8_t* getData() const;
+    size_t getSize() const;
+
+private:
+    const uint8_t* mData;
+    size_t mSize;
+
+#ifdef _WIN32
+    void* mFileHandle;
+    void* mMappingHandle;
+#else
+    int mFileDescriptor;
+#endif
+
+    // Non-copyable
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
@@ -3,101 +3,244 @@
  * Copyright (c) David Avedissian 2014-2015
  */
 #include "Common.h"
+#include "GLState.h"
+#include "IndexCodec.h"
+#include "MeshFile.h"
+#include "ResourceRegistry.h"
 #include "Mesh.h"
 
-Mesh::Mesh(vector<GLfloat> vertexData, vector<VertexAttribute> layout)
+#include <algorithm>
+
+Mesh::Mesh(const vector<GLfloat>& vertexData, const vector<VertexAttribute>& layout)
     : mVertexArrayObject(0),
       mVertexBufferObject(0),
       mElementBufferObject(0),
-      mVertexCount(0)
+      mInstanceBufferObject(0),
+      mIndexType(GL_UNSIGNED_INT),
+      mVertexCount(0),
+      mLayout(layout),
+      mVertexBufferSize(0),
+      mElementBufferSize(0),
+      mInstanceBufferSize(0)
 {
-    glGenVertexArrays(1, &mVertexArrayObject);
-    glBindVertexArray(mVertexArrayObject);
-
-    // Generate vertex buffer
-    glGenBuffers(1, &mVertexBufferObject);
-    glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(),
-        GL_STATIC_DRAW);
-
-    // Calculate vertex size
-    uint vertexSize = 0;
-    for (auto i = layout.begin(); i != layout.end(); i++)
-        vertexSize += i->count;
-
     // As we know the vertex size, set the vertex count
-    mVertexCount = vertexData.size() / vertexSize;
+    mVertexCount = vertexData.size() * sizeof(GLfloat) / mLayout.getStride();
 
-    // Set up vertex layout
-    uint attributeCounter = 0;
-    uint offset = 0;
-    for (auto i = layout.begin(); i != layout.end(); i++)
-    {
-        glEnableVertexAttribArray(attributeCounter);
-        glVertexAttribPointer(attributeCounter, i->count, i->type, GL_FALSE,
-                              vertexSize * sizeof(float), (void*)(offset * sizeof(float)));
-        attributeCounter++;
-        offset += i->count;
-    }
+    glGenVertexArrays(1, &mVertexArrayObject);
+    GLState::bindVertexArray(mVertexArrayObject);
+    createVertexBuffer(vertexData.data(), mVertexCount);
 }
 
-Mesh::Mesh(vector<GLfloat> vertexData, vector<GLuint> elementData,
-                           vector<VertexAttribute> layout)
+Mesh::Mesh(const vector<GLfloat>& vertexData, const vector<GLuint>& elementData,
+           const vector<VertexAttribute>& layout)
     : mVertexArrayObject(0),
       mVertexBufferObject(0),
       mElementBufferObject(0),
-      mVertexCount(elementData.size())
+      mInstanceBufferObject(0),
+      mIndexType(GL_UNSIGNED_INT),
+      mVertexCount(elementData.size()),
+      mLayout(layout),
+      mVertexBufferSize(0),
+      mElementBufferSize(0),
+      mInstanceBufferSize(0)
 {
     glGenVertexArrays(1, &mVertexArrayObject);
-    glBindVertexArray(mVertexArrayObject);
+    GLState::bindVertexArray(mVertexArrayObject);
+    createVertexBuffer(vertexData.data(), vertexData.size() * sizeof(GLfloat) / mLayout.getStride());
+    createElementBuffer(elementData);
+}
 
-    // Generate vertex buffer
-    glGenBuffers(1, &mVertexBufferObject);
-    glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
-    glBufferData(GL_ARRAY_BUFFER, vertexData.size() * sizeof(float), vertexData.data(),
-		GL_STATIC_DRAW);
+Mesh::Mesh(const void* vertexData, uint vertexCount, const VertexLayout& layout)
+    : mVertexArrayObject(0),
+      mVertexBufferObject(0),
+      mElementBufferObject(0),
+      mInstanceBufferObject(0),
+      mIndexType(GL_UNSIGNED_INT),
+      mVertexCount(vertexCount),
+      mLayout(layout),
+      mVertexBufferSize(0),
+      mElementBufferSize(0),
+      mInstanceBufferSize(0)
+{
+    glGenVertexArrays(1, &mVertexArrayObject);
+    GLState::bindVertexArray(mVertexArrayObject);
+    createVertexBuffer(vertexData, vertexCount);
+}
 
-    // Generate element buffer
-    glGenBuffers(1, &mElementBufferObject);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBufferObject);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, elementData.size() * sizeof(GLuint), elementData.data(),
-		GL_STATIC_DRAW);
+Mesh::Mesh(const void* vertexData, uint vertexCount, const vector<GLuint>& elementData,
+           const VertexLayout& layout)
+    : mVertexArrayObject(0),
+      mVertexBufferObject(0),
+      mElementBufferObject(0),
+      mInstanceBufferObject(0),
+      mIndexType(GL_UNSIGNED_INT),
+      mVertexCount(elementData.size()),
+      mLayout(layout),
+      mVertexBufferSize(0),
+      mElementBufferSize(0),
+      mInstanceBufferSize(0)
+{
+    glGenVertexArrays(1, &mVertexArrayObject);
+    GLState::bindVertexArray(mVertexArrayObject);
+    createVertexBuffer(vertexData, vertexCount);
+    createElementBuffer(elementData);
+}
 
-    // Calculate vertex size
-    uint vertexSize = 0;
-    for (auto i = layout.begin(); i != layout.end(); i++)
-        vertexSize += i->count;
+Mesh::Mesh(const MeshFile& file)
+    : mVertexArrayObject(0),
+      mVertexBufferObject(0),
+      mElementBufferObject(0),
+      mInstanceBufferObject(0),
+      mIndexType(GL_UNSIGNED_INT),
+      mVertexCount(0),
+      mLayout(file.getLayout()),
+      mVertexBufferSize(0),
+      mElementBufferSize(0),
+      mInstanceBufferSize(0)
+{
+    const MeshFileHeader& header = file.getHeader();
 
-    // Set up vertex layout
-    uint attributeCounter = 0;
-    uint offset = 0;
-    for (auto i = layout.begin(); i != layout.end(); i++)
+    glGenVertexArrays(1, &mVertexArrayObject);
+    GLState::bindVertexArray(mVertexArrayObject);
+    createVertexBuffer(file.getVertexData(), header.vertexCount);
+
+    if (header.indexCount == 0)
     {
-        glEnableVertexAttribArray(attributeCounter);
-        glVertexAttribPointer(attributeCounter, i->count, i->type, GL_FALSE,
-                              vertexSize * sizeof(float), (void*)(offset * sizeof(float)));
-        attributeCounter++;
-        offset += i->count;
+        mVertexCount = header.vertexCount;
+    }
+    else if (header.flags & MESH_FILE_COMPRESSED_INDICES)
+    {
+        vector<GLuint> elementData;
+        if (!codec::decodeIndices(static_cast<const uint8_t*>(file.getIndexData()),
+                                  header.indexDataSize, header.indexCount, header.vertexCount,
+                                  elementData))
+            throw std::runtime_error("Error: Unable to decode mesh indices");
+        mVertexCount = header.indexCount;
+        createElementBuffer(elementData);
+    }
+    else
+    {
+        mVertexCount = header.indexCount;
+        createElementBuffer(file.getIndexData(), header.indexCount, header.indexType);
     }
 }
 
 Mesh::~Mesh()
 {
+    glDeleteBuffers(1, &mInstanceBufferObject);
+    glDeleteBuffers(1, &mElementBufferObject);
+    glDeleteBuffers(1, &mVertexBufferObject);
+    GLState::forgetVertexArray(mVertexArrayObject);
+    glDeleteVertexArrays(1, &mVertexArrayObject);
+    ResourceRegistry::release(this);
 }
 
 void Mesh::bind()
 {
-    glBindVertexArray(mVertexArrayObject);
+    GLState::bindVertexArray(mVertexArrayObject);
 }
 
 void Mesh::draw()
 {
     if (mElementBufferObject != 0)
     {
-        glDrawElements(GL_TRIANGLES, mVertexCount, GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, mVertexCount, mIndexType, 0);
     }
     else
     {
         glDrawArrays(GL_TRIANGLES, 0, mVertexCount);
     }
 }
+
+void Mesh::drawRange(uint indexOffset, uint indexCount)
+{
+    uint indexSize = mIndexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+    glDrawElements(GL_TRIANGLES, indexCount, mIndexType, (void*)(size_t)(indexOffset * indexSize));
+}
+
+void Mesh::setInstanceLayout(const VertexLayout& layout)
+{
+    mInstanceLayout = layout;
+
+    GLState::bindVertexArray(mVertexArrayObject);
+    if (mInstanceBufferObject == 0)
+        glGenBuffers(1, &mInstanceBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceBufferObject);
+    mInstanceLayout.apply(mLayout.getAttributeCount(), 1);
+}
+
+void Mesh::setInstanceData(const void* instanceData, uint instanceCount)
+{
+    assert(mInstanceBufferObject != 0);
+
+    // Respecifying the buffer orphans the previous contents, so the driver doesn't have to wait
+    // for draws which are still using them
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceBufferObject);
+    mInstanceBufferSize = instanceCount * mInstanceLayout.getStride();
+    glBufferData(GL_ARRAY_BUFFER, mInstanceBufferSize, instanceData, GL_STREAM_DRAW);
+    trackMemory();
+}
+
+void Mesh::drawInstanced(uint instanceCount)
+{
+    if (mElementBufferObject != 0)
+    {
+        glDrawElementsInstanced(GL_TRIANGLES, mVertexCount, mIndexType, 0, instanceCount);
+    }
+    else
+    {
+        glDrawArraysInstanced(GL_TRIANGLES, 0, mVertexCount, instanceCount);
+    }
+}
+
+const VertexLayout& Mesh::getLayout() const
+{
+    return mLayout;
+}
+
+void Mesh::createVertexBuffer(const void* vertexData, uint vertexCount)
+{
+    // Generate vertex buffer
+    glGenBuffers(1, &mVertexBufferObject);
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
+    mVertexBufferSize = vertexCount * mLayout.getStride();
+    glBufferData(GL_ARRAY_BUFFER, mVertexBufferSize, vertexData, GL_STATIC_DRAW);
+    trackMemory();
+
+    // Set up vertex layout
+    mLayout.apply();
+}
+
+void Mesh::createElementBuffer(const vector<GLuint>& elementData)
+{
+    // Use 16 bit indices whenever every vertex can be addressed by them. 8 bit indices aren't
+    // used, as many GPUs can't fetch them natively and the driver would convert them on the CPU
+    GLuint maxIndex = elementData.empty() ? 0 : *std::max_element(elementData.begin(), elementData.end());
+    if (maxIndex <= 0xFFFF)
+    {
+        vector<GLushort> shortElementData(elementData.begin(), elementData.end());
+        createElementBuffer(shortElementData.data(), shortElementData.size(), GL_UNSIGNED_SHORT);
+    }
+    else
+    {
+        createElementBuffer(elementData.data(), elementData.size(), GL_UNSIGNED_INT);
+    }
+}
+
+void Mesh::createElementBuffer(const void* elementData, uint elementCount, GLenum indexType)
+{
+    // Generate element buffer
+    glGenBuffers(1, &mElementBufferObject);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mElementBufferObject);
+    mElementBufferSize =
+        elementCount * (indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mElementBufferSize, elementData, GL_STATIC_DRAW);
+    mIndexType = indexType;
+    trackMemory();
+}
+
+void Mesh::trackMemory()
+{
+    ResourceRegistry::track(RESOURCE_MESH, this,
+                            mVertexBufferSize + mElementBufferSize + mInstanceBufferSize);
+}
@@ -4,24 +4,53 @@
  */
 #pragma once
 
-struct VertexAttribute
-{
-    uint count;
-    GLenum type;
-};
+#include "VertexLayout.h"
+
+class MeshFile;
 
 class Mesh
 {
 public:
-    Mesh(vector<GLfloat> vertexData, vector<VertexAttribute> layout);
-    Mesh(vector<GLfloat> vertexData, vector<GLuint> elementData,
-                 vector<VertexAttribute> layout);
+    Mesh(const vector<GLfloat>& vertexData, const vector<VertexAttribute>& layout);
+    Mesh(const vector<GLfloat>& vertexData, const vector<GLuint>& elementData,
+         const vector<VertexAttribute>& layout);
+
+    // Construct from tightly packed vertices in an arbitrary layout
+    Mesh(const void* vertexData, uint vertexCount, const VertexLayout& layout);
+    Mesh(const void* vertexData, uint vertexCount, const vector<GLuint>& elementData,
+         const VertexLayout& layout);
+
+    // Upload directly from a mapped mesh file
+    Mesh(const MeshFile& file);
     ~Mesh();
 
     void bind();
     void draw();
 
+    // Draw a range of the element buffer, such as a single level of detail
+    void drawRange(uint indexOffset, uint indexCount);
+
+    // Instanced drawing. Per-instance attributes are assigned the locations following the
+    // per-vertex attributes, and advance once per instance
+    void setInstanceLayout(const VertexLayout& layout);
+    void setInstanceData(const void* instanceData, uint instanceCount);
+    void drawInstanced(uint instanceCount);
+
+    const VertexLayout& getLayout() const;
+
 private:
     GLuint mVertexArrayObject, mVertexBufferObject, mElementBufferObject;
+    GLuint mInstanceBufferObject;
+    GLenum mIndexType;
     uint mVertexCount;
+    VertexLayout mLayout;
+    VertexLayout mInstanceLayout;
+
+    // Buffer sizes in bytes, reported to the ResourceRegistry
+    uint mVertexBufferSize, mElementBufferSize, mInstanceBufferSize;
+
+    void createVertexBuffer(const void* vertexData, uint vertexCount);
+    void createElementBuffer(const vector<GLuint>& elementData);
+    void createElementBuffer(const void* elementData, uint elementCount, GLenum indexType);
+    void trackMemory();
 };
@@ -0,0 +1,206 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "IndexCodec.h"
+#include "MeshFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+void throwFormatError(const string& filename, const string& reason)
+{
+    stringstream err;
+    err << "Error: Invalid mesh file '" << filename << "': " << reason << endl;
+    throw std::runtime_error(err.str());
+}
+
+// Whether a blob lies within a file of 'fileSize' bytes, without overflowing
+bool isBlobInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+{
+    return offset % MESH_FILE_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+}
+
+template <class T> bool areIndicesInRange(const void* data, uint indexCount, uint vertexCount)
+{
+    const T* indices = static_cast<const T*>(data);
+    for (uint i = 0; i < indexCount; i++)
+    {
+        if (indices[i] >= vertexCount)
+            return false;
+    }
+    return true;
+}
+
+uint64_t alignBlob(uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) & ~(uint64_t)(MESH_FILE_ALIGNMENT - 1);
+}
+
+}
+
+MeshFile::MeshFile(const string& filename) : mFile(filename), mHeader(nullptr)
+{
+    if (mFile.getSize() < sizeof(MeshFileHeader))
+        throwFormatError(filename, "file is too small");
+    mHeader = reinterpret_cast<const MeshFileHeader*>(mFile.getData());
+
+    if (mHeader->magic != MESH_FILE_MAGIC)
+        throwFormatError(filename, "bad magic number");
+    if (mHeader->version != MESH_FILE_VERSION)
+        throwFormatError(filename, "unsupported version");
+    if (mHeader->attributeCount == 0 || mHeader->attributeCount > MESH_FILE_MAX_ATTRIBUTES)
+        throwFormatError(filename, "bad attribute count");
+    if (mHeader->indexType != GL_UNSIGNED_SHORT && mHeader->indexType != GL_UNSIGNED_INT)
+        throwFormatError(filename, "bad index type");
+    if (!isBlobInFile(mHeader->vertexDataOffset, mHeader->vertexDataSize, mFile.getSize()) ||
+        !isBlobInFile(mHeader->indexDataOffset, mHeader->indexDataSize, mFile.getSize()))
+        throwFormatError(filename, "data blobs exceed the size of the file");
+    if (mHeader->vertexDataSize < (uint64_t)mHeader->vertexCount * getLayout().getStride())
+        throwFormatError(filename, "vertex data is truncated");
+
+    // Compressed indices are range checked as they're decoded
+    if (!(mHeader->flags & MESH_FILE_COMPRESSED_INDICES) && mHeader->indexCount > 0)
+    {
+        bool shortIndices = mHeader->indexType == GL_UNSIGNED_SHORT;
+        uint64_t indexSize = shortIndices ? sizeof(GLushort) : sizeof(GLuint);
+        if (mHeader->indexDataSize < (uint64_t)mHeader->indexCount * indexSize)
+            throwFormatError(filename, "index data is truncated");
+        bool inRange = shortIndices ? areIndicesInRange<GLushort>(getIndexData(),
+                                                                  mHeader->indexCount,
+                                                                  mHeader->vertexCount)
+                                    : areIndicesInRange<GLuint>(getIndexData(),
+                                                                mHeader->indexCount,
+                                                                mHeader->vertexCount);
+        if (!inRange)
+            throwFormatError(filename, "indices refer to vertices which don't exist");
+    }
+}
+
+MeshFile::~MeshFile()
+{
+}
+
+const MeshFileHeader& MeshFile::getHeader() const
+{
+    return *mHeader;
+}
+
+VertexLayout MeshFile::getLayout() const
+{
+    VertexLayout layout;
+    for (uint i = 0; i < mHeader->attributeCount; i++)
+    {
+        const MeshFileAttribute& attribute = mHeader->attributes[i];
+        layout.add(attribute.count, attribute.type, attribute.normalised != 0);
+    }
+    return layout;
+}
+
+const void* MeshFile::getVertexData() const
+{
+    return mFile.getData() + mHeader->vertexDataOffset;
+}
+
+const void* MeshFile::getIndexData() const
+{
+    return mHeader->indexCount > 0 ? mFile.getData() + mHeader->indexDataOffset : nullptr;
+}
+
+glm::vec3 MeshFile::getBoundsMin() const
+{
+    return glm::make_vec3(mHeader->boundsMin);
+}
+
+glm::vec3 MeshFile::getBoundsMax() const
+{
+    return glm::make_vec3(mHeader->boundsMax);
+}
+
+glm::vec3 MeshFile::getPositionOffset() const
+{
+    return glm::make_vec3(mHeader->positionOffset);
+}
+
+glm::vec3 MeshFile::getPositionScale() const
+{
+    return glm::make_vec3(mHeader->positionScale);
+}
+
+void MeshFile::write(const string& filename, const MeshFileContents& contents)
+{
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.vertexCount = contents.vertexCount;
+    header.indexCount = contents.indices.size();
+
+    // Layout
+    if (contents.layout.getAttributeCount() > MESH_FILE_MAX_ATTRIBUTES)
+        throwFormatError(filename, "too many vertex attributes");
+    header.attributeCount = contents.layout.getAttributeCount();
+    for (uint i = 0; i < header.attributeCount; i++)
+    {
+        const VertexAttribute& attribute = contents.layout.getAttribute(i);
+        header.attributes[i].count = attribute.count;
+        header.attributes[i].type = attribute.type;
+        header.attributes[i].normalised = attribute.normalised ? 1 : 0;
+    }
+
+    // Bounds
+    for (int c = 0; c < 3; c++)
+    {
+        header.boundsMin[c] = contents.boundsMin[c];
+        header.boundsMax[c] = contents.boundsMax[c];
+        header.positionOffset[c] = contents.positionOffset[c];
+        header.positionScale[c] = contents.positionScale[c];
+    }
+
+    // Indices are stored at the smallest width Mesh will use, or compressed
+    vector<uint8_t> indexData;
+    GLuint maxIndex = contents.indices.empty() ? 0 :
+        *std::max_element(contents.indices.begin(), contents.indices.end());
+    header.indexType = maxIndex <= 0xFFFF ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    if (contents.compressIndices)
+    {
+        header.flags |= MESH_FILE_COMPRESSED_INDICES;
+        indexData = codec::encodeIndices(contents.indices);
+    }
+    else if (header.indexType == GL_UNSIGNED_SHORT)
+    {
+        vector<GLushort> shortIndices(contents.indices.begin(), contents.indices.end());
+        indexData.resize(shortIndices.size() * sizeof(GLushort));
+        memcpy(indexData.data(), shortIndices.data(), indexData.size());
+    }
+    else
+    {
+        indexData.resize(contents.indices.size() * sizeof(GLuint));
+        memcpy(indexData.data(), contents.indices.data(), indexData.size());
+    }
+
+    // Blob placement
+    header.vertexDataOffset = alignBlob(sizeof(MeshFileHeader));
+    header.vertexDataSize = (uint64_t)contents.vertexCount * contents.layout.getStride();
+    header.indexDataOffset = alignBlob(header.vertexDataOffset + header.vertexDataSize);
+    header.indexDataSize = indexData.size();
+
+    // Write the file
+    std::ofstream file(filename, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+    {
+        stringstream err;
+        err << "Error: Unable to open file '" << filename << "' for writing" << endl;
+        throw std::runtime_error(err.str());
+    }
+    const char padding[MESH_FILE_ALIGNMENT] = {0};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(padding, header.vertexDataOffset - sizeof(header));
+    file.write(static_cast<const char*>(contents.vertexData), header.vertexDataSize);
+    file.write(padding, header.indexDataOffset - (header.vertexDataOffset + header.vertexDataSize));
+    file.write(reinterpret_cast<const char*>(indexData.data()), indexData.size());
+}
@@ -0,0 +1,97 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include "MappedFile.h"
+#include "VertexLayout.h"
+
+// Binary mesh file format. All values are little endian, and the vertex and index blobs start on
+// MESH_FILE_ALIGNMENT byte boundaries so they can be uploaded straight from a memory mapping
+#define MESH_FILE_MAGIC 0x4853454D // "MESH"
+#define MESH_FILE_VERSION 1
+#define MESH_FILE_ALIGNMENT 16
+#define MESH_FILE_MAX_ATTRIBUTES 8
+
+enum MeshFileFlags
+{
+    // Indices are encoded with codec::encodeIndices
+    MESH_FILE_COMPRESSED_INDICES = 1
+};
+
+struct MeshFileAttribute
+{
+    uint32_t count;
+    uint32_t type;
+    uint32_t normalised;
+};
+
+struct MeshFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t flags;
+
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexType;
+
+    uint32_t attributeCount;
+    MeshFileAttribute attributes[MESH_FILE_MAX_ATTRIBUTES];
+
+    // Bounding box of the decoded positions
+    float boundsMin[3];
+    float boundsMax[3];
+
+    // Position dequantisation parameters, see QuantisedVertices
+    float positionOffset[3];
+    float positionScale[3];
+    uint32_t reserved; // Aligns the blob fields to 8 bytes
+
+    uint64_t vertexDataOffset;
+    uint64_t vertexDataSize;
+    uint64_t indexDataOffset;
+    uint64_t indexDataSize;
+};
+
+static_assert(sizeof(MeshFileHeader) == 208, "MeshFileHeader must match the file layout");
+
+// Everything needed to write a mesh file
+struct MeshFileContents
+{
+    VertexLayout layout;
+    const void* vertexData;
+    uint vertexCount;
+    vector<GLuint> indices;
+    bool compressIndices;
+
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+};
+
+class MeshFile
+{
+public:
+    // Map and validate a mesh file
+    MeshFile(const string& filename);
+    ~MeshFile();
+
+    const MeshFileHeader& getHeader() const;
+    VertexLayout getLayout() const;
+    const void* getVertexData() const;
+    const void* getIndexData() const;
+
+    glm::vec3 getBoundsMin() const;
+    glm::vec3 getBoundsMax() const;
+    glm::vec3 getPositionOffset() const;
+    glm::vec3 getPositionScale() const;
+
+    static void write(const string& filename, const MeshFileContents& contents);
+
+private:
+    MappedFile mFile;
+    const MeshFileHeader* mHeader;
+};
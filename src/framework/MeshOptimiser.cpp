@@ -0,0 +1,339 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "MeshOptimiser.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace optimiser
+{
+
+namespace
+{
+
+// Forsyth scoring parameters, tuned for a 32 entry LRU cache
+const uint kCacheSize = 32;
+const float kCacheDecayPower = 1.5f;
+const float kLastTriScore = 0.75f;
+const float kValenceBoostScale = 2.0f;
+const float kValenceBoostPower = 0.5f;
+
+float vertexScore(int cachePosition, uint remainingValence)
+{
+    // Vertices with no triangles left to draw shouldn't attract any more
+    if (remainingValence == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The most recent triangle's vertices get a fixed score, so the next triangle doesn't
+        // just reuse the same edge
+        if (cachePosition < 3)
+        {
+            score = kLastTriScore;
+        }
+        else
+        {
+            float scale = 1.0f / (kCacheSize - 3);
+            score = powf(1.0f - (cachePosition - 3) * scale, kCacheDecayPower);
+        }
+    }
+
+    // Boost vertices with few triangles remaining, to avoid leaving isolated triangles behind
+    score += kValenceBoostScale * powf((float)remainingValence, -kValenceBoostPower);
+    return score;
+}
+
+struct Cluster
+{
+    uint start;
+    uint end;
+    float sortKey;
+};
+
+bool operator<(const Cluster& a, const Cluster& b)
+{
+    return a.sortKey > b.sortKey;
+}
+
+}
+
+VertexCacheStatistics analyseVertexCache(const vector<GLuint>& indices, uint vertexCount,
+                                         uint cacheSize)
+{
+    VertexCacheStatistics stats;
+    stats.transformedVertices = 0;
+
+    // A vertex is in the FIFO if fewer than 'cacheSize' misses have happened since it was added
+    vector<uint> cacheTimestamps(vertexCount, 0);
+    uint timestamp = cacheSize + 1;
+    for (auto i = indices.begin(); i != indices.end(); i++)
+    {
+        if (timestamp - cacheTimestamps[*i] > cacheSize)
+        {
+            cacheTimestamps[*i] = timestamp++;
+            stats.transformedVertices++;
+        }
+    }
+
+    uint triangleCount = indices.size() / 3;
+    stats.acmr = triangleCount > 0 ? (float)stats.transformedVertices / triangleCount : 0.0f;
+    stats.atvr = vertexCount > 0 ? (float)stats.transformedVertices / vertexCount : 0.0f;
+    return stats;
+}
+
+void optimiseVertexCache(vector<GLuint>& indices, uint vertexCount)
+{
+    uint triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // Build the list of triangles which use each vertex
+    vector<uint> remainingValence(vertexCount, 0);
+    for (auto i = indices.begin(); i != indices.end(); i++)
+        remainingValence[*i]++;
+    vector<uint> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingValence[v];
+    vector<uint> adjacency(indices.size());
+    vector<uint> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint t = 0; t < triangleCount; t++)
+    {
+        for (uint k = 0; k < 3; k++)
+            adjacency[fill[indices[t * 3 + k]]++] = t;
+    }
+
+    // Initial scores
+    vector<int> cachePosition(vertexCount, -1);
+    vector<float> vertexScores(vertexCount);
+    for (uint v = 0; v < vertexCount; v++)
+        vertexScores[v] = vertexScore(-1, remainingValence[v]);
+    vector<float> triangleScores(triangleCount);
+    vector<bool> emitted(triangleCount, false);
+    int bestTriangle = 0;
+    for (uint t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                            vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > triangleScores[bestTriangle])
+            bestTriangle = t;
+    }
+
+    vector<GLuint> output;
+    output.reserve(indices.size());
+    vector<GLuint> cache, newCache;
+    cache.reserve(kCacheSize + 3);
+    newCache.reserve(kCacheSize + 3);
+    uint scanPosition = 0;
+    while (output.size() < indices.size())
+    {
+        // If no triangle in the cache is usable, fall back to the next unemitted triangle
+        if (bestTriangle < 0)
+        {
+            while (emitted[scanPosition])
+                scanPosition++;
+            bestTriangle = scanPosition;
+        }
+
+        // Emit the triangle and remove it from the adjacency of its vertices
+        const GLuint* triangle = &indices[bestTriangle * 3];
+        emitted[bestTriangle] = true;
+        newCache.clear();
+        for (uint k = 0; k < 3; k++)
+        {
+            GLuint v = triangle[k];
+            output.push_back(v);
+            newCache.push_back(v);
+
+            uint* begin = &adjacency[adjacencyOffsets[v]];
+            uint* end = begin + remainingValence[v];
+            std::swap(*std::find(begin, end, (uint)bestTriangle), *(end - 1));
+            remainingValence[v]--;
+        }
+
+        // Move the triangle's vertices to the front of the LRU cache
+        for (auto i = cache.begin(); i != cache.end(); i++)
+        {
+            if (*i != triangle[0] && *i != triangle[1] && *i != triangle[2])
+                newCache.push_back(*i);
+        }
+
+        // Rescore the vertices which moved, including the ones which fell out of the cache
+        for (uint i = 0; i < newCache.size(); i++)
+        {
+            GLuint v = newCache[i];
+            cachePosition[v] = i < kCacheSize ? (int)i : -1;
+            vertexScores[v] = vertexScore(cachePosition[v], remainingValence[v]);
+        }
+
+        // Rescore the affected triangles, and pick the best one to emit next
+        bestTriangle = -1;
+        float bestScore = -1.0f;
+        for (auto i = newCache.begin(); i != newCache.end(); i++)
+        {
+            uint* begin = &adjacency[adjacencyOffsets[*i]];
+            uint* end = begin + remainingValence[*i];
+            for (uint* t = begin; t != end; t++)
+            {
+                const GLuint* other = &indices[*t * 3];
+                triangleScores[*t] = vertexScores[other[0]] + vertexScores[other[1]] +
+                                     vertexScores[other[2]];
+                if (triangleScores[*t] > bestScore)
+                {
+                    bestScore = triangleScores[*t];
+                    bestTriangle = *t;
+                }
+            }
+        }
+
+        if (newCache.size() > kCacheSize)
+            newCache.resize(kCacheSize);
+        cache.swap(newCache);
+    }
+
+    indices.swap(output);
+}
+
+void optimiseOverdraw(vector<GLuint>& indices, const GLfloat* positions, uint stride,
+                      uint vertexCount, float threshold)
+{
+    const uint cacheSize = 16;
+    uint triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+    float meshAcmr = analyseVertexCache(indices, vertexCount, cacheSize).acmr;
+
+    // Split the triangles into clusters. A cluster starts wherever the cache would have to be
+    // refilled anyway, or where the cluster's ACMR has dropped enough that a split is cheap. The
+    // cache is simulated from cold for each cluster, as they are about to be reordered
+    vector<Cluster> clusters;
+    vector<uint> cacheTimestamps(vertexCount, 0);
+    uint timestamp = 0;
+    uint clusterStart = 0, clusterMisses = 0;
+    for (uint t = 0; t < triangleCount; t++)
+    {
+        if (t == clusterStart)
+        {
+            timestamp += cacheSize + 1;
+            clusterMisses = 0;
+        }
+
+        uint misses = 0;
+        for (uint k = 0; k < 3; k++)
+        {
+            GLuint v = indices[t * 3 + k];
+            if (timestamp - cacheTimestamps[v] > cacheSize)
+            {
+                cacheTimestamps[v] = timestamp++;
+                misses++;
+            }
+        }
+        clusterMisses += misses;
+
+        bool hardBoundary = misses == 3 && t > clusterStart;
+        if (hardBoundary)
+        {
+            Cluster cluster = {clusterStart, t, 0.0f};
+            clusters.push_back(cluster);
+            clusterStart = t;
+            timestamp += cacheSize + 1;
+            cacheTimestamps[indices[t * 3]] = timestamp++;
+            cacheTimestamps[indices[t * 3 + 1]] = timestamp++;
+            cacheTimestamps[indices[t * 3 + 2]] = timestamp++;
+            clusterMisses = 3;
+        }
+        else if (clusterMisses <= threshold * meshAcmr * (t - clusterStart + 1))
+        {
+            Cluster cluster = {clusterStart, t + 1, 0.0f};
+            clusters.push_back(cluster);
+            clusterStart = t + 1;
+        }
+    }
+    if (clusterStart < triangleCount)
+    {
+        Cluster cluster = {clusterStart, triangleCount, 0.0f};
+        clusters.push_back(cluster);
+    }
+
+    // Compute the area weighted centroid of the mesh
+    vector<glm::vec3> triangleCentroids(triangleCount), triangleNormals(triangleCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (uint t = 0; t < triangleCount; t++)
+    {
+        glm::vec3 p0 = glm::make_vec3(positions + indices[t * 3] * stride);
+        glm::vec3 p1 = glm::make_vec3(positions + indices[t * 3 + 1] * stride);
+        glm::vec3 p2 = glm::make_vec3(positions + indices[t * 3 + 2] * stride);
+
+        // The cross product has a length of twice the triangle's area
+        triangleNormals[t] = glm::cross(p1 - p0, p2 - p0);
+        triangleCentroids[t] = (p0 + p1 + p2) / 3.0f;
+        float area = glm::length(triangleNormals[t]);
+        meshCentroid += triangleCentroids[t] * area;
+        meshArea += area;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters which face away from the centre of the mesh are likely to occlude the rest of it,
+    // so draw them first
+    for (auto c = clusters.begin(); c != clusters.end(); c++)
+    {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (uint t = c->start; t < c->end; t++)
+        {
+            float triangleArea = glm::length(triangleNormals[t]);
+            centroid += triangleCentroids[t] * triangleArea;
+            normal += triangleNormals[t];
+            area += triangleArea;
+        }
+        if (area > 0.0f)
+            centroid /= area;
+        float normalLength = glm::length(normal);
+        c->sortKey = normalLength > 0.0f ?
+            glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end());
+
+    vector<GLuint> output;
+    output.reserve(indices.size());
+    for (auto c = clusters.begin(); c != clusters.end(); c++)
+        output.insert(output.end(), indices.begin() + c->start * 3, indices.begin() + c->end * 3);
+    indices.swap(output);
+}
+
+uint optimiseVertexFetch(void* vertexData, uint vertexCount, uint vertexSize,
+                         vector<GLuint>& indices)
+{
+    const GLuint unused = ~0u;
+
+    // Assign new vertex indices in order of first use
+    vector<GLuint> remap(vertexCount, unused);
+    uint newVertexCount = 0;
+    for (auto i = indices.begin(); i != indices.end(); i++)
+    {
+        if (remap[*i] == unused)
+            remap[*i] = newVertexCount++;
+        *i = remap[*i];
+    }
+
+    // Move the vertex data into place
+    uint8_t* data = static_cast<uint8_t*>(vertexData);
+    vector<uint8_t> reordered(newVertexCount * vertexSize);
+    for (uint v = 0; v < vertexCount; v++)
+    {
+        if (remap[v] != unused)
+            memcpy(&reordered[remap[v] * vertexSize], data + v * vertexSize, vertexSize);
+    }
+    if (!reordered.empty())
+        memcpy(data, reordered.data(), reordered.size());
+
+    return newVertexCount;
+}
+
+}
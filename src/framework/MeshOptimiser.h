@@ -0,0 +1,42 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// Post-transform vertex cache efficiency of an index buffer
+struct VertexCacheStatistics
+{
+    uint transformedVertices;
+
+    // Average cache miss ratio: transformed vertices per triangle. 0.5 is optimal for a
+    // regular grid, 3.0 is the worst case
+    float acmr;
+
+    // Average transform to vertex ratio: transformed vertices per unique vertex, where 1.0 is optimal
+    float atvr;
+};
+
+namespace optimiser {
+
+// Simulate a FIFO post-transform cache of the specified size over an index buffer
+VertexCacheStatistics analyseVertexCache(const vector<GLuint>& indices, uint vertexCount,
+                                         uint cacheSize = 16);
+
+// Reorder triangles for post-transform cache locality using Tom Forsyth's linear speed
+// vertex cache optimisation
+void optimiseVertexCache(vector<GLuint>& indices, uint vertexCount);
+
+// Reorder clusters of cache optimised triangles so that outward facing clusters are drawn first,
+// reducing overdraw (Sander et al, "Fast Triangle Reordering for Vertex Locality and Reduced
+// Overdraw"). Positions are read as 3 floats every 'stride' floats. A threshold above 1 allows
+// the ACMR to rise by that factor in exchange for finer clusters
+void optimiseOverdraw(vector<GLuint>& indices, const GLfloat* positions, uint stride,
+                      uint vertexCount, float threshold = 1.05f);
+
+// Reorder vertices in the order they are first referenced by the index buffer, remapping the
+// indices to match. Unreferenced vertices are removed. Returns the new vertex count
+uint optimiseVertexFetch(void* vertexData, uint vertexCount, uint vertexSize,
+                         vector<GLuint>& indices);
+
+}
@@ -0,0 +1,159 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "MeshQuantiser.h"
+
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+
+namespace quantiser
+{
+
+namespace
+{
+
+glm::vec2 signNotZero(const glm::vec2& v)
+{
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+// glm's snorm16 helpers mishandle negative values, so use the GL 4.2 conversion rules directly
+int16_t packSnorm16(float v)
+{
+    return (int16_t)roundf(glm::clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+float unpackSnorm16(int16_t v)
+{
+    return glm::max(v / 32767.0f, -1.0f);
+}
+
+template <class T> void write(vector<uint8_t>& data, size_t offset, const T& value)
+{
+    memcpy(&data[offset], &value, sizeof(T));
+}
+
+}
+
+QuantisedVertices quantiseVertices(const vector<GLfloat>& vertexData, const FloatVertexFormat& format)
+{
+    assert(format.positionOffset >= 0);
+
+    QuantisedVertices out;
+    out.vertexCount = vertexData.size() / format.stride;
+    out.error.maxPosition = 0.0f;
+    out.error.maxNormalAngle = 0.0f;
+    out.error.maxTexcoord = 0.0f;
+
+    // Build the quantised layout
+    out.layout.add(3, GL_UNSIGNED_SHORT, true);
+    if (format.normalOffset >= 0)
+        out.layout.add(2, GL_SHORT, true);
+    if (format.texcoordOffset >= 0)
+        out.layout.add(2, GL_HALF_FLOAT);
+    out.originalVertexSize = format.stride * sizeof(GLfloat);
+    out.quantisedVertexSize = out.layout.getStride();
+    out.data.resize(out.vertexCount * out.quantisedVertexSize, 0);
+
+    // Calculate the bounding box, which positions are quantised relative to
+    glm::vec3 min(0.0f), max(0.0f);
+    for (uint v = 0; v < out.vertexCount; v++)
+    {
+        glm::vec3 position = glm::make_vec3(&vertexData[v * format.stride + format.positionOffset]);
+        min = v == 0 ? position : glm::min(min, position);
+        max = v == 0 ? position : glm::max(max, position);
+    }
+    out.positionOffset = min;
+    out.positionScale = max - min;
+
+    // Encode each vertex, and decode it again to measure the error
+    uint normalAttribute = 1;
+    uint texcoordAttribute = format.normalOffset >= 0 ? 2 : 1;
+    for (uint v = 0; v < out.vertexCount; v++)
+    {
+        const GLfloat* in = &vertexData[v * format.stride];
+        size_t base = v * out.quantisedVertexSize;
+
+        // Position
+        glm::vec3 position = glm::make_vec3(in + format.positionOffset);
+        glm::vec3 decodedPosition;
+        for (int c = 0; c < 3; c++)
+        {
+            float scale = out.positionScale[c];
+            float t = scale > 0.0f ? (position[c] - out.positionOffset[c]) / scale : 0.0f;
+            uint16_t q = glm::packUnorm1x16(t);
+            write(out.data, base + c * sizeof(uint16_t), q);
+            decodedPosition[c] = out.positionOffset[c] + glm::unpackUnorm1x16(q) * scale;
+        }
+        out.error.maxPosition = glm::max(out.error.maxPosition,
+                                         glm::length(decodedPosition - position));
+
+        // Normal
+        if (format.normalOffset >= 0)
+        {
+            glm::vec3 normal = glm::normalize(glm::make_vec3(in + format.normalOffset));
+            glm::vec2 encoded = encodeOctahedral(normal);
+            int16_t qx = packSnorm16(encoded.x);
+            int16_t qy = packSnorm16(encoded.y);
+            size_t offset = base + out.layout.getOffset(normalAttribute);
+            write(out.data, offset, qx);
+            write(out.data, offset + sizeof(int16_t), qy);
+
+            glm::vec3 decoded = decodeOctahedral(
+                glm::vec2(unpackSnorm16(qx), unpackSnorm16(qy)));
+            float angle = glm::degrees(acosf(glm::clamp(glm::dot(normal, decoded), -1.0f, 1.0f)));
+            out.error.maxNormalAngle = glm::max(out.error.maxNormalAngle, angle);
+        }
+
+        // Texcoord
+        if (format.texcoordOffset >= 0)
+        {
+            size_t offset = base + out.layout.getOffset(texcoordAttribute);
+            for (int c = 0; c < 2; c++)
+            {
+                float t = in[format.texcoordOffset + c];
+                uint16_t q = glm::packHalf1x16(t);
+                write(out.data, offset + c * sizeof(uint16_t), q);
+                out.error.maxTexcoord = glm::max(out.error.maxTexcoord,
+                                                 fabsf(glm::unpackHalf1x16(q) - t));
+            }
+        }
+    }
+
+    return out;
+}
+
+glm::vec2 encodeOctahedral(const glm::vec3& normal)
+{
+    glm::vec3 n = normal / (fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z));
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.0f)
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * signNotZero(p);
+    return p;
+}
+
+glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+{
+    glm::vec3 n(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+    if (n.z < 0.0f)
+    {
+        glm::vec2 p = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * signNotZero(glm::vec2(n.x, n.y));
+        n.x = p.x;
+        n.y = p.y;
+    }
+    return glm::normalize(n);
+}
+
+void printReport(const string& name, const QuantisedVertices& vertices)
+{
+    INFO << "Quantised '" << name << "': " << vertices.vertexCount << " vertices, "
+         << vertices.originalVertexSize << " -> " << vertices.quantisedVertexSize
+         << " bytes per vertex" << endl;
+    INFO << "    Max error: position " << vertices.error.maxPosition
+         << ", normal " << vertices.error.maxNormalAngle << " degrees"
+         << ", texcoord " << vertices.error.maxTexcoord << endl;
+}
+
+}
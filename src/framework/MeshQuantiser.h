@@ -0,0 +1,57 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include "VertexLayout.h"
+
+// Where each component lives within an interleaved float vertex, in floats. Components that
+// are not present have an offset of -1
+struct FloatVertexFormat
+{
+    uint stride;
+    int positionOffset;
+    int normalOffset;
+    int texcoordOffset;
+};
+
+// Worst case error introduced by quantisation, measured by decoding every vertex
+struct QuantisationError
+{
+    float maxPosition;
+    float maxNormalAngle; // Degrees
+    float maxTexcoord;
+};
+
+// Quantised vertex data, ready to be passed to Mesh. Positions are unorm16 relative to the
+// bounding box, normals are octahedral snorm16 and texcoords are half floats. The attributes are
+// always ordered position, normal, texcoord, skipping any that were not in the input
+struct QuantisedVertices
+{
+    vector<uint8_t> data;
+    uint vertexCount;
+    VertexLayout layout;
+
+    // Decode with 'position = positionOffset + position * positionScale'
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
+
+    QuantisationError error;
+    uint originalVertexSize;
+    uint quantisedVertexSize;
+};
+
+namespace quantiser {
+
+// Quantise interleaved float vertex data
+QuantisedVertices quantiseVertices(const vector<GLfloat>& vertexData, const FloatVertexFormat& format);
+
+// Octahedral normal encoding, mapping a unit vector to [-1, 1]^2
+glm::vec2 encodeOctahedral(const glm::vec3& normal);
+glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+// Log the vertex sizes and error bounds of a quantised mesh
+void printReport(const string& name, const QuantisedVertices& vertices);
+
+}
@@ -0,0 +1,358 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <tuple>
+
+namespace simplifier
+{
+
+namespace
+{
+
+// Symmetric 4x4 matrix measuring the sum of squared distances to a set of planes
+struct Quadric
+{
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+
+    Quadric() : a00(0), a01(0), a02(0), a11(0), a12(0), a22(0), b0(0), b1(0), b2(0), c(0)
+    {
+    }
+
+    Quadric(const glm::vec3& n, float d)
+        : a00(n.x * n.x), a01(n.x * n.y), a02(n.x * n.z),
+          a11(n.y * n.y), a12(n.y * n.z), a22(n.z * n.z),
+          b0(n.x * d), b1(n.y * d), b2(n.z * d),
+          c(d * d)
+    {
+    }
+
+    Quadric& operator+=(const Quadric& other)
+    {
+        a00 += other.a00; a01 += other.a01; a02 += other.a02;
+        a11 += other.a11; a12 += other.a12; a22 += other.a22;
+        b0 += other.b0; b1 += other.b1; b2 += other.b2;
+        c += other.c;
+        return *this;
+    }
+
+    double evaluate(const glm::vec3& p) const
+    {
+        double x = p.x, y = p.y, z = p.z;
+        double result = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z +
+                        a11 * y * y + 2.0 * a12 * y * z + a22 * z * z +
+                        2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return glm::max(result, 0.0);
+    }
+};
+
+struct Collapse
+{
+    GLuint from;
+    GLuint to;
+    double cost;
+};
+
+bool operator<(const Collapse& a, const Collapse& b)
+{
+    return a.cost < b.cost;
+}
+
+glm::vec3 getPosition(const GLfloat* positions, uint stride, GLuint v)
+{
+    return glm::make_vec3(positions + v * stride);
+}
+
+// Map every vertex to the first vertex with an identical position, so that vertices split by
+// normals or texcoords are treated as a single point on the surface
+vector<GLuint> weldPositions(const GLfloat* positions, uint stride, uint vertexCount)
+{
+    vector<GLuint> canonical(vertexCount);
+    std::map<std::tuple<float, float, float>, GLuint> firstVertex;
+    for (uint v = 0; v < vertexCount; v++)
+    {
+        const GLfloat* p = positions + v * stride;
+        auto result = firstVertex.insert(std::make_pair(std::make_tuple(p[0], p[1], p[2]), v));
+        canonical[v] = result.first->second;
+    }
+    return canonical;
+}
+
+// Lock vertices which are split by attribute seams, or which lie on an open or non-manifold edge
+vector<bool> findLockedVertices(const vector<GLuint>& indices, const vector<GLuint>& canonical)
+{
+    uint vertexCount = canonical.size();
+    vector<bool> locked(vertexCount, false);
+
+    vector<uint> positionUses(vertexCount, 0);
+    for (uint v = 0; v < vertexCount; v++)
+        positionUses[canonical[v]]++;
+
+    std::map<std::pair<GLuint, GLuint>, uint> edgeUses;
+    for (uint i = 0; i < indices.size(); i += 3)
+    {
+        for (uint k = 0; k < 3; k++)
+        {
+            GLuint a = canonical[indices[i + k]], b = canonical[indices[i + (k + 1) % 3]];
+            edgeUses[std::make_pair(glm::min(a, b), glm::max(a, b))]++;
+        }
+    }
+    vector<bool> lockedPositions(vertexCount, false);
+    for (auto e = edgeUses.begin(); e != edgeUses.end(); e++)
+    {
+        if (e->second != 2)
+            lockedPositions[e->first.first] = lockedPositions[e->first.second] = true;
+    }
+
+    for (uint v = 0; v < vertexCount; v++)
+        locked[v] = positionUses[canonical[v]] > 1 || lockedPositions[canonical[v]];
+    return locked;
+}
+
+// Check whether moving 'from' onto 'to' would flip any of the triangles around 'from' which
+// survive the collapse
+bool collapseFlipsTriangles(const vector<GLuint>& indices, const vector<uint>& triangles,
+                            const vector<GLuint>& canonical, const GLfloat* positions,
+                            uint stride, GLuint from, GLuint to)
+{
+    glm::vec3 target = getPosition(positions, stride, to);
+    for (auto t = triangles.begin(); t != triangles.end(); t++)
+    {
+        const GLuint* triangle = &indices[*t * 3];
+        if (canonical[triangle[0]] == canonical[to] || canonical[triangle[1]] == canonical[to] ||
+            canonical[triangle[2]] == canonical[to])
+            continue;
+
+        glm::vec3 p[3];
+        for (uint k = 0; k < 3; k++)
+            p[k] = getPosition(positions, stride, triangle[k]);
+        glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        for (uint k = 0; k < 3; k++)
+        {
+            if (triangle[k] == from)
+                p[k] = target;
+        }
+        glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+        if (glm::dot(before, after) <= 0.0f)
+            return true;
+    }
+    return false;
+}
+
+// The link condition: the endpoints of an edge must share exactly the two vertices opposite it,
+// otherwise collapsing it would pinch the surface into a non-manifold shape
+bool collapseIsManifold(const vector<GLuint>& indices, const vector<vector<uint>>& adjacency,
+                        const vector<GLuint>& canonical, GLuint from, GLuint to)
+{
+    vector<GLuint> fromRing, toRing;
+    const vector<uint>& fromTriangles = adjacency[canonical[from]];
+    const vector<uint>& toTriangles = adjacency[canonical[to]];
+    for (auto t = fromTriangles.begin(); t != fromTriangles.end(); t++)
+    {
+        for (uint k = 0; k < 3; k++)
+            fromRing.push_back(canonical[indices[*t * 3 + k]]);
+    }
+    for (auto t = toTriangles.begin(); t != toTriangles.end(); t++)
+    {
+        for (uint k = 0; k < 3; k++)
+            toRing.push_back(canonical[indices[*t * 3 + k]]);
+    }
+    std::sort(fromRing.begin(), fromRing.end());
+    fromRing.erase(std::unique(fromRing.begin(), fromRing.end()), fromRing.end());
+    std::sort(toRing.begin(), toRing.end());
+    toRing.erase(std::unique(toRing.begin(), toRing.end()), toRing.end());
+
+    // Both rings also contain the two endpoints themselves
+    vector<GLuint> shared;
+    std::set_intersection(fromRing.begin(), fromRing.end(), toRing.begin(), toRing.end(),
+                          std::back_inserter(shared));
+    return shared.size() <= 4;
+}
+
+}
+
+vector<GLuint> simplify(const vector<GLuint>& indices, const GLfloat* positions, uint stride,
+                        uint vertexCount, uint targetIndexCount, float* error)
+{
+    vector<GLuint> result(indices);
+    double maxCost = 0.0;
+
+    vector<GLuint> canonical = weldPositions(positions, stride, vertexCount);
+    vector<bool> locked = findLockedVertices(indices, canonical);
+
+    // Each vertex starts with the planes of the triangles around it
+    vector<Quadric> quadrics(vertexCount);
+    for (uint i = 0; i < indices.size(); i += 3)
+    {
+        glm::vec3 p0 = getPosition(positions, stride, indices[i]);
+        glm::vec3 p1 = getPosition(positions, stride, indices[i + 1]);
+        glm::vec3 p2 = getPosition(positions, stride, indices[i + 2]);
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length <= 0.0f)
+            continue;
+        normal /= length;
+        Quadric plane(normal, -glm::dot(normal, p0));
+        for (uint k = 0; k < 3; k++)
+            quadrics[indices[i + k]] += plane;
+    }
+
+    // Collapse the cheapest edges in passes. Within a pass, each collapse must not touch a
+    // vertex already affected by another one, so the flip test stays valid. Adjacency is indexed
+    // by welded vertex, as unlocked vertices are never split by seams
+    vector<GLuint> remap(vertexCount);
+    vector<bool> touched(vertexCount);
+    vector<vector<uint>> adjacency(vertexCount);
+    vector<Collapse> collapses;
+    while (result.size() > targetIndexCount)
+    {
+        for (uint v = 0; v < vertexCount; v++)
+            adjacency[v].clear();
+        for (uint t = 0; t < result.size() / 3; t++)
+        {
+            for (uint k = 0; k < 3; k++)
+                adjacency[canonical[result[t * 3 + k]]].push_back(t);
+        }
+
+        collapses.clear();
+        for (uint i = 0; i < result.size(); i += 3)
+        {
+            for (uint k = 0; k < 3; k++)
+            {
+                GLuint a = result[i + k], b = result[i + (k + 1) % 3];
+                if (!locked[a])
+                {
+                    Collapse collapse = {a, b, quadrics[a].evaluate(getPosition(positions, stride, b))};
+                    collapses.push_back(collapse);
+                }
+                if (!locked[b])
+                {
+                    Collapse collapse = {b, a, quadrics[b].evaluate(getPosition(positions, stride, a))};
+                    collapses.push_back(collapse);
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end());
+
+        // Every collapse of an interior edge removes two triangles
+        uint trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+        uint removed = 0;
+        for (uint v = 0; v < vertexCount; v++)
+        {
+            remap[v] = v;
+            touched[v] = false;
+        }
+        for (auto c = collapses.begin(); c != collapses.end() && removed < trianglesToRemove; c++)
+        {
+            if (touched[c->from] || touched[c->to])
+                continue;
+            if (!collapseIsManifold(result, adjacency, canonical, c->from, c->to) ||
+                collapseFlipsTriangles(result, adjacency[c->from], canonical, positions, stride,
+                                       c->from, c->to))
+                continue;
+
+            remap[c->from] = c->to;
+            quadrics[c->to] += quadrics[c->from];
+            maxCost = glm::max(maxCost, c->cost);
+            removed += 2;
+            for (auto t = adjacency[c->from].begin(); t != adjacency[c->from].end(); t++)
+            {
+                for (uint k = 0; k < 3; k++)
+                    touched[result[*t * 3 + k]] = true;
+            }
+        }
+        if (removed == 0)
+            break;
+
+        // Apply the collapses and remove the triangles which became degenerate
+        uint writePosition = 0;
+        for (uint i = 0; i < result.size(); i += 3)
+        {
+            GLuint a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (canonical[a] == canonical[b] || canonical[b] == canonical[c] ||
+                canonical[c] == canonical[a])
+                continue;
+            result[writePosition++] = a;
+            result[writePosition++] = b;
+            result[writePosition++] = c;
+        }
+        result.resize(writePosition);
+    }
+
+    if (error)
+        *error = (float)sqrt(maxCost);
+    return result;
+}
+
+vector<LodLevel> generateLodChain(vector<GLuint>& indices, const GLfloat* positions, uint stride,
+                                  uint vertexCount, uint maxLevels, float ratio)
+{
+    vector<LodLevel> levels;
+    LodLevel original = {0, (uint)indices.size(), 0.0f};
+    levels.push_back(original);
+
+    // Simplify each level from the original mesh, so the error is always measured against the
+    // full detail surface
+    vector<GLuint> chain(indices);
+    uint targetIndexCount = indices.size();
+    for (uint i = 1; i < maxLevels; i++)
+    {
+        targetIndexCount = (uint)(targetIndexCount * ratio) / 3 * 3;
+        float error;
+        vector<GLuint> lod = simplify(indices, positions, stride, vertexCount, targetIndexCount,
+                                      &error);
+
+        // Stop once the mesh is mostly locked, as further levels would barely differ
+        const LodLevel& previous = levels.back();
+        if (lod.empty() || lod.size() > previous.indexCount * (1.0f + ratio) * 0.5f)
+            break;
+
+        optimiser::optimiseVertexCache(lod, vertexCount);
+        LodLevel level = {(uint)chain.size(), (uint)lod.size(), glm::max(error, previous.error)};
+        levels.push_back(level);
+        chain.insert(chain.end(), lod.begin(), lod.end());
+    }
+
+    indices.swap(chain);
+    return levels;
+}
+
+uint selectLod(const vector<LodLevel>& levels, const glm::vec3& worldPosition, float scale,
+               const glm::mat4& viewMatrix, const glm::mat4& projMatrix, float viewportHeight,
+               float maxPixelError)
+{
+    // Size in pixels of one world unit at the object's distance from the camera
+    float distance = glm::max(-(viewMatrix * glm::vec4(worldPosition, 1.0f)).z, 1e-4f);
+    float pixelsPerUnit = projMatrix[1][1] * 0.5f * viewportHeight / distance;
+
+    uint selected = 0;
+    for (uint i = 1; i < levels.size(); i++)
+    {
+        if (levels[i].error * scale * pixelsPerUnit > maxPixelError)
+            break;
+        selected = i;
+    }
+    return selected;
+}
+
+void printReport(const string& name, const vector<LodLevel>& levels)
+{
+    INFO << "LOD chain for '" << name << "': " << levels.size() << " levels" << endl;
+    for (uint i = 0; i < levels.size(); i++)
+    {
+        INFO << "    LOD " << i << ": " << levels[i].indexCount / 3 << " triangles ("
+             << 100.0f * levels[i].indexCount / levels[0].indexCount << "%), error "
+             << levels[i].error << endl;
+    }
+}
+
+}
@@ -0,0 +1,42 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// A single level of detail, stored as a range of a shared index buffer
+struct LodLevel
+{
+    uint indexOffset;
+    uint indexCount;
+
+    // Conservative bound on the deviation from the full detail mesh, in the same units as the
+    // positions
+    float error;
+};
+
+namespace simplifier {
+
+// Simplify a mesh to at most 'targetIndexCount' indices using quadric error metrics (Garland and
+// Heckbert, "Surface Simplification Using Quadric Error Metrics"). Edges are collapsed onto one of
+// their endpoints, so no new vertices are created. Vertices on open borders and on attribute
+// seams are never moved. Positions are read as 3 floats every 'stride' floats. If 'error' is not
+// null, it receives the deviation of the result from the input
+vector<GLuint> simplify(const vector<GLuint>& indices, const GLfloat* positions, uint stride,
+                        uint vertexCount, uint targetIndexCount, float* error = nullptr);
+
+// Replace 'indices' with a chain of up to 'maxLevels' levels of detail stored back to back,
+// starting with the original indices. Each level targets 'ratio' times the triangles of the
+// previous one, and the chain ends early once a level can't be reduced any further
+vector<LodLevel> generateLodChain(vector<GLuint>& indices, const GLfloat* positions, uint stride,
+                                  uint vertexCount, uint maxLevels = 5, float ratio = 0.5f);
+
+// Pick the coarsest level whose error projects to at most 'maxPixelError' pixels on screen, for
+// an object at 'worldPosition' scaled uniformly by 'scale'
+uint selectLod(const vector<LodLevel>& levels, const glm::vec3& worldPosition, float scale,
+               const glm::mat4& viewMatrix, const glm::mat4& projMatrix, float viewportHeight,
+               float maxPixelError = 1.0f);
+
+void printReport(const string& name, const vector<LodLevel>& levels);
+
+}
@@ -0,0 +1,152 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "Frustum.h"
+#include "Meshlets.h"
+
+namespace meshlets
+{
+
+namespace
+{
+
+void computeBounds(Meshlet& meshlet, const MeshletData& data, const GLfloat* positions,
+                   uint stride)
+{
+    // Bounding sphere around the centre of the bounding box
+    glm::vec3 min(0.0f), max(0.0f);
+    for (uint i = 0; i < meshlet.vertexCount; i++)
+    {
+        glm::vec3 p = glm::make_vec3(positions + data.vertices[meshlet.vertexOffset + i] * stride);
+        min = i == 0 ? p : glm::min(min, p);
+        max = i == 0 ? p : glm::max(max, p);
+    }
+    meshlet.centre = (min + max) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (uint i = 0; i < meshlet.vertexCount; i++)
+    {
+        glm::vec3 p = glm::make_vec3(positions + data.vertices[meshlet.vertexOffset + i] * stride);
+        meshlet.radius = glm::max(meshlet.radius, glm::length(p - meshlet.centre));
+    }
+
+    // Normal cone around the average triangle normal
+    vector<glm::vec3> normals;
+    normals.reserve(meshlet.triangleCount);
+    glm::vec3 axis(0.0f);
+    for (uint t = 0; t < meshlet.triangleCount; t++)
+    {
+        const uint8_t* triangle = &data.triangles[(meshlet.triangleOffset + t) * 3];
+        glm::vec3 p[3];
+        for (int k = 0; k < 3; k++)
+        {
+            GLuint v = data.vertices[meshlet.vertexOffset + triangle[k]];
+            p[k] = glm::make_vec3(positions + v * stride);
+        }
+        glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float length = glm::length(normal);
+        if (length > 0.0f)
+        {
+            normals.push_back(normal / length);
+            axis += normals.back();
+        }
+    }
+
+    float axisLength = glm::length(axis);
+    meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    if (axisLength > 0.0f)
+    {
+        float minDot = 1.0f;
+        for (auto n = normals.begin(); n != normals.end(); n++)
+            minDot = glm::min(minDot, glm::dot(*n, meshlet.coneAxis));
+
+        // Cones of 90 degrees or more contain triangles facing every direction
+        if (minDot > 0.0f)
+            meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+    }
+}
+
+}
+
+MeshletData buildMeshlets(const vector<GLuint>& indices, const GLfloat* positions, uint stride,
+                          uint vertexCount)
+{
+    MeshletData data;
+
+    // Local index of each mesh vertex in the current meshlet, or 0xFF if it isn't in it
+    vector<uint8_t> localIndex(vertexCount, 0xFF);
+
+    Meshlet current = Meshlet();
+    for (uint t = 0; t < indices.size() / 3; t++)
+    {
+        const GLuint* triangle = &indices[t * 3];
+        uint newVertices = 0;
+        for (int k = 0; k < 3; k++)
+            newVertices += localIndex[triangle[k]] == 0xFF ? 1 : 0;
+
+        // Start a new meshlet if this triangle doesn't fit
+        if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES ||
+            current.triangleCount + 1 > MESHLET_MAX_TRIANGLES)
+        {
+            for (uint i = 0; i < current.vertexCount; i++)
+                localIndex[data.vertices[current.vertexOffset + i]] = 0xFF;
+            data.meshlets.push_back(current);
+            current.vertexOffset = data.vertices.size();
+            current.vertexCount = 0;
+            current.triangleOffset = data.triangles.size() / 3;
+            current.triangleCount = 0;
+        }
+
+        for (int k = 0; k < 3; k++)
+        {
+            GLuint v = triangle[k];
+            if (localIndex[v] == 0xFF)
+            {
+                localIndex[v] = (uint8_t)current.vertexCount++;
+                data.vertices.push_back(v);
+            }
+            data.triangles.push_back(localIndex[v]);
+        }
+        current.triangleCount++;
+    }
+    if (current.triangleCount > 0)
+        data.meshlets.push_back(current);
+
+    for (auto m = data.meshlets.begin(); m != data.meshlets.end(); m++)
+        computeBounds(*m, data, positions, stride);
+
+    return data;
+}
+
+bool isVisible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& cameraPosition)
+{
+    if (!frustum.containsSphere(meshlet.centre, meshlet.radius))
+        return false;
+
+    // Back facing if the camera is inside the cone opposite the normal cone, expanded by the
+    // bounding sphere
+    glm::vec3 view = meshlet.centre - cameraPosition;
+    return glm::dot(view, meshlet.coneAxis) < meshlet.coneCutoff * glm::length(view) + meshlet.radius;
+}
+
+uint cullMeshlets(const MeshletData& data, const glm::mat4& viewProj,
+                  const glm::vec3& cameraPosition, vector<GLuint>& visibleIndices)
+{
+    Frustum frustum(viewProj);
+    uint visibleCount = 0;
+    for (auto m = data.meshlets.begin(); m != data.meshlets.end(); m++)
+    {
+        if (!isVisible(*m, frustum, cameraPosition))
+            continue;
+
+        const uint8_t* triangles = &data.triangles[m->triangleOffset * 3];
+        for (uint i = 0; i < m->triangleCount * 3; i++)
+            visibleIndices.push_back(data.vertices[m->vertexOffset + triangles[i]]);
+        visibleCount++;
+    }
+    return visibleCount;
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+class Frustum;
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// A small cluster of triangles with bounds which allow it to be culled as a whole
+struct Meshlet
+{
+    // Ranges in MeshletData::vertices and MeshletData::triangles
+    uint vertexOffset;
+    uint vertexCount;
+    uint triangleOffset;
+    uint triangleCount;
+
+    // Bounding sphere
+    glm::vec3 centre;
+    float radius;
+
+    // Normal cone. Every triangle normal is within the cone around 'coneAxis', and 'coneCutoff'
+    // is the sine of its half angle. A cutoff of 1 means the cone is too wide to be culled
+    glm::vec3 coneAxis;
+    float coneCutoff;
+};
+
+struct MeshletData
+{
+    vector<Meshlet> meshlets;
+
+    // Mesh vertex index of each meshlet vertex
+    vector<GLuint> vertices;
+
+    // Three meshlet-local vertex indices per triangle
+    vector<uint8_t> triangles;
+};
+
+namespace meshlets {
+
+// Split an indexed triangle list into meshlets. Triangles are consumed in order, so run
+// optimiser::optimiseVertexCache first to get spatially coherent clusters. Positions are read as
+// 3 floats every 'stride' floats
+MeshletData buildMeshlets(const vector<GLuint>& indices, const GLfloat* positions, uint stride,
+                          uint vertexCount);
+
+// Returns false if a meshlet is outside the frustum, or every triangle in it faces away from
+// the camera
+bool isVisible(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& cameraPosition);
+
+// Cull meshlets and append the triangles of the visible ones to 'visibleIndices', using the
+// original mesh vertex indices. Bounds are in the mesh's local space, so pass the full
+// world-view-projection matrix and the camera position relative to the mesh. Returns the
+// number of visible meshlets
+uint cullMeshlets(const MeshletData& data, const glm::mat4& viewProj,
+                  const glm::vec3& cameraPosition, vector<GLuint>& visibleIndices);
+
+}
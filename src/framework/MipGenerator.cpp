@@ -0,0 +1,422 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "MipGenerator.h"
+
+#include <cmath>
+
+// SSE2 is always available on x86-64, so no extra compiler flags are needed
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPGEN_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mipgen
+{
+
+namespace
+{
+
+const float kPi = 3.14159265358979f;
+
+// Radius of the windowed sinc filters in destination pixels. Downsampling by 2 covers twice as
+// many source pixels
+const int kFilterRadius = 3;
+const int kTapCount = kFilterRadius * 4;
+const float kKaiserAlpha = 4.0f;
+
+// Linear values are quantised to this many steps before being encoded to sRGB. The steps are
+// finer than the darkest sRGB steps, so every 8 bit value survives a round trip
+const uint kEncodeTableSize = 4096;
+
+struct SrgbTables
+{
+    float decode[256];
+    uint8_t encode[kEncodeTableSize];
+
+    SrgbTables()
+    {
+        for (uint i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            decode[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+        for (uint i = 0; i < kEncodeTableSize; i++)
+        {
+            float l = (float)i / (kEncodeTableSize - 1);
+            float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+            encode[i] = (uint8_t)(c * 255.0f + 0.5f);
+        }
+    }
+};
+
+const SrgbTables& getSrgbTables()
+{
+    static SrgbTables tables;
+    return tables;
+}
+
+// Four channel operations, so the filters are written once for both the SIMD and scalar paths
+struct ScalarOps
+{
+    struct Vec
+    {
+        float v[4];
+    };
+
+    static Vec splat(float f)
+    {
+        Vec r = {{f, f, f, f}};
+        return r;
+    }
+
+    static Vec load(const float* p)
+    {
+        Vec r = {{p[0], p[1], p[2], p[3]}};
+        return r;
+    }
+
+    static void store(float* p, const Vec& a)
+    {
+        for (uint c = 0; c < 4; c++)
+            p[c] = a.v[c];
+    }
+
+    static Vec add(const Vec& a, const Vec& b)
+    {
+        Vec r;
+        for (uint c = 0; c < 4; c++)
+            r.v[c] = a.v[c] + b.v[c];
+        return r;
+    }
+
+    static Vec mul(const Vec& a, const Vec& b)
+    {
+        Vec r;
+        for (uint c = 0; c < 4; c++)
+            r.v[c] = a.v[c] * b.v[c];
+        return r;
+    }
+};
+
+#ifdef MIPGEN_SSE2
+struct SseOps
+{
+    typedef __m128 Vec;
+
+    static Vec splat(float f)
+    {
+        return _mm_set1_ps(f);
+    }
+
+    static Vec load(const float* p)
+    {
+        return _mm_loadu_ps(p);
+    }
+
+    static void store(float* p, Vec a)
+    {
+        _mm_storeu_ps(p, a);
+    }
+
+    static Vec add(Vec a, Vec b)
+    {
+        return _mm_add_ps(a, b);
+    }
+
+    static Vec mul(Vec a, Vec b)
+    {
+        return _mm_mul_ps(a, b);
+    }
+};
+#endif
+
+float sinc(float x)
+{
+    if (fabsf(x) < 1e-5f)
+        return 1.0f;
+    x *= kPi;
+    return sinf(x) / x;
+}
+
+// Modified Bessel function of the first kind, for the Kaiser window
+float besselI0(float x)
+{
+    float sum = 1.0f, term = 1.0f;
+    float q = x * x * 0.25f;
+    for (uint k = 1; k < 20; k++)
+    {
+        term *= q / (k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+float filterWeight(MipFilter filter, float x)
+{
+    if (fabsf(x) >= kFilterRadius)
+        return 0.0f;
+    if (filter == MIP_FILTER_LANCZOS)
+        return sinc(x) * sinc(x / kFilterRadius);
+    float t = x / kFilterRadius;
+    return sinc(x) * besselI0(kKaiserAlpha * sqrtf(1.0f - t * t)) / besselI0(kKaiserAlpha);
+}
+
+// Destination pixel x is centred between source pixels 2x and 2x + 1, so tap t reads source
+// pixel 2x + t - (2 * kFilterRadius - 1). The weights are the same for every pixel
+void computeWeights(MipFilter filter, float* weights)
+{
+    float total = 0.0f;
+    for (int t = 0; t < kTapCount; t++)
+    {
+        float offset = t - (2 * kFilterRadius - 1) - 0.5f;
+        weights[t] = filterWeight(filter, offset * 0.5f);
+        total += weights[t];
+    }
+    for (int t = 0; t < kTapCount; t++)
+        weights[t] /= total;
+}
+
+template <class Ops>
+void downsampleBox(const float* src, uint srcWidth, uint srcHeight, float* dst, uint dstWidth,
+                   uint dstHeight)
+{
+    typename Ops::Vec quarter = Ops::splat(0.25f);
+    for (uint y = 0; y < dstHeight; y++)
+    {
+        const float* row0 = src + y * 2 * srcWidth * 4;
+        const float* row1 = src + glm::min(y * 2 + 1, srcHeight - 1) * srcWidth * 4;
+        for (uint x = 0; x < dstWidth; x++)
+        {
+            uint x0 = x * 2 * 4, x1 = glm::min(x * 2 + 1, srcWidth - 1) * 4;
+            typename Ops::Vec sum = Ops::add(Ops::add(Ops::load(row0 + x0), Ops::load(row0 + x1)),
+                                             Ops::add(Ops::load(row1 + x0), Ops::load(row1 + x1)));
+            Ops::store(dst + (y * dstWidth + x) * 4, Ops::mul(sum, quarter));
+        }
+    }
+}
+
+// Halve the width of an image
+template <class Ops>
+void downsampleRows(const float* src, uint srcWidth, uint height, float* dst, uint dstWidth,
+                    const float* weights)
+{
+    typename Ops::Vec w[kTapCount];
+    for (int t = 0; t < kTapCount; t++)
+        w[t] = Ops::splat(weights[t]);
+
+    for (uint y = 0; y < height; y++)
+    {
+        const float* srcRow = src + y * srcWidth * 4;
+        float* dstRow = dst + y * dstWidth * 4;
+        for (uint x = 0; x < dstWidth; x++)
+        {
+            int first = (int)x * 2 - (2 * kFilterRadius - 1);
+            typename Ops::Vec sum = Ops::splat(0.0f);
+            if (first >= 0 && first + kTapCount <= (int)srcWidth)
+            {
+                const float* p = srcRow + first * 4;
+                for (int t = 0; t < kTapCount; t++)
+                    sum = Ops::add(sum, Ops::mul(Ops::load(p + t * 4), w[t]));
+            }
+            else
+            {
+                // Clamp to the edge of the image
+                for (int t = 0; t < kTapCount; t++)
+                {
+                    int i = glm::clamp(first + t, 0, (int)srcWidth - 1);
+                    sum = Ops::add(sum, Ops::mul(Ops::load(srcRow + i * 4), w[t]));
+                }
+            }
+            Ops::store(dstRow + x * 4, sum);
+        }
+    }
+}
+
+// Halve the height of an image
+template <class Ops>
+void downsampleColumns(const float* src, uint width, uint srcHeight, float* dst, uint dstHeight,
+                       const float* weights)
+{
+    typename Ops::Vec w[kTapCount];
+    for (int t = 0; t < kTapCount; t++)
+        w[t] = Ops::splat(weights[t]);
+
+    const float* rows[kTapCount];
+    for (uint y = 0; y < dstHeight; y++)
+    {
+        int first = (int)y * 2 - (2 * kFilterRadius - 1);
+        for (int t = 0; t < kTapCount; t++)
+            rows[t] = src + glm::clamp(first + t, 0, (int)srcHeight - 1) * width * 4;
+
+        float* dstRow = dst + y * width * 4;
+        for (uint x = 0; x < width; x++)
+        {
+            typename Ops::Vec sum = Ops::splat(0.0f);
+            for (int t = 0; t < kTapCount; t++)
+                sum = Ops::add(sum, Ops::mul(Ops::load(rows[t] + x * 4), w[t]));
+            Ops::store(dstRow + x * 4, sum);
+        }
+    }
+}
+
+template <class Ops>
+void downsample(const vector<float>& src, uint srcWidth, uint srcHeight, vector<float>& dst,
+                uint dstWidth, uint dstHeight, MipFilter filter, const float* weights,
+                vector<float>& temp)
+{
+    if (filter == MIP_FILTER_BOX)
+    {
+        downsampleBox<Ops>(src.data(), srcWidth, srcHeight, dst.data(), dstWidth, dstHeight);
+    }
+    else
+    {
+        temp.resize(dstWidth * srcHeight * 4);
+        downsampleRows<Ops>(src.data(), srcWidth, srcHeight, temp.data(), dstWidth, weights);
+        downsampleColumns<Ops>(temp.data(), dstWidth, srcHeight, dst.data(), dstHeight, weights);
+    }
+}
+
+void downsampleLevel(bool simd, const vector<float>& src, uint srcWidth, uint srcHeight,
+                     vector<float>& dst, uint dstWidth, uint dstHeight, MipFilter filter,
+                     const float* weights, vector<float>& temp)
+{
+#ifdef MIPGEN_SSE2
+    if (simd)
+    {
+        downsample<SseOps>(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, filter, weights,
+                           temp);
+        return;
+    }
+#endif
+    downsample<ScalarOps>(src, srcWidth, srcHeight, dst, dstWidth, dstHeight, filter, weights,
+                          temp);
+}
+
+void decodeImage(const uint8_t* pixels, uint pixelCount, bool srgb, float* out)
+{
+    const SrgbTables& tables = getSrgbTables();
+    for (uint i = 0; i < pixelCount * 4; i += 4)
+    {
+        for (uint c = 0; c < 3; c++)
+            out[i + c] = srgb ? tables.decode[pixels[i + c]] : pixels[i + c] / 255.0f;
+        out[i + 3] = pixels[i + 3] / 255.0f;
+    }
+}
+
+void encodeImage(const float* in, uint pixelCount, bool srgb, uint8_t* out)
+{
+    // Sinc filters ring, so values can fall slightly outside of [0, 1]
+    const SrgbTables& tables = getSrgbTables();
+    for (uint i = 0; i < pixelCount * 4; i += 4)
+    {
+        for (uint c = 0; c < 4; c++)
+        {
+            float v = glm::clamp(in[i + c], 0.0f, 1.0f);
+            if (srgb && c < 3)
+                out[i + c] = tables.encode[(uint)(v * (kEncodeTableSize - 1) + 0.5f)];
+            else
+                out[i + c] = (uint8_t)(v * 255.0f + 0.5f);
+        }
+    }
+}
+
+}
+
+vector<MipLevel> generateMipChain(const uint8_t* pixels, uint width, uint height, MipFilter filter,
+                                  bool srgb, bool simd)
+{
+    float weights[kTapCount];
+    computeWeights(filter, weights);
+
+    vector<float> current(width * height * 4), next, temp;
+    decodeImage(pixels, width * height, srgb, current.data());
+
+    vector<MipLevel> levels;
+    while (width > 1 || height > 1)
+    {
+        uint nextWidth = glm::max(width / 2, 1u);
+        uint nextHeight = glm::max(height / 2, 1u);
+        next.resize(nextWidth * nextHeight * 4);
+        downsampleLevel(simd, current, width, height, next, nextWidth, nextHeight, filter, weights,
+                        temp);
+
+        MipLevel level;
+        level.width = nextWidth;
+        level.height = nextHeight;
+        level.pixels.resize(nextWidth * nextHeight * 4);
+        encodeImage(next.data(), nextWidth * nextHeight, srgb, level.pixels.data());
+        levels.push_back(std::move(level));
+
+        current.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+    return levels;
+}
+
+uint getLevelCount(uint width, uint height)
+{
+    uint levels = 1;
+    for (uint size = glm::max(width, height); size > 1; size /= 2)
+        levels++;
+    return levels;
+}
+
+bool isSimdSupported()
+{
+#ifdef MIPGEN_SSE2
+    return true;
+#else
+    return false;
+#endif
+}
+
+MipThroughput measureThroughput(uint width, uint height, MipFilter filter, bool srgb)
+{
+    // A noisy pattern, so that the filters can't take any shortcuts
+    vector<uint8_t> pixels(width * height * 4);
+    uint seed = 1;
+    for (auto i = pixels.begin(); i != pixels.end(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        *i = (uint8_t)(seed >> 24);
+    }
+
+    // Take the best of a few runs to hide any interruptions
+    float bestSeconds[2] = {1e9f, 1e9f};
+    for (uint run = 0; run < 3; run++)
+    {
+        for (uint path = 0; path < 2; path++)
+        {
+            uint64 start = SDL_GetPerformanceCounter();
+            generateMipChain(pixels.data(), width, height, filter, srgb, path == 0);
+            float seconds =
+                (float)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+            bestSeconds[path] = glm::min(bestSeconds[path], seconds);
+        }
+    }
+
+    float megapixels = width * height / 1000000.0f;
+    MipThroughput throughput = {megapixels / bestSeconds[0], megapixels / bestSeconds[1]};
+    return throughput;
+}
+
+const char* getFilterName(MipFilter filter)
+{
+    switch (filter)
+    {
+    case MIP_FILTER_BOX:
+        return "Box";
+    case MIP_FILTER_KAISER:
+        return "Kaiser";
+    case MIP_FILTER_LANCZOS:
+        return "Lanczos";
+    default:
+        return "Unknown";
+    }
+}
+
+}
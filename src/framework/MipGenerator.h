@@ -0,0 +1,50 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+enum MipFilter
+{
+    MIP_FILTER_BOX,     // 2x2 average. Fastest, but blurs and aliases more than the others
+    MIP_FILTER_KAISER,  // Kaiser windowed sinc with a radius of 3 destination pixels
+    MIP_FILTER_LANCZOS  // Lanczos-3. Slightly sharper than Kaiser, with more ringing
+};
+
+// A single RGBA8 mip level
+struct MipLevel
+{
+    uint width;
+    uint height;
+    vector<uint8_t> pixels;
+};
+
+// Throughput of the mip generator in source megapixels per second
+struct MipThroughput
+{
+    float simd;
+    float scalar;
+};
+
+namespace mipgen {
+
+// Generate the mip chain of an RGBA8 image, from the second level down to 1x1. Filtering is done
+// in linear space at float precision, so with 'srgb' set the colour channels are decoded before
+// filtering and encoded again afterwards, while alpha is always linear. 'simd' selects the SSE2
+// path, and the scalar path is kept as a reference for it
+vector<MipLevel> generateMipChain(const uint8_t* pixels, uint width, uint height,
+                                  MipFilter filter = MIP_FILTER_KAISER, bool srgb = true,
+                                  bool simd = true);
+
+// Number of levels in a full mip chain, including the first
+uint getLevelCount(uint width, uint height);
+
+// True if the SSE2 path was compiled in. Otherwise 'simd' falls back to the scalar path
+bool isSimdSupported();
+
+// Time the SIMD and scalar paths on a generated image of the specified size
+MipThroughput measureThroughput(uint width, uint height, MipFilter filter, bool srgb = true);
+
+const char* getFilterName(MipFilter filter);
+
+}
@@ -0,0 +1,170 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "Shader.h"
+#include "ParameterBlock.h"
+
+#include <cstring>
+
+ParameterBlock::ParameterBlock(Shader* shader) : mShader(shader), mLastUploadCount(0)
+{
+    // Lay out a slot for every uniform which lives in the default block
+    const ShaderReflection& reflection = shader->getReflection();
+    for (auto i = reflection.uniforms.begin(); i != reflection.uniforms.end(); i++)
+    {
+        uint size = ShaderReflection::getUniformTypeSize(i->type);
+        if (i->location == -1 || size == 0)
+            continue;
+
+        Parameter parameter = {i->location, i->type, (uint)mData.size(), size, false, false,
+                               i->name};
+        mParameterIndices[UniformName(i->name).getHash()] = mParameters.size();
+        mParameters.push_back(parameter);
+        mData.resize(mData.size() + size);
+    }
+}
+
+ParameterBlock::~ParameterBlock()
+{
+    if (mShader->mCurrentParameterBlock == this)
+        mShader->mCurrentParameterBlock = nullptr;
+}
+
+void ParameterBlock::bind()
+{
+    mShader->bind();
+
+    // If another block was uploaded to this shader since our last bind, the program holds its
+    // values rather than ours
+    mLastUploadCount = 0;
+    if (mShader->mCurrentParameterBlock != this)
+    {
+        for (auto i = mParameters.begin(); i != mParameters.end(); i++)
+        {
+            if (i->set)
+            {
+                upload(*i);
+                mLastUploadCount++;
+            }
+            i->dirty = false;
+        }
+        mShader->mCurrentParameterBlock = this;
+    }
+    else
+    {
+        for (auto i = mDirtyParameters.begin(); i != mDirtyParameters.end(); i++)
+        {
+            upload(mParameters[*i]);
+            mParameters[*i].dirty = false;
+        }
+        mLastUploadCount = mDirtyParameters.size();
+    }
+    mDirtyParameters.clear();
+}
+
+Shader* ParameterBlock::getShader() const
+{
+    return mShader;
+}
+
+uint ParameterBlock::getLastUploadCount() const
+{
+    return mLastUploadCount;
+}
+
+void ParameterBlock::setData(const UniformName& name, const void* value, uint size)
+{
+    auto index = mParameterIndices.find(name.getHash());
+    if (index == mParameterIndices.end())
+    {
+        WARNING << "Unable to find uniform '" << name.getName() << "'" << endl;
+        mParameterIndices[name.getHash()] = -1;
+        return;
+    }
+    if (index->second == -1)
+        return;
+
+    Parameter& parameter = mParameters[index->second];
+    assert(parameter.name == name.getName());
+    if (size != parameter.size)
+    {
+        stringstream err;
+        err << "Error: Uniform '" << name.getName() << "' is " << parameter.size
+            << " bytes, but was set with a " << size << " byte value" << endl;
+        throw std::runtime_error(err.str());
+    }
+
+    // Skip values which haven't changed
+    uint8_t* data = &mData[parameter.offset];
+    if (parameter.set && memcmp(data, value, size) == 0)
+        return;
+    memcpy(data, value, size);
+    parameter.set = true;
+    if (!parameter.dirty)
+    {
+        parameter.dirty = true;
+        mDirtyParameters.push_back(index->second);
+    }
+}
+
+void ParameterBlock::upload(const Parameter& parameter)
+{
+    const void* data = &mData[parameter.offset];
+    const GLfloat* f = static_cast<const GLfloat*>(data);
+    const GLint* i = static_cast<const GLint*>(data);
+    const GLuint* u = static_cast<const GLuint*>(data);
+    switch (parameter.type)
+    {
+    case GL_FLOAT:
+        glUniform1fv(parameter.location, 1, f);
+        break;
+    case GL_FLOAT_VEC2:
+        glUniform2fv(parameter.location, 1, f);
+        break;
+    case GL_FLOAT_VEC3:
+        glUniform3fv(parameter.location, 1, f);
+        break;
+    case GL_FLOAT_VEC4:
+        glUniform4fv(parameter.location, 1, f);
+        break;
+    case GL_INT_VEC2:
+    case GL_BOOL_VEC2:
+        glUniform2iv(parameter.location, 1, i);
+        break;
+    case GL_INT_VEC3:
+    case GL_BOOL_VEC3:
+        glUniform3iv(parameter.location, 1, i);
+        break;
+    case GL_INT_VEC4:
+    case GL_BOOL_VEC4:
+        glUniform4iv(parameter.location, 1, i);
+        break;
+    case GL_UNSIGNED_INT:
+        glUniform1uiv(parameter.location, 1, u);
+        break;
+    case GL_UNSIGNED_INT_VEC2:
+        glUniform2uiv(parameter.location, 1, u);
+        break;
+    case GL_UNSIGNED_INT_VEC3:
+        glUniform3uiv(parameter.location, 1, u);
+        break;
+    case GL_UNSIGNED_INT_VEC4:
+        glUniform4uiv(parameter.location, 1, u);
+        break;
+    case GL_FLOAT_MAT2:
+        glUniformMatrix2fv(parameter.location, 1, GL_FALSE, f);
+        break;
+    case GL_FLOAT_MAT3:
+        glUniformMatrix3fv(parameter.location, 1, GL_FALSE, f);
+        break;
+    case GL_FLOAT_MAT4:
+        glUniformMatrix4fv(parameter.location, 1, GL_FALSE, f);
+        break;
+    default:
+        // Ints, bools and samplers
+        glUniform1iv(parameter.location, 1, i);
+        break;
+    }
+}
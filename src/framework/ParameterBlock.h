@@ -0,0 +1,61 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <unordered_map>
+
+#include "Shader.h"
+
+// A set of values for every uniform of a shader, built from its reflection data. Setting a value
+// only writes to a CPU side copy, and values which changed are uploaded together when the block
+// is bound. Several blocks can share a shader, such as one per material. Uniforms which a block
+// never sets are left alone, so values set through the Shader directly still apply
+class ParameterBlock
+{
+public:
+    ParameterBlock(Shader* shader);
+    ~ParameterBlock();
+
+    // Set the value of a uniform, or the first element of an array. Names which aren't active in
+    // the shader are ignored
+    template <class T> void set(const UniformName& name, const T& value);
+
+    // Bind the shader and upload any values which changed since the last bind
+    void bind();
+
+    Shader* getShader() const;
+
+    // Number of uniforms uploaded by the last bind
+    uint getLastUploadCount() const;
+
+private:
+    struct Parameter
+    {
+        GLint location;
+        GLenum type;
+        uint offset;
+        uint size;
+        bool dirty;
+        bool set; // Only uniforms which have been given a value are uploaded
+        string name; // Checked against the names set in debug builds, to catch hash collisions
+    };
+
+    Shader* mShader;
+    vector<Parameter> mParameters;
+    vector<uint8_t> mData;
+    vector<uint> mDirtyParameters;
+    uint mLastUploadCount;
+
+    // Parameter index for each name hash, or -1 for names which aren't active
+    std::unordered_map<uint, int> mParameterIndices;
+
+    void setData(const UniformName& name, const void* value, uint size);
+    void upload(const Parameter& parameter);
+};
+
+template <class T> void ParameterBlock::set(const UniformName& name, const T& value)
+{
+    setData(name, &value, sizeof(T));
+}
@@ -0,0 +1,177 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "Utils.h"
+#include "ProgramBinaryCache.h"
+
+#include <cstring>
+#include <iomanip>
+
+#define PROGRAM_BINARY_MAGIC 0x42505047 // 'GPPB'
+
+namespace
+{
+
+struct ProgramBinaryHeader
+{
+    uint magic;
+    GLenum format;
+    uint64 key;
+    uint length;
+};
+
+string gDirectory;
+uint gHitCount = 0;
+uint gMissCount = 0;
+
+uint64 hashString(const string& str, uint64 hash)
+{
+    // 64 bit FNV-1a
+    for (auto c = str.begin(); c != str.end(); c++)
+        hash = (hash ^ (uint8_t)*c) * 1099511628211ull;
+    return hash;
+}
+
+string getDriverString(GLenum name)
+{
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+string getEntryPath(uint64 key)
+{
+    stringstream path;
+    path << gDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return path.str();
+}
+
+}
+
+void ProgramBinaryCache::setDirectory(const string& directory)
+{
+    gDirectory = directory;
+    if (!gDirectory.empty() && !utils::createDirectory(gDirectory))
+    {
+        WARNING << "Unable to create program binary cache directory '" << gDirectory << "'"
+                << endl;
+        gDirectory.clear();
+    }
+}
+
+bool ProgramBinaryCache::isSupported()
+{
+    static int supported = -1;
+    if (supported != -1)
+        return supported == 1;
+
+    // Most GL 3.3 drivers expose the same entry points through the extension
+    supported = gl3wIsSupported(4, 1) ? 1 : 0;
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount && !supported; i++)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (strcmp(extension, "GL_ARB_get_program_binary") == 0)
+            supported = 1;
+    }
+    return supported == 1;
+}
+
+bool ProgramBinaryCache::isEnabled()
+{
+    if (gDirectory.empty() || !isSupported())
+        return false;
+
+    static GLint formatCount = -1;
+    if (formatCount == -1)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
+uint64 ProgramBinaryCache::computeKey(const vector<string>& sources, const string& defines)
+{
+    // Separate each string with a null, so that moving text between them changes the key
+    uint64 hash = 14695981039346656037ull;
+    hash = hashString(getDriverString(GL_VENDOR), hash);
+    hash = hashString(string(1, '\0'), hash);
+    hash = hashString(getDriverString(GL_RENDERER), hash);
+    hash = hashString(string(1, '\0'), hash);
+    hash = hashString(getDriverString(GL_VERSION), hash);
+    hash = hashString(string(1, '\0'), hash);
+    hash = hashString(defines, hash);
+    for (auto i = sources.begin(); i != sources.end(); i++)
+    {
+        hash = hashString(string(1, '\0'), hash);
+        hash = hashString(*i, hash);
+    }
+    return hash;
+}
+
+bool ProgramBinaryCache::load(GLuint program, uint64 key)
+{
+    std::ifstream file(getEntryPath(key), std::ios::in | std::ios::binary);
+    ProgramBinaryHeader header;
+    if (!file.is_open() || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        header.magic != PROGRAM_BINARY_MAGIC || header.key != key)
+    {
+        gMissCount++;
+        return false;
+    }
+
+    vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size()))
+    {
+        gMissCount++;
+        return false;
+    }
+
+    // The driver is free to reject binaries it no longer understands
+    glProgramBinary(program, header.format, binary.data(), binary.size());
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE)
+    {
+        gMissCount++;
+        return false;
+    }
+
+    gHitCount++;
+    return true;
+}
+
+void ProgramBinaryCache::store(GLuint program, uint64 key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    ProgramBinaryHeader header = {PROGRAM_BINARY_MAGIC, 0, key, (uint)length};
+    vector<char> binary(length);
+    glGetProgramBinary(program, length, nullptr, &header.format, binary.data());
+
+    string path = getEntryPath(key);
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) ||
+        !file.write(binary.data(), binary.size()))
+        WARNING << "Unable to write program binary '" << path << "'" << endl;
+}
+
+uint ProgramBinaryCache::getHitCount()
+{
+    return gHitCount;
+}
+
+uint ProgramBinaryCache::getMissCount()
+{
+    return gMissCount;
+}
+
+void ProgramBinaryCache::printReport()
+{
+    uint total = gHitCount + gMissCount;
+    INFO << "Program binary cache: " << gHitCount << " hits, " << gMissCount << " misses ("
+         << (total > 0 ? 100.0f * gHitCount / total : 0.0f) << "% hit rate)" << endl;
+}
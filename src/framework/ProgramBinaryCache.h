@@ -0,0 +1,38 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// Stores linked program binaries on disk, so that later runs can skip compiling and linking.
+// Entries are keyed by a hash of everything which affects the binary: the shader sources, the
+// defines they were built with and the driver which produced it. Binaries which the driver
+// rejects, for example after a driver update, are treated as misses and rebuilt
+class ProgramBinaryCache
+{
+public:
+    // Enable the cache, storing binaries in this directory. An empty path disables it
+    static void setDirectory(const string& directory);
+
+    // True if the driver can retrieve program binaries, through GL 4.1 or
+    // GL_ARB_get_program_binary
+    static bool isSupported();
+
+    // True if a directory is set and the driver supports at least one binary format
+    static bool isEnabled();
+
+    static uint64 computeKey(const vector<string>& sources, const string& defines = "");
+
+    // Try to load a cached binary into 'program'. Returns true if it linked successfully
+    static bool load(GLuint program, uint64 key);
+
+    // Save the binary of a linked program. The program must have been linked with
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    static void store(GLuint program, uint64 key);
+
+    static uint getHitCount();
+    static uint getMissCount();
+
+    // Log the hit rate
+    static void printReport();
+};
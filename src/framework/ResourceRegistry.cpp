@@ -0,0 +1,248 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "ResourceRegistry.h"
+#include "TextureCompressor.h"
+
+#include <map>
+
+namespace
+{
+
+struct Resource
+{
+    ResourceCategory category;
+    uint64 bytes;
+    string name;
+};
+
+struct CategoryTotals
+{
+    uint64 bytes;
+    uint count;
+    uint64 budget;
+};
+
+std::map<const void*, Resource> gResources;
+CategoryTotals gTotals[RESOURCE_CATEGORY_COUNT];
+
+// Bytes per 4x4 block of a compressed format, or 0 if the format isn't block compressed
+uint getBlockSize(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RED_RGTC1:
+    case GL_COMPRESSED_SIGNED_RED_RGTC1:
+        return 8;
+
+    case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RG_RGTC2:
+    case GL_COMPRESSED_SIGNED_RG_RGTC2:
+        return 16;
+
+    default:
+        return 0;
+    }
+}
+
+string formatBytes(uint64 bytes)
+{
+    stringstream out;
+    out.precision(2);
+    if (bytes >= 1024 * 1024)
+        out << std::fixed << bytes / (1024.0 * 1024.0) << " MB";
+    else if (bytes >= 1024)
+        out << std::fixed << bytes / 1024.0 << " KB";
+    else
+        out << bytes << " bytes";
+    return out.str();
+}
+
+}
+
+void ResourceRegistry::track(ResourceCategory category, const void* owner, uint64 bytes,
+                             const string& name)
+{
+    CategoryTotals& totals = gTotals[category];
+    auto existing = gResources.find(owner);
+    if (existing == gResources.end())
+    {
+        Resource resource = {category, bytes, name};
+        gResources[owner] = resource;
+        totals.count++;
+    }
+    else
+    {
+        assert(existing->second.category == category);
+        totals.bytes -= existing->second.bytes;
+        existing->second.bytes = bytes;
+        if (!name.empty())
+            existing->second.name = name;
+    }
+
+    // Warn when this allocation takes the category over budget
+    uint64 previous = totals.bytes;
+    totals.bytes += bytes;
+    if (totals.budget > 0 && totals.bytes > totals.budget && previous <= totals.budget)
+    {
+        WARNING << getCategoryName(category) << " memory (" << formatBytes(totals.bytes)
+                << ") has exceeded its budget of " << formatBytes(totals.budget) << endl;
+    }
+}
+
+void ResourceRegistry::release(const void* owner)
+{
+    auto existing = gResources.find(owner);
+    if (existing == gResources.end())
+        return;
+
+    CategoryTotals& totals = gTotals[existing->second.category];
+    totals.bytes -= existing->second.bytes;
+    totals.count--;
+    gResources.erase(existing);
+}
+
+uint64 ResourceRegistry::getTotalBytes(ResourceCategory category)
+{
+    return gTotals[category].bytes;
+}
+
+uint64 ResourceRegistry::getTotalBytes()
+{
+    uint64 total = 0;
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+        total += gTotals[i].bytes;
+    return total;
+}
+
+uint ResourceRegistry::getCount(ResourceCategory category)
+{
+    return gTotals[category].count;
+}
+
+void ResourceRegistry::setBudget(ResourceCategory category, uint64 bytes)
+{
+    gTotals[category].budget = bytes;
+}
+
+void ResourceRegistry::printReport()
+{
+    INFO << "GPU memory: " << formatBytes(getTotalBytes()) << endl;
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+    {
+        const CategoryTotals& totals = gTotals[i];
+        INFO << "    " << getCategoryName((ResourceCategory)i) << ": " << totals.count
+             << " objects, " << formatBytes(totals.bytes);
+        if (totals.budget > 0)
+            cout << " of " << formatBytes(totals.budget);
+        cout << endl;
+    }
+}
+
+bool ResourceRegistry::reportLeaks()
+{
+    if (gResources.empty())
+        return false;
+
+    WARNING << gResources.size() << " GPU resources were leaked ("
+            << formatBytes(getTotalBytes()) << ")" << endl;
+    for (auto i = gResources.begin(); i != gResources.end(); i++)
+    {
+        WARNING << "    " << getCategoryName(i->second.category) << " " << i->first;
+        if (!i->second.name.empty())
+            cerr << " '" << i->second.name << "'";
+        cerr << ": " << formatBytes(i->second.bytes) << endl;
+    }
+    return true;
+}
+
+uint ResourceRegistry::getTexelSize(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_R8:
+    case GL_RED:
+        return 1;
+
+    case GL_RG8:
+    case GL_RG:
+    case GL_R16F:
+    case GL_DEPTH_COMPONENT16:
+        return 2;
+
+    case GL_RGB8:
+    case GL_RGB:
+    case GL_SRGB8:
+    case GL_DEPTH_COMPONENT24:
+        return 3;
+
+    case GL_RGBA8:
+    case GL_RGBA:
+    case GL_SRGB8_ALPHA8:
+    case GL_RG16F:
+    case GL_R32F:
+    case GL_R11F_G11F_B10F:
+    case GL_RGB10_A2:
+    case GL_DEPTH24_STENCIL8:
+    case GL_DEPTH_COMPONENT32F:
+        return 4;
+
+    case GL_RGB16F:
+        return 6;
+
+    case GL_RGBA16F:
+    case GL_RG32F:
+        return 8;
+
+    case GL_RGB32F:
+        return 12;
+
+    case GL_RGBA32F:
+        return 16;
+
+    default:
+        WARNING << "Unknown size of texture format 0x" << std::hex << internalFormat << std::dec
+                << ", assuming 4 bytes per texel" << endl;
+        return 4;
+    }
+}
+
+uint64 ResourceRegistry::getTextureSize(GLenum internalFormat, uint width, uint height, uint levels)
+{
+    uint64 size = 0;
+    for (uint level = 0; level < levels; level++)
+    {
+        uint blockSize = getBlockSize(internalFormat);
+        if (blockSize > 0)
+            size += (uint64)((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+        else
+            size += (uint64)width * height * getTexelSize(internalFormat);
+        width = glm::max(width / 2, 1u);
+        height = glm::max(height / 2, 1u);
+    }
+    return size;
+}
+
+const char* ResourceRegistry::getCategoryName(ResourceCategory category)
+{
+    switch (category)
+    {
+    case RESOURCE_MESH:
+        return "Mesh";
+    case RESOURCE_TEXTURE:
+        return "Texture";
+    case RESOURCE_FRAMEBUFFER:
+        return "Framebuffer";
+    case RESOURCE_SHADER:
+        return "Shader";
+    case RESOURCE_BUFFER:
+        return "Buffer";
+    default:
+        return "Unknown";
+    }
+}
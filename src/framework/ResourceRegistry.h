@@ -0,0 +1,47 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+enum ResourceCategory
+{
+    RESOURCE_MESH,
+    RESOURCE_TEXTURE,
+    RESOURCE_FRAMEBUFFER,
+    RESOURCE_SHADER,
+    RESOURCE_BUFFER,
+    RESOURCE_CATEGORY_COUNT
+};
+
+// Tracks the GPU memory owned by every live framework object. Objects register themselves when
+// they allocate GL storage and release themselves when they are destroyed, so anything left at
+// shutdown is a leak
+class ResourceRegistry
+{
+public:
+    // Register a resource, or update its size if it is already registered
+    static void track(ResourceCategory category, const void* owner, uint64 bytes,
+                      const string& name = "");
+    static void release(const void* owner);
+
+    // Live totals
+    static uint64 getTotalBytes(ResourceCategory category);
+    static uint64 getTotalBytes();
+    static uint getCount(ResourceCategory category);
+
+    // Warn when a category grows beyond a budget. A budget of 0 is unlimited
+    static void setBudget(ResourceCategory category, uint64 bytes);
+
+    // Log the totals for each category
+    static void printReport();
+
+    // Log every resource which is still registered. Returns true if there were any
+    static bool reportLeaks();
+
+    // Helpers for computing sizes
+    static uint getTexelSize(GLenum internalFormat);
+    static uint64 getTextureSize(GLenum internalFormat, uint width, uint height, uint levels = 1);
+
+    static const char* getCategoryName(ResourceCategory category);
+};
@@ -3,37 +3,221 @@
  * Copyright (c) David Avedissian 2014-2015
  */
 #include "Common.h"
-#include "Utils.h"
+#include "GLState.h"
+#include "ProgramBinaryCache.h"
+#include "ResourceRegistry.h"
+#include "ShaderBatch.h"
 #include "Shader.h"
 
-Shader::Shader(const string& vs, const string& fs)
+const ShaderUniform* ShaderReflection::findUniform(const string& name) const
 {
-    mProgram = glCreateProgram();
+    for (auto i = uniforms.begin(); i != uniforms.end(); i++)
+    {
+        if (i->name == name)
+            return &(*i);
+    }
+    return nullptr;
+}
+
+bool ShaderReflection::isSamplerType(GLenum type)
+{
+    switch (type)
+    {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_1D_SHADOW:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_1D_ARRAY:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_1D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_ARRAY_SHADOW:
+    case GL_SAMPLER_2D_MULTISAMPLE:
+    case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_SAMPLER_CUBE_SHADOW:
+    case GL_SAMPLER_BUFFER:
+    case GL_SAMPLER_2D_RECT:
+    case GL_SAMPLER_2D_RECT_SHADOW:
+    case GL_INT_SAMPLER_1D:
+    case GL_INT_SAMPLER_2D:
+    case GL_INT_SAMPLER_3D:
+    case GL_INT_SAMPLER_CUBE:
+    case GL_INT_SAMPLER_1D_ARRAY:
+    case GL_INT_SAMPLER_2D_ARRAY:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE:
+    case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_INT_SAMPLER_BUFFER:
+    case GL_INT_SAMPLER_2D_RECT:
+    case GL_UNSIGNED_INT_SAMPLER_1D:
+    case GL_UNSIGNED_INT_SAMPLER_2D:
+    case GL_UNSIGNED_INT_SAMPLER_3D:
+    case GL_UNSIGNED_INT_SAMPLER_CUBE:
+    case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+    case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+    case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+    case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+        return true;
 
-	GLuint vsID = compileShader(VERTEX_SHADER, vs);
-	glAttachShader(mProgram, vsID);
-	GLuint fsID = compileShader(FRAGMENT_SHADER, fs);
-    glAttachShader(mProgram, fsID);
+    default:
+        return false;
+    }
+}
+
+uint ShaderReflection::getUniformTypeSize(GLenum type)
+{
+    switch (type)
+    {
+    case GL_FLOAT:
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_BOOL:
+        return 4;
+    case GL_FLOAT_VEC2:
+    case GL_INT_VEC2:
+    case GL_UNSIGNED_INT_VEC2:
+    case GL_BOOL_VEC2:
+        return 8;
+    case GL_FLOAT_VEC3:
+    case GL_INT_VEC3:
+    case GL_UNSIGNED_INT_VEC3:
+    case GL_BOOL_VEC3:
+        return 12;
+    case GL_FLOAT_VEC4:
+    case GL_INT_VEC4:
+    case GL_UNSIGNED_INT_VEC4:
+    case GL_BOOL_VEC4:
+    case GL_FLOAT_MAT2:
+        return 16;
+    case GL_FLOAT_MAT3:
+        return 36;
+    case GL_FLOAT_MAT4:
+        return 64;
+    default:
+        return isSamplerType(type) ? 4 : 0;
+    }
+}
 
-	linkProgram();
+Shader::Shader(const string& vs, const string& fs, const ShaderDefines& defines)
+    : mProgram(0),
+      mPending(false),
+      mVsID(0),
+      mFsID(0),
+      mCacheKey(0),
+      mStoreBinary(false),
+      mCurrentParameterBlock(nullptr)
+{
+    beginBuild(preprocessor::preprocessShader(vs, defines),
+               preprocessor::preprocessShader(fs, defines), defines);
+    finishBuild();
+}
 
-    // Delete shaders now that they've been linked
-    glDeleteShader(vsID);
-    glDeleteShader(fsID);
+Shader::Shader()
+    : mProgram(0),
+      mPending(false),
+      mVsID(0),
+      mFsID(0),
+      mCacheKey(0),
+      mStoreBinary(false),
+      mCurrentParameterBlock(nullptr)
+{
 }
 
 Shader::~Shader()
 {
+    if (mVsID)
+        glDeleteShader(mVsID);
+    if (mFsID)
+        glDeleteShader(mFsID);
     if (mProgram)
+    {
+        GLState::forgetProgram(mProgram);
         glDeleteProgram(mProgram);
+    }
+    ResourceRegistry::release(this);
 }
 
 void Shader::bind()
 {
-    glUseProgram(mProgram);
+    if (mPending)
+        finishBuild();
+    GLState::useProgram(mProgram);
+}
+
+bool Shader::isReady()
+{
+    if (!mPending)
+        return true;
+
+    // Only query the completion status when the driver promises that it won't block
+    if (!ShaderBatch::isParallelCompileSupported())
+        return false;
+    GLint completed = GL_FALSE;
+    glGetProgramiv(mProgram, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+void Shader::beginBuild(const PreprocessedShader& vs, const PreprocessedShader& fs,
+                        const ShaderDefines& defines)
+{
+    mProgram = glCreateProgram();
+    mVsFiles = vs.files;
+    mFsFiles = fs.files;
+    mPending = true;
+    string definesKey = defines.getKey();
+    mName = vs.files[0] + ", " + fs.files[0];
+    if (!definesKey.empty())
+        mName += " [" + definesKey + "]";
+
+    // Use the binary from a previous run if the sources and driver haven't changed
+    if (ProgramBinaryCache::isEnabled())
+    {
+        mCacheKey = ProgramBinaryCache::computeKey({vs.source, fs.source}, definesKey);
+        if (ProgramBinaryCache::load(mProgram, mCacheKey))
+        {
+            INFO << "Loaded cached program " << mName << endl;
+            return;
+        }
+        mStoreBinary = true;
+        glProgramParameteri(mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    mVsID = compileShader(VERTEX_SHADER, vs);
+    glAttachShader(mProgram, mVsID);
+    mFsID = compileShader(FRAGMENT_SHADER, fs);
+    glAttachShader(mProgram, mFsID);
+    glLinkProgram(mProgram);
 }
 
-GLuint Shader::compileShader(ShaderType type, const string& sourceFile)
+void Shader::finishBuild()
+{
+    mPending = false;
+    if (mVsID != 0)
+    {
+        bool compiled = checkCompileStatus(mVsID, mVsFiles);
+        compiled = checkCompileStatus(mFsID, mFsFiles) && compiled;
+        if (compiled && checkLinkStatus() && mStoreBinary)
+            ProgramBinaryCache::store(mProgram, mCacheKey);
+
+        // Delete shaders now that they've been linked
+        glDetachShader(mProgram, mVsID);
+        glDetachShader(mProgram, mFsID);
+        glDeleteShader(mVsID);
+        glDeleteShader(mFsID);
+        mVsID = mFsID = 0;
+    }
+    reflectProgram();
+
+    // The size of the driver's program binary is the best available estimate of its footprint
+    GLint binaryLength = 0;
+    if (ProgramBinaryCache::isSupported())
+        glGetProgramiv(mProgram, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+    ResourceRegistry::track(RESOURCE_SHADER, this, binaryLength, mName);
+}
+
+GLuint Shader::compileShader(ShaderType type, const PreprocessedShader& source)
 {
 	// Output to the log
 	INFO << "Compiling Shader ";
@@ -54,19 +238,22 @@ GLuint Shader::compileShader(ShaderType type, const string& sourceFile)
 	default:
 		cout << "<unknown type>";
 	}
-	cout << " '" << sourceFile << "'" << endl;
+	cout << " '" << source.files[0] << "'" << endl;
 
 	// Create shader
 	GLuint id = glCreateShader((GLuint)type);
 
-	// Read source code
-	string source = utils::readEntireFile(sourceFile);
-	const char* sourceFileData = source.c_str();
+	// Upload source code
+	const char* sourceFileData = source.source.c_str();
 	glShaderSource(id, 1, &sourceFileData, NULL);
 
-	// Compile
+	// Compile. The result is checked later, so the driver can work on it in the meantime
 	glCompileShader(id);
+	return id;
+}
 
+bool Shader::checkCompileStatus(GLuint id, const vector<string>& files)
+{
 	// Check compilation result
 	GLint result;
 	glGetShaderiv(id, GL_COMPILE_STATUS, &result);
@@ -77,20 +264,17 @@ GLuint Shader::compileShader(ShaderType type, const string& sourceFile)
 
 		char* errorMessage = new char[infoLogLength];
 		glGetShaderInfoLog(id, infoLogLength, NULL, errorMessage);
-		ERROR << "Shader Compile Error: " << errorMessage;
+		ERROR << "Shader Compile Error in '" << files[0] << "':" << endl
+              << preprocessor::translateLog(errorMessage, files);
 		delete[] errorMessage;
 
 		// TODO: Error
 	}
-
-	return id;
+	return result == GL_TRUE;
 }
 
-void Shader::linkProgram()
+bool Shader::checkLinkStatus()
 {
-	// Link program
-	glLinkProgram(mProgram);
-
 	// Check the result of the link process
 	GLint result = GL_FALSE;
 	glGetProgramiv(mProgram, GL_LINK_STATUS, &result);
@@ -103,12 +287,164 @@ void Shader::linkProgram()
 		ERROR << "Shader Link Error:" << errorMessage;
 		delete[] errorMessage;
 	}
+	return result == GL_TRUE;
+}
+
+void Shader::setSampler(const UniformName& name, int unit)
+{
+    if (mPending)
+        finishBuild();
+
+    GLint maxUnits = 0;
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxUnits);
+    const ShaderUniform* uniform = mReflection.findUniform(name.getName());
+    if (uniform && !ShaderReflection::isSamplerType(uniform->type))
+    {
+        WARNING << "Uniform '" << name.getName() << "' is not a sampler" << endl;
+        return;
+    }
+    if (unit < 0 || unit >= maxUnits)
+    {
+        WARNING << "Texture unit " << unit << " for sampler '" << name.getName()
+                << "' is out of range" << endl;
+        return;
+    }
+    mCurrentParameterBlock = nullptr;
+    uploadUniform(getUniformLocation(name), unit);
 }
 
-GLint Shader::getUniformLocation(const string& name)
+bool Shader::validateSamplers()
 {
-    GLint location = glGetUniformLocation(mProgram, name.c_str());
-    if (location == -1)
-        WARNING << "Unable to find uniform '" << name << "'" << endl;
-    return location;
+    if (mPending)
+        finishBuild();
+
+    // Read back the unit of every sampler, as they may have been set through any path
+    std::unordered_map<GLint, const ShaderUniform*> units;
+    bool valid = true;
+    for (auto i = mReflection.uniforms.begin(); i != mReflection.uniforms.end(); i++)
+    {
+        if (!ShaderReflection::isSamplerType(i->type) || i->location == -1)
+            continue;
+
+        for (GLint element = 0; element < i->arraySize; element++)
+        {
+            GLint location = i->location;
+            if (element > 0)
+            {
+                stringstream elementName;
+                elementName << i->name << "[" << element << "]";
+                location = glGetUniformLocation(mProgram, elementName.str().c_str());
+            }
+            GLint unit = 0;
+            glGetUniformiv(mProgram, location, &unit);
+            auto existing = units.find(unit);
+            if (existing == units.end())
+            {
+                units[unit] = &(*i);
+            }
+            else if (existing->second->type != i->type)
+            {
+                WARNING << "Samplers '" << existing->second->name << "' and '" << i->name
+                        << "' have different types but both use texture unit " << unit << endl;
+                valid = false;
+            }
+        }
+    }
+    return valid;
+}
+
+bool Shader::bindUniformBlock(const string& name, GLuint bindingPoint)
+{
+    if (mPending)
+        finishBuild();
+
+    for (auto i = mReflection.uniformBlocks.begin(); i != mReflection.uniformBlocks.end(); i++)
+    {
+        if (i->name == name)
+        {
+            glUniformBlockBinding(mProgram, i->index, bindingPoint);
+            return true;
+        }
+    }
+    return false;
+}
+
+const ShaderReflection& Shader::getReflection()
+{
+    if (mPending)
+        finishBuild();
+
+    return mReflection;
+}
+
+void Shader::reflectProgram()
+{
+    GLint count = 0, maxNameLength = 0;
+    vector<char> name;
+
+    // Uniforms
+    glGetProgramiv(mProgram, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(mProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    name.resize(glm::max(maxNameLength, 1));
+    for (GLint i = 0; i < count; i++)
+    {
+        ShaderUniform uniform;
+        GLsizei length;
+        GLuint index = i;
+        glGetActiveUniform(mProgram, index, name.size(), &length, &uniform.arraySize,
+                           &uniform.type, name.data());
+        glGetActiveUniformsiv(mProgram, 1, &index, GL_UNIFORM_BLOCK_INDEX, &uniform.blockIndex);
+
+        // Arrays are reported as 'name[0]', but are set using just 'name'
+        uniform.name.assign(name.data(), length);
+        if (uniform.name.size() > 3 &&
+            uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+            uniform.name.resize(uniform.name.size() - 3);
+        uniform.location = glGetUniformLocation(mProgram, uniform.name.c_str());
+        mReflection.uniforms.push_back(uniform);
+
+        // Uniforms in blocks have no location
+        if (uniform.location == -1)
+            continue;
+
+        UniformName key(uniform.name);
+        if (mUniformLocations.count(key.getHash()) > 0)
+        {
+            stringstream err;
+            err << "Error: Uniform name hash collision for '" << uniform.name << "'" << endl;
+            throw std::runtime_error(err.str());
+        }
+        UniformLocation cached = {uniform.location, uniform.name};
+        mUniformLocations[key.getHash()] = cached;
+    }
+
+    // Vertex attributes
+    glGetProgramiv(mProgram, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(mProgram, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxNameLength);
+    name.resize(glm::max(maxNameLength, 1));
+    for (GLint i = 0; i < count; i++)
+    {
+        ShaderAttribute attribute;
+        GLsizei length;
+        glGetActiveAttrib(mProgram, i, name.size(), &length, &attribute.arraySize,
+                          &attribute.type, name.data());
+        attribute.name.assign(name.data(), length);
+        attribute.location = glGetAttribLocation(mProgram, attribute.name.c_str());
+        mReflection.attributes.push_back(attribute);
+    }
+
+    // Uniform blocks
+    glGetProgramiv(mProgram, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(mProgram, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+    name.resize(glm::max(maxNameLength, 1));
+    for (GLint i = 0; i < count; i++)
+    {
+        ShaderUniformBlock block;
+        GLsizei length;
+        block.index = i;
+        glGetActiveUniformBlockName(mProgram, i, name.size(), &length, name.data());
+        glGetActiveUniformBlockiv(mProgram, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize);
+        block.name.assign(name.data(), length);
+        mReflection.uniformBlocks.push_back(block);
+    }
 }
@@ -4,6 +4,11 @@
  */
 #pragma once
 
+#include <type_traits>
+#include <unordered_map>
+
+#include "ShaderPreprocessor.h"
+
 enum ShaderType
 {
 	VERTEX_SHADER = GL_VERTEX_SHADER,
@@ -11,64 +16,289 @@ enum ShaderType
 	FRAGMENT_SHADER = GL_FRAGMENT_SHADER
 };
 
+// A uniform name with a precomputed FNV-1a hash, so looking up a uniform by name involves no
+// allocation and no string comparisons. Constructing from a string literal is constexpr, but
+// the compiler is only obliged to fold the hash away in a constant expression. Use UNIFORM_NAME
+// or a constexpr UniformName to guarantee it
+class UniformName
+{
+public:
+    template <size_t N> constexpr UniformName(const char (&name)[N])
+        : mName(name),
+          mHash(hash(name, N - 1))
+    {
+    }
+
+    // 'hash' must be the hash of 'name'
+    constexpr UniformName(const char* name, uint hash) : mName(name), mHash(hash)
+    {
+    }
+
+    // The string must outlive this object, which is always true when passed as an argument
+    UniformName(const string& name)
+        : mName(name.c_str()),
+          mHash(hash(name.c_str(), name.size()))
+    {
+    }
+
+    constexpr const char* getName() const
+    {
+        return mName;
+    }
+
+    constexpr uint getHash() const
+    {
+        return mHash;
+    }
+
+    static constexpr uint hash(const char* str, size_t length, uint h = 2166136261u)
+    {
+        return length == 0 ? h : hash(str + 1, length - 1, (h ^ (uint8_t)*str) * 16777619u);
+    }
+
+private:
+    const char* mName;
+    uint mHash;
+};
+
+static_assert(UniformName::hash("", 0) == 2166136261u, "FNV-1a offset basis");
+static_assert(UniformName::hash("a", 1) == 0xe40c292cu, "FNV-1a hash of 'a'");
+
+// A UniformName for a string literal, hashed as a template argument so that it can't be left to
+// run time
+#define UNIFORM_NAME(NAME) \
+    UniformName(NAME, std::integral_constant<uint, UniformName::hash(NAME, sizeof(NAME) - 1)>::value)
+
+// A uniform location resolved once, typed so that it can only be set with matching values
+template <class T> class UniformHandle
+{
+public:
+    UniformHandle() : mLocation(-1)
+    {
+    }
+
+    explicit UniformHandle(GLint location) : mLocation(location)
+    {
+    }
+
+    GLint getLocation() const
+    {
+        return mLocation;
+    }
+
+    bool isValid() const
+    {
+        return mLocation != -1;
+    }
+
+private:
+    GLint mLocation;
+};
+
+// Active program inputs, enumerated once the program is linked
+struct ShaderUniform
+{
+    string name;
+    GLint location; // -1 for uniforms inside a block
+    GLenum type;
+    GLint arraySize;
+    GLint blockIndex;
+};
+
+struct ShaderAttribute
+{
+    string name;
+    GLint location;
+    GLenum type;
+    GLint arraySize;
+};
+
+struct ShaderUniformBlock
+{
+    string name;
+    GLuint index;
+    GLint dataSize;
+};
+
+struct ShaderReflection
+{
+    vector<ShaderUniform> uniforms;
+    vector<ShaderAttribute> attributes;
+    vector<ShaderUniformBlock> uniformBlocks;
+
+    // Returns null if there is no active uniform with this name
+    const ShaderUniform* findUniform(const string& name) const;
+
+    static bool isSamplerType(GLenum type);
+
+    // Size in bytes of a single element of a uniform type
+    static uint getUniformTypeSize(GLenum type);
+};
+
+class ParameterBlock;
+class ShaderBatch;
+
 class Shader
 {
 public:
-    Shader(const string& vs, const string& fs);
+    // Preprocess, compile and link a program, waiting for the result. Use a ShaderBatch to build
+    // many programs at once
+    Shader(const string& vs, const string& fs, const ShaderDefines& defines = ShaderDefines());
     ~Shader();
 
-    // Bind this shader
+    // Bind this shader. The first bind of a shader from a ShaderBatch waits for it to finish
+    // linking, and reports any errors
     void bind();
 
-    // Set uniform parameters
-    template <class T> void setUniform(const string& name, const T& value);
+    // True if the program has finished building, so that using it won't block. Without
+    // GL_KHR_parallel_shader_compile, this is only known once the shader has been used
+    bool isReady();
+
+    // Look up a uniform once, to be set every frame without any name lookups
+    template <class T> UniformHandle<T> getUniform(const UniformName& name);
+
+    // Set uniform parameters. This shader must be bound
+    template <class T> void setUniform(const UniformName& name, const T& value);
+    template <class T> void setUniform(const UniformHandle<T>& handle, const T& value);
+
+    // Assign a texture unit to a sampler uniform, checking that it is a sampler and that the
+    // unit exists. This shader must be bound
+    void setSampler(const UniformName& name, int unit);
+
+    // Check that no two samplers of different types read from the same texture unit, which
+    // fails at draw time. Returns false and logs the conflicts if there are any
+    bool validateSamplers();
+
+    // Connect a uniform block to a buffer binding point. Returns false if the block isn't active
+    bool bindUniformBlock(const string& name, GLuint bindingPoint);
+
+    const ShaderReflection& getReflection();
 
 private:
     GLuint mProgram;
+    ShaderReflection mReflection;
+
+    // State of a build which has been issued but not yet checked
+    bool mPending;
+    string mName;
+    vector<string> mVsFiles, mFsFiles;
+    GLuint mVsID, mFsID;
+    uint64 mCacheKey;
+    bool mStoreBinary;
+    friend class ShaderBatch;
+
+    // The parameter block whose values were last uploaded to this program
+    ParameterBlock* mCurrentParameterBlock;
+    friend class ParameterBlock;
+
+    // Locations of every active uniform, keyed by name hash. Names which aren't active are cached
+    // as -1 on first use, so they are only reported once. The name is kept so that debug builds
+    // can catch a name which collides with another one
+    struct UniformLocation
+    {
+        GLint location;
+        string name;
+    };
+    std::unordered_map<uint, UniformLocation> mUniformLocations;
+
+    Shader();
 
-	GLuint compileShader(ShaderType type, const string& sourceFile);
-	void linkProgram();
+    // Issue the compile and link commands without waiting for the driver, then later check the
+    // results. Every other method finishes a pending build before touching the program
+    void beginBuild(const PreprocessedShader& vs, const PreprocessedShader& fs,
+                    const ShaderDefines& defines);
+    void finishBuild();
 
-    GLint getUniformLocation(const string& name);
+	GLuint compileShader(ShaderType type, const PreprocessedShader& source);
+    bool checkCompileStatus(GLuint id, const vector<string>& files);
+	bool checkLinkStatus();
+    void reflectProgram();
+
+    GLint getUniformLocation(const UniformName& name);
+
+    static void uploadUniform(GLint location, int value);
+    static void uploadUniform(GLint location, float value);
+    static void uploadUniform(GLint location, const glm::vec2& value);
+    static void uploadUniform(GLint location, const glm::vec3& value);
+    static void uploadUniform(GLint location, const glm::vec4& value);
+    static void uploadUniform(GLint location, const glm::mat2& value);
+    static void uploadUniform(GLint location, const glm::mat3& value);
+    static void uploadUniform(GLint location, const glm::mat4& value);
 
 };
 
-template <> inline void Shader::setUniform(const string& name, const int& value)
+template <class T> UniformHandle<T> Shader::getUniform(const UniformName& name)
+{
+    return UniformHandle<T>(getUniformLocation(name));
+}
+
+template <class T> void Shader::setUniform(const UniformName& name, const T& value)
+{
+    mCurrentParameterBlock = nullptr;
+    uploadUniform(getUniformLocation(name), value);
+}
+
+template <class T> void Shader::setUniform(const UniformHandle<T>& handle, const T& value)
+{
+    mCurrentParameterBlock = nullptr;
+    uploadUniform(handle.getLocation(), value);
+}
+
+inline GLint Shader::getUniformLocation(const UniformName& name)
+{
+    if (mPending)
+        finishBuild();
+
+    auto cached = mUniformLocations.find(name.getHash());
+    if (cached != mUniformLocations.end())
+    {
+        // Different names with the same hash would share a location
+        assert(cached->second.name == name.getName());
+        return cached->second.location;
+    }
+
+    WARNING << "Unable to find uniform '" << name.getName() << "'" << endl;
+    UniformLocation missing = {-1, name.getName()};
+    mUniformLocations[name.getHash()] = missing;
+    return -1;
+}
+
+inline void Shader::uploadUniform(GLint location, int value)
 {
-    glUniform1i(getUniformLocation(name), value);
+    glUniform1i(location, value);
 }
 
-template <> inline void Shader::setUniform(const string& name, const float& value)
+inline void Shader::uploadUniform(GLint location, float value)
 {
-    glUniform1f(getUniformLocation(name), value);
+    glUniform1f(location, value);
 }
 
-template <> inline void Shader::setUniform(const string& name, const glm::vec2& value)
+inline void Shader::uploadUniform(GLint location, const glm::vec2& value)
 {
-    glUniform2f(getUniformLocation(name), value.x, value.y);
+    glUniform2f(location, value.x, value.y);
 }
 
-template <> inline void Shader::setUniform(const string& name, const glm::vec3& value)
+inline void Shader::uploadUniform(GLint location, const glm::vec3& value)
 {
-    glUniform3f(getUniformLocation(name), value.x, value.y, value.z);
+    glUniform3f(location, value.x, value.y, value.z);
 }
 
-template <> inline void Shader::setUniform(const string& name, const glm::vec4& value)
+inline void Shader::uploadUniform(GLint location, const glm::vec4& value)
 {
-    glUniform4f(getUniformLocation(name), value.x, value.y, value.z, value.w);
+    glUniform4f(location, value.x, value.y, value.z, value.w);
 }
 
-template <> inline void Shader::setUniform(const string& name, const glm::mat2& value)
+inline void Shader::uploadUniform(GLint location, const glm::mat2& value)
 {
-    glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+    glUniformMatrix2fv(location, 1, GL_FALSE, glm::value_ptr(value));
 }
 
-template <> inline void Shader::setUniform(const string& name, const glm::mat3& value)
+inline void Shader::uploadUniform(GLint location, const glm::mat3& value)
 {
-    glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+    glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
 }
 
-template <> inline void Shader::setUniform(const string& name, const glm::mat4& value)
+inline void Shader::uploadUniform(GLint location, const glm::mat4& value)
 {
-    glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(value));
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
 }
@@ -0,0 +1,95 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "Shader.h"
+#include "ThreadPool.h"
+#include "ShaderBatch.h"
+
+#include <cstring>
+
+ShaderBatch::ShaderBatch()
+{
+}
+
+ShaderBatch::~ShaderBatch()
+{
+    // These shaders have no program, so they would silently draw nothing
+    if (!mRequests.empty())
+    {
+        WARNING << "Shader batch destroyed with " << mRequests.size()
+                << " programs which were never submitted" << endl;
+        for (auto i = mRequests.begin(); i != mRequests.end(); i++)
+            WARNING << "    " << i->vs << ", " << i->fs << endl;
+    }
+}
+
+Shader* ShaderBatch::add(const string& vs, const string& fs, const ShaderDefines& defines)
+{
+    Request request = {new Shader(), vs, fs, defines};
+    mRequests.push_back(request);
+    return request.shader;
+}
+
+void ShaderBatch::submit(ThreadPool& pool)
+{
+    isParallelCompileSupported();
+
+    // Start preprocessing every file before waiting on any of them
+    vector<std::future<PreprocessedShader>> sources;
+    for (auto i = mRequests.begin(); i != mRequests.end(); i++)
+    {
+        string vs = i->vs, fs = i->fs;
+        ShaderDefines defines = i->defines;
+        sources.push_back(pool.submit([vs, defines]() {
+            return preprocessor::preprocessShader(vs, defines);
+        }));
+        sources.push_back(pool.submit([fs, defines]() {
+            return preprocessor::preprocessShader(fs, defines);
+        }));
+    }
+
+    // GL calls have to be made on this thread, but none of them wait for the compiler
+    for (uint i = 0; i < mRequests.size(); i++)
+    {
+        PreprocessedShader vsSource = sources[i * 2].get();
+        PreprocessedShader fsSource = sources[i * 2 + 1].get();
+        mRequests[i].shader->beginBuild(vsSource, fsSource, mRequests[i].defines);
+    }
+    INFO << "Submitted " << mRequests.size() << " programs" << endl;
+    mRequests.clear();
+}
+
+bool ShaderBatch::isParallelCompileSupported()
+{
+    static int supported = -1;
+    if (supported != -1)
+        return supported == 1;
+
+    supported = 0;
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; i++)
+    {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (strcmp(extension, "GL_KHR_parallel_shader_compile") == 0)
+        {
+            supported = 1;
+            break;
+        }
+    }
+
+    // Let the driver use as many threads as it likes
+    if (supported)
+    {
+        PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads =
+            (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)gl3wGetProcAddress(
+                "glMaxShaderCompilerThreadsKHR");
+        if (maxShaderCompilerThreads)
+            maxShaderCompilerThreads(0xFFFFFFFF);
+        else
+            supported = 0;
+    }
+    return supported == 1;
+}
@@ -0,0 +1,50 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// GL_KHR_parallel_shader_compile is newer than the GL headers, so is loaded at runtime
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) (GLuint count);
+#endif
+
+#include "ShaderPreprocessor.h"
+
+class Shader;
+class ThreadPool;
+
+// Builds many programs at once. Sources are read and preprocessed on worker threads, then every
+// compile and link is issued before any result is checked, so the driver can overlap them. With
+// GL_KHR_parallel_shader_compile the driver compiles on its own threads. Each program's status
+// is checked when it is first used
+class ShaderBatch
+{
+public:
+    ShaderBatch();
+    ~ShaderBatch();
+
+    // Queue a program. The shader is owned by the caller, and can be used once submit returns.
+    // Destroying the batch without submitting it logs a warning
+    Shader* add(const string& vs, const string& fs,
+                const ShaderDefines& defines = ShaderDefines());
+
+    // Preprocess the sources of every queued program, then issue their builds
+    void submit(ThreadPool& pool);
+
+    // Enables GL_KHR_parallel_shader_compile if the driver supports it
+    static bool isParallelCompileSupported();
+
+private:
+    struct Request
+    {
+        Shader* shader;
+        string vs;
+        string fs;
+        ShaderDefines defines;
+    };
+
+    vector<Request> mRequests;
+};
@@ -0,0 +1,41 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "Shader.h"
+#include "ShaderBatch.h"
+#include "ShaderLibrary.h"
+
+ShaderLibrary::ShaderLibrary()
+{
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+    for (auto i = mShaders.begin(); i != mShaders.end(); i++)
+        delete i->second;
+}
+
+Shader* ShaderLibrary::get(const string& vs, const string& fs, const ShaderDefines& defines,
+                           ShaderBatch* batch)
+{
+    string key = vs + "\n" + fs + "\n" + defines.getKey();
+    auto existing = mShaders.find(key);
+    if (existing != mShaders.end())
+        return existing->second;
+
+    Shader* shader = batch ? batch->add(vs, fs, defines) : new Shader(vs, fs, defines);
+    mShaders[key] = shader;
+    return shader;
+}
+
+Shader* ShaderLibrary::get(const string& vs, const string& fs, ShaderBatch* batch)
+{
+    return get(vs, fs, ShaderDefines(), batch);
+}
+
+uint ShaderLibrary::getPermutationCount() const
+{
+    return mShaders.size();
+}
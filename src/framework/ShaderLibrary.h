@@ -0,0 +1,31 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <map>
+
+class Shader;
+class ShaderBatch;
+class ShaderDefines;
+
+// Owns every permutation of every program, so that each combination of sources and defines is
+// only built once no matter how many times it is requested
+class ShaderLibrary
+{
+public:
+    ShaderLibrary();
+    ~ShaderLibrary();
+
+    // The program for this permutation. New programs are added to 'batch' if one is given,
+    // rather than being built immediately
+    Shader* get(const string& vs, const string& fs, const ShaderDefines& defines,
+                ShaderBatch* batch = nullptr);
+    Shader* get(const string& vs, const string& fs, ShaderBatch* batch = nullptr);
+
+    uint getPermutationCount() const;
+
+private:
+    std::map<string, Shader*> mShaders;
+};
@@ -0,0 +1,152 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "Utils.h"
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <cctype>
+
+ShaderDefines& ShaderDefines::set(const string& name, const string& value)
+{
+    mDefinitions[name] = value;
+    return *this;
+}
+
+string ShaderDefines::getKey() const
+{
+    stringstream key;
+    for (auto i = mDefinitions.begin(); i != mDefinitions.end(); i++)
+        key << i->first << "=" << i->second << ";";
+    return key.str();
+}
+
+const std::map<string, string>& ShaderDefines::getDefinitions() const
+{
+    return mDefinitions;
+}
+
+namespace preprocessor
+{
+
+namespace
+{
+
+// Returns the directive name if the line is a preprocessor directive, and sets 'argument' to the
+// rest of the line
+string parseDirective(const string& line, string& argument)
+{
+    size_t start = line.find_first_not_of(" \t");
+    if (start == string::npos || line[start] != '#')
+        return "";
+    start = line.find_first_not_of(" \t", start + 1);
+    if (start == string::npos)
+        return "";
+    size_t end = line.find_first_of(" \t", start);
+    argument = end == string::npos ? "" : line.substr(end);
+    return line.substr(start, end == string::npos ? string::npos : end - start);
+}
+
+string getDirectory(const string& file)
+{
+    size_t slash = file.find_last_of("/\\");
+    return slash == string::npos ? "" : file.substr(0, slash + 1);
+}
+
+void processFile(const string& file, const ShaderDefines* defines, PreprocessedShader& output)
+{
+    uint fileIndex = output.files.size();
+    output.files.push_back(file);
+
+    stringstream input(utils::readEntireFile(file));
+    stringstream result;
+    string line;
+    uint lineNumber = 0;
+
+    // The root file starts with #version, which must come before any other directive
+    if (fileIndex > 0)
+        result << "#line 1 " << fileIndex << "\n";
+    while (getline(input, line))
+    {
+        lineNumber++;
+        string argument;
+        string directive = parseDirective(line, argument);
+        if (directive == "include")
+        {
+            size_t open = argument.find('"');
+            size_t close = open == string::npos ? string::npos : argument.find('"', open + 1);
+            if (close == string::npos)
+            {
+                stringstream err;
+                err << "Error: Malformed #include in '" << file << "' on line " << lineNumber
+                    << endl;
+                throw std::runtime_error(err.str());
+            }
+
+            string path = getDirectory(file) + argument.substr(open + 1, close - open - 1);
+            if (std::find(output.files.begin(), output.files.end(), path) == output.files.end())
+            {
+                output.source += result.str();
+                result.str("");
+                processFile(path, nullptr, output);
+            }
+            result << "#line " << lineNumber + 1 << " " << fileIndex << "\n";
+        }
+        else if (directive == "version" && defines)
+        {
+            result << line << "\n";
+            const std::map<string, string>& definitions = defines->getDefinitions();
+            for (auto i = definitions.begin(); i != definitions.end(); i++)
+                result << "#define " << i->first << " " << i->second << "\n";
+            result << "#line " << lineNumber + 1 << " " << fileIndex << "\n";
+        }
+        else
+        {
+            result << line << "\n";
+        }
+    }
+
+    output.source += result.str();
+}
+
+}
+
+PreprocessedShader preprocessShader(const string& file, const ShaderDefines& defines)
+{
+    PreprocessedShader output;
+    processFile(file, &defines, output);
+    return output;
+}
+
+string translateLog(const string& log, const vector<string>& files)
+{
+    // Drivers report locations as 'N(line)' or 'N:line', optionally after a severity prefix
+    stringstream input(log), output;
+    string line;
+    while (getline(input, line))
+    {
+        size_t start = 0;
+        while (start < line.size() && !isdigit((unsigned char)line[start]))
+        {
+            if (line[start] != ' ' && !isupper((unsigned char)line[start]) && line[start] != ':')
+                break;
+            start++;
+        }
+        size_t end = start;
+        while (end < line.size() && isdigit((unsigned char)line[end]))
+            end++;
+
+        if (end > start && end < line.size() && (line[end] == '(' || line[end] == ':'))
+        {
+            uint index = std::stoi(line.substr(start, end - start));
+            if (index < files.size())
+                line = line.substr(0, start) + files[index] + line.substr(end);
+        }
+        output << line << "\n";
+    }
+    return output.str();
+}
+
+}
@@ -0,0 +1,44 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <map>
+
+// A set of preprocessor definitions selecting one permutation of a shader
+class ShaderDefines
+{
+public:
+    ShaderDefines& set(const string& name, const string& value = "1");
+
+    // Canonical 'NAME=VALUE;...' string sorted by name, which identifies the permutation
+    string getKey() const;
+
+    const std::map<string, string>& getDefinitions() const;
+
+private:
+    std::map<string, string> mDefinitions;
+};
+
+struct PreprocessedShader
+{
+    string source;
+
+    // Every file which went into the source, indexed by the source string number used in #line
+    // directives and therefore in compiler logs. The first file is the root
+    vector<string> files;
+};
+
+namespace preprocessor {
+
+// Load a shader, resolving '#include "file"' relative to the including file and inserting the
+// defines after the #version directive. Each file is included at most once. #line directives
+// keep the compiler's line numbers pointing at the original files. Makes no GL calls, so can be
+// run on worker threads
+PreprocessedShader preprocessShader(const string& file, const ShaderDefines& defines);
+
+// Replace the source string numbers at the start of each compiler log line with file names
+string translateLog(const string& log, const vector<string>& files);
+
+}
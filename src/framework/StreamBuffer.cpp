@@ -0,0 +1,157 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "GLState.h"
+#include "ResourceRegistry.h"
+#include "StreamBuffer.h"
+
+StreamBuffer::StreamBuffer(GLenum target, uint regionSize, uint regionCount)
+    : mTarget(target),
+      mBuffer(0),
+      mRegionSize(regionSize),
+      mRegionCount(regionCount),
+      mPersistent(gl3wIsSupported(4, 4) != 0),
+      mPersistentData(nullptr),
+      mRegionData(nullptr),
+      mFences(regionCount, nullptr),
+      mCurrentRegion(regionCount - 1),
+      mRegionOffset(0),
+      mFlushedOffset(0),
+      mStallCount(0)
+{
+    GLsizeiptr size = (GLsizeiptr)regionSize * regionCount;
+    glGenBuffers(1, &mBuffer);
+    // Binding GL_ELEMENT_ARRAY_BUFFER would change the bound vertex array, so storage is created
+    // and written through a target which nothing else depends on
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    if (mPersistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+        mPersistentData =
+            static_cast<uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+    }
+    else
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        mStagingData.resize(regionSize);
+    }
+    ResourceRegistry::track(RESOURCE_BUFFER, this, size);
+}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (auto i = mFences.begin(); i != mFences.end(); i++)
+    {
+        if (*i)
+            glDeleteSync(*i);
+    }
+
+    if (mPersistentData)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    glDeleteBuffers(1, &mBuffer);
+    ResourceRegistry::release(this);
+}
+
+void StreamBuffer::beginFrame()
+{
+    mCurrentRegion = (mCurrentRegion + 1) % mRegionCount;
+    mRegionOffset = 0;
+    mFlushedOffset = 0;
+
+    // Wait for the GPU to finish reading the region from 'mRegionCount' frames ago
+    GLsync& fence = mFences[mCurrentRegion];
+    if (fence)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+        {
+            mStallCount++;
+            while (result == GL_TIMEOUT_EXPIRED)
+                result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    if (mPersistent)
+        mRegionData = mPersistentData + (size_t)mCurrentRegion * mRegionSize;
+    else
+        mRegionData = mStagingData.data();
+}
+
+void StreamBuffer::endFrame()
+{
+    flush();
+    mFences[mCurrentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+StreamAllocation StreamBuffer::allocate(uint size, uint alignment)
+{
+    assert(mRegionData != nullptr);
+
+    // No alignment requirement is the same as an alignment of 1
+    alignment = glm::max(alignment, 1u);
+    uint offset = (mRegionOffset + alignment - 1) / alignment * alignment;
+    if (offset > mRegionSize || size > mRegionSize - offset)
+    {
+        stringstream err;
+        err << "Error: StreamBuffer region is full (requested " << size << " bytes, "
+            << mRegionSize - mRegionOffset << " remaining)" << endl;
+        throw std::runtime_error(err.str());
+    }
+    mRegionOffset = offset + size;
+
+    StreamAllocation allocation;
+    allocation.data = mRegionData + offset;
+    allocation.offset = (GLintptr)mCurrentRegion * mRegionSize + offset;
+    allocation.size = size;
+    return allocation;
+}
+
+void StreamBuffer::flush()
+{
+    // Coherent mappings are visible to the GPU as soon as they are written
+    if (mPersistent || mFlushedOffset == mRegionOffset)
+        return;
+
+    // The fence guarantees the GPU is done with this region, so the upload won't stall
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER,
+                    (GLintptr)mCurrentRegion * mRegionSize + mFlushedOffset,
+                    mRegionOffset - mFlushedOffset, mRegionData + mFlushedOffset);
+    mFlushedOffset = mRegionOffset;
+}
+
+void StreamBuffer::bind()
+{
+    // Otherwise this would replace the index buffer of whichever vertex array was left bound
+    GLuint vertexArray;
+    if (mTarget == GL_ELEMENT_ARRAY_BUFFER &&
+        (!GLState::getVertexArray(vertexArray) || vertexArray == 0))
+    {
+        throw std::runtime_error(
+            "Error: Bind a vertex array through GLState before binding a StreamBuffer of indices");
+    }
+    glBindBuffer(mTarget, mBuffer);
+}
+
+void StreamBuffer::bindRange(GLuint index, const StreamAllocation& allocation)
+{
+    glBindBufferRange(mTarget, index, mBuffer, allocation.offset, allocation.size);
+}
+
+GLuint StreamBuffer::getBuffer() const
+{
+    return mBuffer;
+}
+
+uint StreamBuffer::getStallCount() const
+{
+    return mStallCount;
+}
@@ -0,0 +1,63 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// A block of per-frame data written into a StreamBuffer
+struct StreamAllocation
+{
+    void* data;
+    GLintptr offset; // Offset from the start of the buffer object
+    GLsizeiptr size;
+};
+
+// A ring of buffer regions for data which is rewritten every frame, such as dynamic vertices,
+// indices and uniforms. Each frame bump allocates from one region while the GPU reads from the
+// others, and fences stop the CPU from overwriting a region before the GPU has finished with it.
+// With GL 4.4 the buffer is persistently and coherently mapped. Otherwise allocations are written
+// to a CPU copy of the region, and flush uploads them with glBufferSubData. Uploads go through
+// GL_COPY_WRITE_BUFFER, so only bind and bindRange touch the buffer's own target
+class StreamBuffer
+{
+public:
+    StreamBuffer(GLenum target, uint regionSize, uint regionCount = 3);
+    ~StreamBuffer();
+
+    // Wait until the GPU has finished with the next region, then start allocating from it
+    void beginFrame();
+
+    // Place a fence after the commands which read this frame's region
+    void endFrame();
+
+    // Allocate memory from the current region, starting at a multiple of 'alignment' bytes. An
+    // alignment of 0 is treated as 1. Throws if the region is full
+    StreamAllocation allocate(uint size, uint alignment = 4);
+
+    // Make everything allocated so far visible to the GPU. Call this before drawing with the data
+    void flush();
+
+    // Element buffers are part of the vertex array state, so for indices the vertex array they
+    // are for must have been bound through GLState first. Throws if it hasn't
+    void bind();
+    void bindRange(GLuint index, const StreamAllocation& allocation);
+
+    GLuint getBuffer() const;
+    uint getStallCount() const;
+
+private:
+    GLenum mTarget;
+    GLuint mBuffer;
+    uint mRegionSize;
+    uint mRegionCount;
+    bool mPersistent;
+
+    uint8_t* mPersistentData;
+    vector<uint8_t> mStagingData;
+    uint8_t* mRegionData;
+    vector<GLsync> mFences;
+    uint mCurrentRegion;
+    uint mRegionOffset;
+    uint mFlushedOffset;
+    uint mStallCount;
+};
@@ -3,36 +3,76 @@
  * Copyright (c) David Avedissian 2014-2015
  */
 #include "Common.h"
+#include "GLState.h"
+#include "MipGenerator.h"
+#include "ResourceRegistry.h"
+#include "TextureCompressor.h"
+#include "TextureFile.h"
 #include "Texture.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 Texture::Texture(const string& filename)
+    : mLoaded(true),
+      mImmutable(false),
+      mLevelCount(1),
+      mBaseLevel(0)
 {
     glGenTextures(1, &mTextureID);
-    glBindTexture(GL_TEXTURE_2D, mTextureID);
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // Pre-compressed containers only need to be mapped
+    if (TextureFile::isTextureFile(filename))
+    {
+        TextureFile file(filename);
+        setData(file);
+        ResourceRegistry::track(RESOURCE_TEXTURE, this,
+                                ResourceRegistry::getTextureSize(mInternalFormat, mWidth, mHeight,
+                                                                 mLevelCount),
+                                filename);
+        return;
+    }
 
     // Load the image file
     int width, height, numComponents;
     unsigned char* data = stbi_load(filename.c_str(), &width, &height, &numComponents, 4);
-    mWidth = width;
-    mHeight = height;
+    if (!data)
+    {
+        stringstream err;
+        err << "Error: Failed to load texture '" << filename << "': " << stbi_failure_reason()
+            << endl;
+        throw std::runtime_error(err.str());
+    }
 
-    // Filtering
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    // Give image data to OpenGL
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    // Give the image and its mip chain to OpenGL
+    setMipLevel(0, width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    vector<MipLevel> levels = mipgen::generateMipChain(data, width, height);
+    for (uint i = 0; i < levels.size(); i++)
+    {
+        setMipLevel(i + 1, levels[i].width, levels[i].height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE,
+                    levels[i].pixels.data());
+    }
+    setLevelCount(levels.size() + 1);
+    ResourceRegistry::track(RESOURCE_TEXTURE, this,
+                            ResourceRegistry::getTextureSize(GL_RGBA8, mWidth, mHeight, mLevelCount),
+                            filename);
 
     stbi_image_free(data);
 }
 
-Texture::Texture(uint width, uint height, GLuint format, GLuint type) : mWidth(width), mHeight(height)
+Texture::Texture(uint width, uint height, GLuint format, GLuint type)
+    : mWidth(width),
+      mHeight(height),
+      mInternalFormat(format),
+      mLoaded(true),
+      mImmutable(false),
+      mLevelCount(1),
+      mBaseLevel(0)
 {
     glGenTextures(1, &mTextureID);
-    glBindTexture(GL_TEXTURE_2D, mTextureID);
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
 
     // Filtering
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -40,17 +80,154 @@ Texture::Texture(uint width, uint height, GLuint format, GLuint type) : mWidth(w
 
     // Create image
     glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGB, type, NULL);
+    ResourceRegistry::track(RESOURCE_TEXTURE, this,
+                            ResourceRegistry::getTextureSize(format, width, height));
+}
+
+Texture::Texture(BlockFormat format, uint width, uint height, uint levelCount)
+    : mWidth(width),
+      mHeight(height),
+      mInternalFormat(compressor::getInternalFormat(format)),
+      mLoaded(true),
+      mImmutable(false),
+      mLevelCount(levelCount),
+      mBaseLevel(0)
+{
+    glGenTextures(1, &mTextureID);
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GLint swizzle[4];
+    compressor::getSwizzle(format, swizzle);
+    setSwizzle(swizzle);
+    setLevelCount(levelCount);
 }
 
 Texture::~Texture()
 {
+    GLState::forgetTexture(mTextureID);
     glDeleteTextures(1, &mTextureID);
+    ResourceRegistry::release(this);
 }
 
 void Texture::bind(uint unit)
 {
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, mTextureID);
+    GLState::bindTexture(unit, GL_TEXTURE_2D, mTextureID);
+}
+
+void Texture::setData(uint width, uint height, GLenum internalFormat, GLenum format, GLenum type,
+                      const void* data)
+{
+    setMipLevel(0, width, height, internalFormat, format, type, data);
+    setLevelCount(1);
+}
+
+void Texture::setData(const TextureFile& file)
+{
+    BlockFormat format = file.getFormat();
+    if (!compressor::isFormatSupported(format))
+    {
+        stringstream err;
+        err << "Error: " << compressor::getFormatName(format)
+            << " textures aren't supported by this driver" << endl;
+        throw std::runtime_error(err.str());
+    }
+    GLenum internalFormat = compressor::getInternalFormat(format);
+    mWidth = file.getWidth();
+    mHeight = file.getHeight();
+    mInternalFormat = internalFormat;
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+
+    // Allocate every level up front where possible, then hand each level over straight from the
+    // mapping. Pages are read in by the OS as GL copies them, so there is nothing to decode
+    if (!mImmutable && gl3wIsSupported(4, 2))
+    {
+        glTexStorage2D(GL_TEXTURE_2D, file.getLevelCount(), internalFormat, mWidth, mHeight);
+        mImmutable = true;
+    }
+    for (uint i = 0; i < file.getLevelCount(); i++)
+    {
+        const TextureFileLevel& level = file.getLevel(i);
+        if (mImmutable)
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.width, level.height,
+                                      internalFormat, level.size, level.data);
+        }
+        else
+        {
+            glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0,
+                                   level.size, level.data);
+        }
+    }
+
+    GLint swizzle[4];
+    compressor::getSwizzle(format, swizzle);
+    setSwizzle(swizzle);
+    setLevelCount(file.getLevelCount());
+}
+
+void Texture::setMipLevel(uint level, uint width, uint height, GLenum internalFormat,
+                          GLenum format, GLenum type, const void* data)
+{
+    if (level == 0)
+    {
+        mWidth = width;
+        mHeight = height;
+        mInternalFormat = internalFormat;
+    }
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, format, type, data);
+}
+
+void Texture::setCompressedMipLevel(uint level, uint width, uint height, GLenum internalFormat,
+                                    uint size, const void* data)
+{
+    if (level == 0)
+    {
+        mWidth = width;
+        mHeight = height;
+        mInternalFormat = internalFormat;
+    }
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, width, height, 0, size, data);
+}
+
+void Texture::setSwizzle(const GLint* swizzle)
+{
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+}
+
+void Texture::setLevelCount(uint levels)
+{
+    mLevelCount = levels;
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                    levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    ResourceRegistry::track(RESOURCE_TEXTURE, this,
+                            ResourceRegistry::getTextureSize(
+                                mInternalFormat, glm::max(mWidth >> mBaseLevel, 1u),
+                                glm::max(mHeight >> mBaseLevel, 1u), levels - mBaseLevel));
+}
+
+void Texture::setBaseLevel(uint level)
+{
+    mBaseLevel = level;
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    ResourceRegistry::track(RESOURCE_TEXTURE, this,
+                            ResourceRegistry::getTextureSize(
+                                mInternalFormat, glm::max(mWidth >> level, 1u),
+                                glm::max(mHeight >> level, 1u), mLevelCount - level));
+}
+
+void Texture::clearMipLevel(uint level)
+{
+    // An empty image frees the level, and levels outside the base and max level range don't
+    // affect completeness
+    GLState::bindTexture(GL_TEXTURE_2D, mTextureID);
+    glTexImage2D(GL_TEXTURE_2D, level, mInternalFormat, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 }
 
 GLuint Texture::getId() const
@@ -67,3 +244,23 @@ uint Texture::getHeight() const
 {
     return mHeight;
 }
+
+uint Texture::getLevelCount() const
+{
+    return mLevelCount;
+}
+
+uint Texture::getBaseLevel() const
+{
+    return mBaseLevel;
+}
+
+GLenum Texture::getInternalFormat() const
+{
+    return mInternalFormat;
+}
+
+bool Texture::isLoaded() const
+{
+    return mLoaded;
+}
@@ -4,22 +4,78 @@
  */
 #pragma once
 
+#include "TextureCompressor.h"
+
+class TextureFile;
+
 class Texture
 {
 public:
+    // Load an image file, generating its mip chain on the CPU. DDS and KTX2 files are uploaded
+    // as they are stored, without decoding
     Texture(const string& file);
     Texture(uint width, uint height, GLuint format = GL_RGB, GLuint type = GL_UNSIGNED_BYTE);
+
+    // An empty block compressed texture, whose levels are given with setCompressedMipLevel. No
+    // level has any storage until it is set, so a texture can be filled in from its smallest
+    // level up with setBaseLevel
+    Texture(BlockFormat format, uint width, uint height, uint levelCount);
     ~Texture();
 
     void bind(uint unit);
 
+    // Replace the image with a single level. If a pixel unpack buffer is bound, 'data' is an
+    // offset into it
+    void setData(uint width, uint height, GLenum internalFormat, GLenum format, GLenum type,
+                 const void* data);
+
+    // Replace every level with the block compressed mip chain in a texture file, read straight
+    // from its mapping. Throws if the driver doesn't support the file's format. Once a texture has
+    // been given a file, it can only be given files with the same size, format and level count
+    void setData(const TextureFile& file);
+
+    // Replace a single mip level. Call setLevelCount once every level has been set
+    void setMipLevel(uint level, uint width, uint height, GLenum internalFormat, GLenum format,
+                     GLenum type, const void* data);
+
+    // Replace a single mip level with block compressed data
+    void setCompressedMipLevel(uint level, uint width, uint height, GLenum internalFormat,
+                               uint size, const void* data);
+
+    // Map the stored channels onto the RGBA seen by shaders
+    void setSwizzle(const GLint* swizzle);
+
+    // Set the number of levels to sample from. Textures with more than one level use trilinear
+    // filtering
+    void setLevelCount(uint levels);
+
+    // Set the finest level to sample from. Levels above it don't need to be specified, so a
+    // texture can hold only its coarser levels
+    void setBaseLevel(uint level);
+
+    // Release the storage of a level above the base level
+    void clearMipLevel(uint level);
+
     GLuint getId() const;
     uint getWidth() const;
     uint getHeight() const;
+    uint getLevelCount() const;
+    uint getBaseLevel() const;
+    GLenum getInternalFormat() const;
+
+    // False while an AsyncTextureLoader is still filling in a placeholder
+    bool isLoaded() const;
 
 private:
     GLuint mTextureID;
 
     uint mWidth;
     uint mHeight;
+    GLenum mInternalFormat;
+    bool mLoaded;
+    bool mImmutable;
+    uint mLevelCount;
+    uint mBaseLevel;
+
+    friend class AsyncTextureLoader;
 };
@@ -0,0 +1,109 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "GLState.h"
+#include "ResourceRegistry.h"
+#include "TextureArray.h"
+
+TextureArray::TextureArray(uint width, uint height, uint layers, uint levels,
+                           GLenum internalFormat)
+    : mWidth(width),
+      mHeight(height),
+      mLayerCount(layers),
+      mLevelCount(levels),
+      mInternalFormat(internalFormat)
+{
+    glGenTextures(1, &mTextureID);
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+
+    // Filtering
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                    levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    // Create storage. Without glTexStorage3D each level is allocated separately, which also works
+    // for compressed formats when no data is given
+    if (gl3wIsSupported(4, 2))
+    {
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat, width, height, layers);
+    }
+    else
+    {
+        for (uint level = 0; level < levels; level++)
+        {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat,
+                         glm::max(width >> level, 1u), glm::max(height >> level, 1u), layers, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        }
+    }
+    ResourceRegistry::track(RESOURCE_TEXTURE, this,
+                            ResourceRegistry::getTextureSize(internalFormat, width, height, levels) *
+                                layers,
+                            "TextureArray");
+}
+
+TextureArray::~TextureArray()
+{
+    GLState::forgetTexture(mTextureID);
+    glDeleteTextures(1, &mTextureID);
+    ResourceRegistry::release(this);
+}
+
+void TextureArray::bind(uint unit)
+{
+    GLState::bindTexture(unit, GL_TEXTURE_2D_ARRAY, mTextureID);
+}
+
+void TextureArray::setLayer(uint layer, uint level, GLenum format, GLenum type, const void* data)
+{
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, glm::max(mWidth >> level, 1u),
+                    glm::max(mHeight >> level, 1u), 1, format, type, data);
+}
+
+void TextureArray::setCompressedLayer(uint layer, uint level, uint size, const void* data)
+{
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+                              glm::max(mWidth >> level, 1u), glm::max(mHeight >> level, 1u), 1,
+                              mInternalFormat, size, data);
+}
+
+void TextureArray::setSwizzle(const GLint* swizzle)
+{
+    GLState::bindTexture(GL_TEXTURE_2D_ARRAY, mTextureID);
+    glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+}
+
+GLuint TextureArray::getId() const
+{
+    return mTextureID;
+}
+
+uint TextureArray::getWidth() const
+{
+    return mWidth;
+}
+
+uint TextureArray::getHeight() const
+{
+    return mHeight;
+}
+
+uint TextureArray::getLayerCount() const
+{
+    return mLayerCount;
+}
+
+uint TextureArray::getLevelCount() const
+{
+    return mLevelCount;
+}
+
+GLenum TextureArray::getInternalFormat() const
+{
+    return mInternalFormat;
+}
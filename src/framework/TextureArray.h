@@ -0,0 +1,45 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// A GL_TEXTURE_2D_ARRAY whose layers share a size, format and level count. Shaders sample it with
+// a sampler2DArray and the layer as the third texture coordinate, so every texture in the array is
+// available from a single bind
+class TextureArray
+{
+public:
+    // Allocates every layer and level. Compressed formats are sized in 4x4 blocks
+    TextureArray(uint width, uint height, uint layers, uint levels, GLenum internalFormat);
+    ~TextureArray();
+
+    void bind(uint unit);
+
+    // Replace one level of a layer. 'format' and 'type' are ignored for compressed formats
+    void setLayer(uint layer, uint level, GLenum format, GLenum type, const void* data);
+    void setCompressedLayer(uint layer, uint level, uint size, const void* data);
+
+    // Map the stored channels onto the RGBA seen by shaders
+    void setSwizzle(const GLint* swizzle);
+
+    GLuint getId() const;
+    uint getWidth() const;
+    uint getHeight() const;
+    uint getLayerCount() const;
+    uint getLevelCount() const;
+    GLenum getInternalFormat() const;
+
+private:
+    GLuint mTextureID;
+
+    uint mWidth;
+    uint mHeight;
+    uint mLayerCount;
+    uint mLevelCount;
+    GLenum mInternalFormat;
+
+    // Non-copyable
+    TextureArray(const TextureArray&);
+    TextureArray& operator=(const TextureArray&);
+};
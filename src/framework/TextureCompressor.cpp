@@ -0,0 +1,569 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "TextureCompressor.h"
+
+#include <cmath>
+#include <cstring>
+
+// SSE2 is always available on x86-64, so no extra compiler flags are needed
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace compressor
+{
+
+namespace
+{
+
+// A 4x4 block split into channels, so the palette search can work on 4 texels at a time
+struct Block
+{
+    float channels[4][16];
+};
+
+void loadBlock(const uint8_t* pixels, uint width, uint height, uint blockX, uint blockY,
+               Block& block)
+{
+    for (uint y = 0; y < 4; y++)
+    {
+        uint sourceY = glm::min(blockY * 4 + y, height - 1);
+        for (uint x = 0; x < 4; x++)
+        {
+            uint sourceX = glm::min(blockX * 4 + x, width - 1);
+            const uint8_t* pixel = pixels + (sourceY * width + sourceX) * 4;
+            for (uint c = 0; c < 4; c++)
+                block.channels[c][y * 4 + x] = pixel[c];
+        }
+    }
+}
+
+// Find the nearest palette entry to each of the 16 texels over 'channelCount' channels, where
+// the palette holds 'entryCount' entries of 'channelCount' values. Ties go to the lowest entry.
+// Returns the total squared error
+float findNearest(const float* const* channels, uint channelCount, const float* palette,
+                  uint entryCount, uint8_t* indices)
+{
+#ifdef COMPRESSOR_SSE2
+    __m128 totalError = _mm_setzero_ps();
+    for (uint i = 0; i < 16; i += 4)
+    {
+        __m128 bestError = _mm_set1_ps(1e30f);
+        __m128i bestIndex = _mm_setzero_si128();
+        for (uint e = 0; e < entryCount; e++)
+        {
+            __m128 error = _mm_setzero_ps();
+            for (uint c = 0; c < channelCount; c++)
+            {
+                __m128 d = _mm_sub_ps(_mm_loadu_ps(channels[c] + i),
+                                      _mm_set1_ps(palette[e * channelCount + c]));
+                error = _mm_add_ps(error, _mm_mul_ps(d, d));
+            }
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+            bestError = _mm_min_ps(error, bestError);
+            bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(e)),
+                                     _mm_andnot_si128(closer, bestIndex));
+        }
+        totalError = _mm_add_ps(totalError, bestError);
+
+        int32_t lanes[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), bestIndex);
+        for (uint k = 0; k < 4; k++)
+            indices[i + k] = (uint8_t)lanes[k];
+    }
+
+    float errors[4];
+    _mm_storeu_ps(errors, totalError);
+    return errors[0] + errors[1] + errors[2] + errors[3];
+#else
+    float totalError = 0.0f;
+    for (uint i = 0; i < 16; i++)
+    {
+        float bestError = 1e30f;
+        for (uint e = 0; e < entryCount; e++)
+        {
+            float error = 0.0f;
+            for (uint c = 0; c < channelCount; c++)
+            {
+                float d = channels[c][i] - palette[e * channelCount + c];
+                error += d * d;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = e;
+            }
+        }
+        totalError += bestError;
+    }
+    return totalError;
+#endif
+}
+
+// Encode a single channel as two 8 bit endpoints and 16 3 bit indices. The endpoints are
+// ordered so that the block uses the mode with 6 interpolated values
+void encodeChannelBlock(const float* values, uint8_t* out)
+{
+    float minValue = values[0], maxValue = values[0];
+    for (uint i = 1; i < 16; i++)
+    {
+        minValue = glm::min(minValue, values[i]);
+        maxValue = glm::max(maxValue, values[i]);
+    }
+
+    uint8_t a0 = (uint8_t)maxValue, a1 = (uint8_t)minValue;
+    uint8_t indices[16] = {0};
+    if (a0 != a1)
+    {
+        float palette[8] = {(float)a0, (float)a1};
+        for (uint i = 2; i < 8; i++)
+            palette[i] = ((8 - i) * a0 + (i - 1) * a1) / 7.0f;
+        findNearest(&values, 1, palette, 8, indices);
+    }
+
+    out[0] = a0;
+    out[1] = a1;
+    uint64 bits = 0;
+    for (uint i = 0; i < 16; i++)
+        bits |= (uint64)indices[i] << (i * 3);
+    for (uint i = 0; i < 6; i++)
+        out[2 + i] = (uint8_t)(bits >> (i * 8));
+}
+
+void decodeChannelBlock(const uint8_t* in, uint8_t* values)
+{
+    uint a0 = in[0], a1 = in[1];
+    uint8_t palette[8] = {(uint8_t)a0, (uint8_t)a1};
+    if (a0 > a1)
+    {
+        for (uint i = 2; i < 8; i++)
+            palette[i] = (uint8_t)(((8 - i) * a0 + (i - 1) * a1) / 7.0f + 0.5f);
+    }
+    else
+    {
+        for (uint i = 2; i < 6; i++)
+            palette[i] = (uint8_t)(((6 - i) * a0 + (i - 1) * a1) / 5.0f + 0.5f);
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+
+    uint64 bits = 0;
+    for (uint i = 0; i < 6; i++)
+        bits |= (uint64)in[2 + i] << (i * 8);
+    for (uint i = 0; i < 16; i++)
+        values[i] = palette[(bits >> (i * 3)) & 7];
+}
+
+uint16_t packColour(const glm::vec3& colour)
+{
+    glm::vec3 c = glm::clamp(colour, 0.0f, 255.0f);
+    uint r = (uint)(c.r * 31.0f / 255.0f + 0.5f);
+    uint g = (uint)(c.g * 63.0f / 255.0f + 0.5f);
+    uint b = (uint)(c.b * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+glm::vec3 unpackColour(uint16_t colour)
+{
+    uint r = colour >> 11, g = (colour >> 5) & 63, b = colour & 31;
+    return glm::vec3((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2));
+}
+
+float evaluateColourEndpoints(const Block& block, uint16_t c0, uint16_t c1, uint8_t* indices)
+{
+    glm::vec3 e0 = unpackColour(c0), e1 = unpackColour(c1);
+    glm::vec3 entries[4] = {e0, e1, (e0 * 2.0f + e1) / 3.0f, (e0 + e1 * 2.0f) / 3.0f};
+    float palette[12];
+    for (uint e = 0; e < 4; e++)
+    {
+        palette[e * 3] = entries[e].r;
+        palette[e * 3 + 1] = entries[e].g;
+        palette[e * 3 + 2] = entries[e].b;
+    }
+    const float* channels[3] = {block.channels[0], block.channels[1], block.channels[2]};
+    return findNearest(channels, 3, palette, 4, indices);
+}
+
+// Encode the colour of a block as two 565 endpoints and 16 2 bit indices, always in four colour
+// mode so that it can also be used for BC3
+void encodeColourBlock(const Block& block, uint8_t* out)
+{
+    glm::vec3 colours[16];
+    glm::vec3 mean(0.0f);
+    for (uint i = 0; i < 16; i++)
+    {
+        colours[i] = glm::vec3(block.channels[0][i], block.channels[1][i], block.channels[2][i]);
+        mean += colours[i];
+    }
+    mean /= 16.0f;
+
+    // Fit the endpoints to the principal axis of the colours, found by power iteration
+    glm::mat3 covariance(0.0f);
+    for (uint i = 0; i < 16; i++)
+    {
+        glm::vec3 d = colours[i] - mean;
+        covariance += glm::outerProduct(d, d);
+    }
+    glm::vec3 axis(1.0f);
+    for (uint iteration = 0; iteration < 8; iteration++)
+    {
+        glm::vec3 next = covariance * axis;
+        float length = glm::length(next);
+        if (length < 1e-6f)
+            break;
+        axis = next / length;
+    }
+    axis = glm::normalize(axis);
+    float minT = 0.0f, maxT = 0.0f;
+    for (uint i = 0; i < 16; i++)
+    {
+        float t = glm::dot(colours[i] - mean, axis);
+        minT = glm::min(minT, t);
+        maxT = glm::max(maxT, t);
+    }
+
+    uint16_t c0 = packColour(mean + axis * maxT), c1 = packColour(mean + axis * minT);
+    uint8_t indices[16];
+    float error = evaluateColourEndpoints(block, c0, c1, indices);
+
+    // Refine the endpoints by least squares, given the palette entry each texel was assigned
+    const float weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    for (uint iteration = 0; iteration < 2 && error > 0.0f; iteration++)
+    {
+        float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+        glm::vec3 ax(0.0f), bx(0.0f);
+        for (uint i = 0; i < 16; i++)
+        {
+            float a = weights[indices[i]], b = 1.0f - a;
+            aa += a * a;
+            bb += b * b;
+            ab += a * b;
+            ax += colours[i] * a;
+            bx += colours[i] * b;
+        }
+        float determinant = aa * bb - ab * ab;
+        if (fabsf(determinant) < 1e-6f)
+            break;
+
+        uint16_t n0 = packColour((ax * bb - bx * ab) / determinant);
+        uint16_t n1 = packColour((bx * aa - ax * ab) / determinant);
+        uint8_t newIndices[16];
+        float newError = evaluateColourEndpoints(block, n0, n1, newIndices);
+        if (newError >= error)
+            break;
+        error = newError;
+        c0 = n0;
+        c1 = n1;
+        memcpy(indices, newIndices, sizeof(indices));
+    }
+
+    // Four colour mode needs c0 > c1. Swapping the endpoints swaps entries 0 and 1, and 2 and 3
+    if (c0 < c1)
+    {
+        std::swap(c0, c1);
+        for (uint i = 0; i < 16; i++)
+            indices[i] ^= 1;
+    }
+    else if (c0 == c1)
+    {
+        memset(indices, 0, sizeof(indices));
+    }
+
+    uint32_t bits = 0;
+    for (uint i = 0; i < 16; i++)
+        bits |= (uint32_t)indices[i] << (i * 2);
+    out[0] = (uint8_t)c0;
+    out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)c1;
+    out[3] = (uint8_t)(c1 >> 8);
+    for (uint i = 0; i < 4; i++)
+        out[4 + i] = (uint8_t)(bits >> (i * 8));
+}
+
+// Decode a colour block to 16 RGBA texels. BC1 blocks with c0 <= c1 have three colours and
+// transparent black, but BC3 colour blocks always have four
+void decodeColourBlock(const uint8_t* in, bool alwaysFourColours, uint8_t* texels)
+{
+    uint16_t c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8);
+    glm::vec3 e0 = unpackColour(c0), e1 = unpackColour(c1);
+    glm::vec4 palette[4] = {glm::vec4(e0, 255.0f), glm::vec4(e1, 255.0f)};
+    if (c0 > c1 || alwaysFourColours)
+    {
+        palette[2] = glm::vec4((e0 * 2.0f + e1) / 3.0f, 255.0f);
+        palette[3] = glm::vec4((e0 + e1 * 2.0f) / 3.0f, 255.0f);
+    }
+    else
+    {
+        palette[2] = glm::vec4((e0 + e1) * 0.5f, 255.0f);
+        palette[3] = glm::vec4(0.0f);
+    }
+
+    uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+    for (uint i = 0; i < 16; i++)
+    {
+        const glm::vec4& colour = palette[(bits >> (i * 2)) & 3];
+        for (uint c = 0; c < 4; c++)
+            texels[i * 4 + c] = (uint8_t)(colour[c] + 0.5f);
+    }
+}
+
+}
+
+ChannelUsage analyseChannels(const uint8_t* pixels, uint width, uint height)
+{
+    ChannelUsage usage = {false, true, false};
+    for (uint i = 0; i < width * height * 4; i += 4)
+    {
+        usage.alpha |= pixels[i + 3] < 255;
+        usage.greyscale &= pixels[i] == pixels[i + 1] && pixels[i] == pixels[i + 2];
+        usage.blue |= pixels[i + 2] > 0;
+    }
+    return usage;
+}
+
+BlockFormat chooseFormat(const ChannelUsage& usage)
+{
+    if (usage.alpha)
+        return BLOCK_FORMAT_BC3;
+    if (usage.greyscale)
+        return BLOCK_FORMAT_BC4;
+    if (!usage.blue)
+        return BLOCK_FORMAT_BC5;
+    return BLOCK_FORMAT_BC1;
+}
+
+CompressedImage compress(const uint8_t* pixels, uint width, uint height, BlockFormat format)
+{
+    CompressedImage image;
+    image.format = format;
+    image.width = width;
+    image.height = height;
+    image.data.resize(getCompressedSize(format, width, height));
+
+    uint blockSize = getBlockSize(format);
+    uint8_t* out = image.data.data();
+    Block block;
+    for (uint blockY = 0; blockY < (height + 3) / 4; blockY++)
+    {
+        for (uint blockX = 0; blockX < (width + 3) / 4; blockX++)
+        {
+            loadBlock(pixels, width, height, blockX, blockY, block);
+            switch (format)
+            {
+            case BLOCK_FORMAT_BC1:
+                encodeColourBlock(block, out);
+                break;
+
+            case BLOCK_FORMAT_BC3:
+                encodeChannelBlock(block.channels[3], out);
+                encodeColourBlock(block, out + 8);
+                break;
+
+            case BLOCK_FORMAT_BC4:
+                encodeChannelBlock(block.channels[0], out);
+                break;
+
+            case BLOCK_FORMAT_BC5:
+                encodeChannelBlock(block.channels[0], out);
+                encodeChannelBlock(block.channels[1], out + 8);
+                break;
+            }
+            out += blockSize;
+        }
+    }
+    return image;
+}
+
+vector<uint8_t> decompress(const CompressedImage& image)
+{
+    vector<uint8_t> pixels(image.width * image.height * 4);
+    uint blockSize = getBlockSize(image.format);
+    const uint8_t* in = image.data.data();
+    uint8_t texels[64], values[2][16];
+    for (uint blockY = 0; blockY < (image.height + 3) / 4; blockY++)
+    {
+        for (uint blockX = 0; blockX < (image.width + 3) / 4; blockX++)
+        {
+            switch (image.format)
+            {
+            case BLOCK_FORMAT_BC1:
+                decodeColourBlock(in, false, texels);
+                break;
+
+            case BLOCK_FORMAT_BC3:
+                decodeColourBlock(in + 8, true, texels);
+                decodeChannelBlock(in, values[0]);
+                for (uint i = 0; i < 16; i++)
+                    texels[i * 4 + 3] = values[0][i];
+                break;
+
+            case BLOCK_FORMAT_BC4:
+                decodeChannelBlock(in, values[0]);
+                for (uint i = 0; i < 16; i++)
+                {
+                    texels[i * 4] = texels[i * 4 + 1] = texels[i * 4 + 2] = values[0][i];
+                    texels[i * 4 + 3] = 255;
+                }
+                break;
+
+            case BLOCK_FORMAT_BC5:
+                decodeChannelBlock(in, values[0]);
+                decodeChannelBlock(in + 8, values[1]);
+                for (uint i = 0; i < 16; i++)
+                {
+                    texels[i * 4] = values[0][i];
+                    texels[i * 4 + 1] = values[1][i];
+                    texels[i * 4 + 2] = 0;
+                    texels[i * 4 + 3] = 255;
+                }
+                break;
+            }
+            in += blockSize;
+
+            // Drop the padding outside of the image
+            for (uint y = 0; y < 4 && blockY * 4 + y < image.height; y++)
+            {
+                for (uint x = 0; x < 4 && blockX * 4 + x < image.width; x++)
+                {
+                    uint8_t* pixel = &pixels[((blockY * 4 + y) * image.width + blockX * 4 + x) * 4];
+                    memcpy(pixel, &texels[(y * 4 + x) * 4], 4);
+                }
+            }
+        }
+    }
+    return pixels;
+}
+
+float computePsnr(const uint8_t* original, const uint8_t* decoded, uint width, uint height,
+                  BlockFormat format)
+{
+    uint channelCount = format == BLOCK_FORMAT_BC3 ? 4 : 3;
+    uint64 squaredError = 0;
+    for (uint i = 0; i < width * height * 4; i += 4)
+    {
+        for (uint c = 0; c < channelCount; c++)
+        {
+            int d = (int)original[i + c] - decoded[i + c];
+            squaredError += (uint64)(d * d);
+        }
+    }
+
+    // Identical images have an infinite PSNR, so report a ceiling instead
+    if (squaredError == 0)
+        return 100.0f;
+    double mse = (double)squaredError / ((double)width * height * channelCount);
+    return (float)(10.0 * log10(255.0 * 255.0 / mse));
+}
+
+CompressionReport benchmark(const uint8_t* pixels, uint width, uint height, BlockFormat format)
+{
+    // Take the best of a few runs to hide any interruptions
+    CompressedImage image;
+    float bestSeconds = 1e9f;
+    for (uint run = 0; run < 3; run++)
+    {
+        uint64 start = SDL_GetPerformanceCounter();
+        image = compress(pixels, width, height, format);
+        float seconds =
+            (float)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+        bestSeconds = glm::min(bestSeconds, seconds);
+    }
+
+    vector<uint8_t> decoded = decompress(image);
+    CompressionReport report;
+    report.format = format;
+    report.psnr = computePsnr(pixels, decoded.data(), width, height, format);
+    report.megapixelsPerSecond = width * height / 1000000.0f / bestSeconds;
+    report.ratio = (float)(width * height * 4) / image.data.size();
+    return report;
+}
+
+void printReport(const string& name, const CompressionReport& report)
+{
+    INFO << "Compressed '" << name << "' as " << getFormatName(report.format) << ": "
+         << report.psnr << " dB PSNR, " << report.ratio << ":1, " << report.megapixelsPerSecond
+         << " MP/s" << endl;
+}
+
+uint getBlockSize(BlockFormat format)
+{
+    return format == BLOCK_FORMAT_BC1 || format == BLOCK_FORMAT_BC4 ? 8 : 16;
+}
+
+uint getCompressedSize(BlockFormat format, uint width, uint height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+}
+
+GLenum getInternalFormat(BlockFormat format)
+{
+    switch (format)
+    {
+    case BLOCK_FORMAT_BC1:
+        return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BLOCK_FORMAT_BC3:
+        return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BLOCK_FORMAT_BC4:
+        return GL_COMPRESSED_RED_RGTC1;
+    case BLOCK_FORMAT_BC5:
+    default:
+        return GL_COMPRESSED_RG_RGTC2;
+    }
+}
+
+void getSwizzle(BlockFormat format, GLint* swizzle)
+{
+    GLint colour[4] = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+    GLint grey[4] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+    GLint twoChannel[4] = {GL_RED, GL_GREEN, GL_ZERO, GL_ONE};
+    const GLint* source = format == BLOCK_FORMAT_BC4 ? grey :
+                          format == BLOCK_FORMAT_BC5 ? twoChannel : colour;
+    memcpy(swizzle, source, sizeof(colour));
+}
+
+bool isFormatSupported(BlockFormat format)
+{
+    if (format == BLOCK_FORMAT_BC4 || format == BLOCK_FORMAT_BC5)
+        return true;
+
+    static int supported = -1;
+    if (supported == -1)
+    {
+        supported = 0;
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount; i++)
+        {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (strcmp(extension, "GL_EXT_texture_compression_s3tc") == 0)
+            {
+                supported = 1;
+                break;
+            }
+        }
+    }
+    return supported == 1;
+}
+
+const char* getFormatName(BlockFormat format)
+{
+    switch (format)
+    {
+    case BLOCK_FORMAT_BC1:
+        return "BC1";
+    case BLOCK_FORMAT_BC3:
+        return "BC3";
+    case BLOCK_FORMAT_BC4:
+        return "BC4";
+    case BLOCK_FORMAT_BC5:
+        return "BC5";
+    default:
+        return "Unknown";
+    }
+}
+
+}
@@ -0,0 +1,84 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+// GL_EXT_texture_compression_s3tc is an extension, so isn't in the core profile headers
+#ifndef GL_EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+enum BlockFormat
+{
+    BLOCK_FORMAT_BC1, // RGB, 8 bytes per block
+    BLOCK_FORMAT_BC3, // RGBA, 16 bytes per block
+    BLOCK_FORMAT_BC4, // Greyscale, sampled as (R, R, R, 1). 8 bytes per block
+    BLOCK_FORMAT_BC5  // Two channels, sampled as (R, G, 0, 1). 16 bytes per block
+};
+
+// Which channels of an RGBA8 image carry information
+struct ChannelUsage
+{
+    bool alpha;     // Any alpha below 255
+    bool greyscale; // Red, green and blue are equal everywhere
+    bool blue;      // Any blue above 0
+};
+
+// A single block compressed image. Blocks are 4x4 texels in rows, and images whose size isn't a
+// multiple of 4 are padded by repeating their edge texels
+struct CompressedImage
+{
+    BlockFormat format;
+    uint width;
+    uint height;
+    vector<uint8_t> data;
+};
+
+// Quality and speed of compressing an image
+struct CompressionReport
+{
+    BlockFormat format;
+    float psnr; // Decibels, over the channels the format stores
+    float megapixelsPerSecond;
+    float ratio; // Uncompressed RGBA8 size over compressed size
+};
+
+namespace compressor {
+
+ChannelUsage analyseChannels(const uint8_t* pixels, uint width, uint height);
+
+// The smallest format which keeps every channel that is used
+BlockFormat chooseFormat(const ChannelUsage& usage);
+
+// Compress an RGBA8 image. Endpoints are fitted along the principal axis of each block, then
+// refined by least squares, and the nearest palette entries are searched with SSE2
+CompressedImage compress(const uint8_t* pixels, uint width, uint height, BlockFormat format);
+
+// Decode to RGBA8 as the GPU would sample it, including the swizzle
+vector<uint8_t> decompress(const CompressedImage& image);
+
+// Peak signal to noise ratio between two RGBA8 images, over the channels 'format' stores
+float computePsnr(const uint8_t* original, const uint8_t* decoded, uint width, uint height,
+                  BlockFormat format);
+
+// Time compressing an image and measure the result against the original. Needs no GL context
+CompressionReport benchmark(const uint8_t* pixels, uint width, uint height, BlockFormat format);
+void printReport(const string& name, const CompressionReport& report);
+
+uint getBlockSize(BlockFormat format);
+uint getCompressedSize(BlockFormat format, uint width, uint height);
+GLenum getInternalFormat(BlockFormat format);
+
+// Texture swizzle which maps the stored channels onto RGBA
+void getSwizzle(BlockFormat format, GLint* swizzle);
+
+// BC4 and BC5 are core, but BC1 and BC3 need GL_EXT_texture_compression_s3tc
+bool isFormatSupported(BlockFormat format);
+
+const char* getFormatName(BlockFormat format);
+
+}
@@ -0,0 +1,457 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "MipGenerator.h"
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+#define DDS_MAGIC 0x20534444 // "DDS "
+#define DDS_FLAGS 0x000A1007 // CAPS | HEIGHT | WIDTH | PIXELFORMAT | MIPMAPCOUNT | LINEARSIZE
+#define DDS_PIXEL_FORMAT_FOURCC 0x4
+#define DDS_CAPS_TEXTURE 0x1000
+#define DDS_CAPS_MIPMAP 0x400008 // MIPMAP | COMPLEX
+#define DDS_DXGI_TEXTURE_2D 3
+
+struct DdsPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t bitMasks[4];
+};
+
+struct DdsHeader
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitchOrLinearSize;
+    uint32_t depth;
+    uint32_t mipMapCount;
+    uint32_t reserved1[11];
+    DdsPixelFormat pixelFormat;
+    uint32_t caps[4];
+    uint32_t reserved2;
+};
+
+// Follows DdsHeader when the FourCC is "DX10"
+struct DdsHeaderDx10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DdsHeader) == 124, "DDS header must be 124 bytes");
+
+const uint8_t kKtx2Identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB,
+                                     '\r', '\n', 0x1A, '\n'};
+
+struct Ktx2Header
+{
+    uint8_t identifier[12];
+    uint32_t vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    uint32_t supercompressionScheme;
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2Level
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must be 80 bytes");
+
+constexpr uint32_t makeFourCC(char a, char b, char c, char d)
+{
+    return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+}
+
+// How each block format is identified by the containers
+struct FormatInfo
+{
+    BlockFormat format;
+    uint32_t fourCC;
+    uint32_t alternateFourCC;
+    uint32_t dxgiFormat;
+    uint32_t vkFormat;
+    uint32_t colourModel; // KTX2 data format descriptor colour model
+};
+
+const FormatInfo kFormats[] = {
+    {BLOCK_FORMAT_BC1, makeFourCC('D', 'X', 'T', '1'), 0, 71, 131, 128},
+    {BLOCK_FORMAT_BC3, makeFourCC('D', 'X', 'T', '5'), 0, 77, 137, 130},
+    {BLOCK_FORMAT_BC4, makeFourCC('A', 'T', 'I', '1'), makeFourCC('B', 'C', '4', 'U'), 80, 139,
+     131},
+    {BLOCK_FORMAT_BC5, makeFourCC('A', 'T', 'I', '2'), makeFourCC('B', 'C', '5', 'U'), 83, 141,
+     132}};
+const uint kFormatCount = sizeof(kFormats) / sizeof(kFormats[0]);
+
+// Largest width or height accepted, which keeps the size of every level well within a uint
+const uint kMaxDimension = 16384;
+
+void throwFormatError(const string& filename, const string& reason)
+{
+    stringstream err;
+    err << "Error: Invalid texture file '" << filename << "': " << reason << endl;
+    throw std::runtime_error(err.str());
+}
+
+void validateDimensions(const string& filename, uint width, uint height, uint levelCount)
+{
+    if (width == 0 || height == 0 || width > kMaxDimension || height > kMaxDimension)
+        throwFormatError(filename, "bad dimensions");
+    if (levelCount > mipgen::getLevelCount(width, height))
+        throwFormatError(filename, "more mip levels than the dimensions allow");
+}
+
+string getExtension(const string& filename)
+{
+    size_t dot = filename.rfind('.');
+    if (dot == string::npos)
+        return "";
+    string extension = filename.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+const FormatInfo& getFormatInfo(BlockFormat format)
+{
+    for (uint i = 0; i < kFormatCount; i++)
+    {
+        if (kFormats[i].format == format)
+            return kFormats[i];
+    }
+    return kFormats[0];
+}
+
+uint64_t alignOffset(uint64_t offset, uint alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+void writePadding(std::ofstream& file, uint64_t from, uint64_t to)
+{
+    const char padding[16] = {0};
+    file.write(padding, to - from);
+}
+
+void writeDds(std::ofstream& file, const vector<CompressedImage>& levels)
+{
+    const FormatInfo& info = getFormatInfo(levels[0].format);
+    DdsHeader header;
+    memset(&header, 0, sizeof(header));
+    header.size = sizeof(DdsHeader);
+    header.flags = DDS_FLAGS;
+    header.height = levels[0].height;
+    header.width = levels[0].width;
+    header.pitchOrLinearSize = levels[0].data.size();
+    header.mipMapCount = levels.size();
+    header.pixelFormat.size = sizeof(DdsPixelFormat);
+    header.pixelFormat.flags = DDS_PIXEL_FORMAT_FOURCC;
+    header.pixelFormat.fourCC = info.fourCC;
+    header.caps[0] = DDS_CAPS_TEXTURE | (levels.size() > 1 ? DDS_CAPS_MIPMAP : 0);
+
+    uint32_t magic = DDS_MAGIC;
+    file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (auto i = levels.begin(); i != levels.end(); i++)
+        file.write(reinterpret_cast<const char*>(i->data.data()), i->data.size());
+}
+
+// Build the basic data format descriptor which KTX2 requires, with one sample per 64 bit half of
+// a block
+vector<uint32_t> buildDataFormatDescriptor(BlockFormat format)
+{
+    const uint32_t channelAlpha = 15, channelRed = 0, channelGreen = 1;
+    vector<uint32_t> channels;
+    if (format == BLOCK_FORMAT_BC3)
+        channels = {channelAlpha, channelRed};
+    else if (format == BLOCK_FORMAT_BC5)
+        channels = {channelRed, channelGreen};
+    else
+        channels = {channelRed};
+
+    uint32_t blockSize = 24 + 16 * channels.size();
+    vector<uint32_t> dfd;
+    dfd.push_back(4 + blockSize);
+    dfd.push_back(0);                       // Khronos vendor, basic descriptor type
+    dfd.push_back(2 | (blockSize << 16));   // Version 2
+    dfd.push_back(getFormatInfo(format).colourModel | (1 << 8) | (1 << 16)); // BT.709, linear
+    dfd.push_back(3 | (3 << 8));            // 4x4 texel blocks
+    dfd.push_back(compressor::getBlockSize(format));
+    dfd.push_back(0);
+    for (uint i = 0; i < channels.size(); i++)
+    {
+        dfd.push_back((i * 64) | (63 << 16) | (channels[i] << 24));
+        dfd.push_back(0);
+        dfd.push_back(0);
+        dfd.push_back(0xFFFFFFFF);
+    }
+    return dfd;
+}
+
+void writeKtx2(std::ofstream& file, const vector<CompressedImage>& levels)
+{
+    BlockFormat format = levels[0].format;
+    vector<uint32_t> dfd = buildDataFormatDescriptor(format);
+
+    Ktx2Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.identifier, kKtx2Identifier, sizeof(kKtx2Identifier));
+    header.vkFormat = getFormatInfo(format).vkFormat;
+    header.typeSize = 1;
+    header.pixelWidth = levels[0].width;
+    header.pixelHeight = levels[0].height;
+    header.faceCount = 1;
+    header.levelCount = levels.size();
+    header.dfdByteOffset = sizeof(Ktx2Header) + sizeof(Ktx2Level) * levels.size();
+    header.dfdByteLength = dfd.size() * sizeof(uint32_t);
+
+    // Levels are stored smallest first, each aligned to a whole block
+    uint alignment = compressor::getBlockSize(format);
+    vector<Ktx2Level> index(levels.size());
+    uint64_t offset = header.dfdByteOffset + header.dfdByteLength;
+    for (int i = levels.size() - 1; i >= 0; i--)
+    {
+        offset = alignOffset(offset, alignment);
+        index[i].byteOffset = offset;
+        index[i].byteLength = index[i].uncompressedByteLength = levels[i].data.size();
+        offset += levels[i].data.size();
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(index.data()), sizeof(Ktx2Level) * index.size());
+    file.write(reinterpret_cast<const char*>(dfd.data()), header.dfdByteLength);
+    offset = header.dfdByteOffset + header.dfdByteLength;
+    for (int i = levels.size() - 1; i >= 0; i--)
+    {
+        writePadding(file, offset, index[i].byteOffset);
+        file.write(reinterpret_cast<const char*>(levels[i].data.data()), levels[i].data.size());
+        offset = index[i].byteOffset + levels[i].data.size();
+    }
+}
+
+}
+
+TextureFile::TextureFile(const string& filename) : mFile(filename)
+{
+    if (mFile.getSize() >= sizeof(Ktx2Header) &&
+        memcmp(mFile.getData(), kKtx2Identifier, sizeof(kKtx2Identifier)) == 0)
+    {
+        parseKtx2(filename);
+    }
+    else if (mFile.getSize() >= sizeof(uint32_t) + sizeof(DdsHeader) &&
+             *reinterpret_cast<const uint32_t*>(mFile.getData()) == DDS_MAGIC)
+    {
+        parseDds(filename);
+    }
+    else
+    {
+        throwFormatError(filename, "not a DDS or KTX2 file");
+    }
+}
+
+TextureFile::~TextureFile()
+{
+}
+
+TextureFileType TextureFile::getType() const
+{
+    return mType;
+}
+
+BlockFormat TextureFile::getFormat() const
+{
+    return mFormat;
+}
+
+uint TextureFile::getWidth() const
+{
+    return mLevels[0].width;
+}
+
+uint TextureFile::getHeight() const
+{
+    return mLevels[0].height;
+}
+
+uint TextureFile::getLevelCount() const
+{
+    return mLevels.size();
+}
+
+const TextureFileLevel& TextureFile::getLevel(uint level) const
+{
+    return mLevels[level];
+}
+
+size_t TextureFile::getSize() const
+{
+    return mFile.getSize();
+}
+
+bool TextureFile::isTextureFile(const string& filename)
+{
+    string extension = getExtension(filename);
+    return extension == ".dds" || extension == ".ktx2";
+}
+
+void TextureFile::write(const string& filename, const vector<CompressedImage>& levels)
+{
+    if (levels.empty())
+        throwFormatError(filename, "no levels to write");
+    for (uint i = 0; i < levels.size(); i++)
+    {
+        uint width = glm::max(levels[0].width >> i, 1u);
+        uint height = glm::max(levels[0].height >> i, 1u);
+        if (levels[i].format != levels[0].format || levels[i].width != width ||
+            levels[i].height != height)
+            throwFormatError(filename, "levels don't form a mip chain");
+    }
+
+    string extension = getExtension(filename);
+    if (extension != ".dds" && extension != ".ktx2")
+        throwFormatError(filename, "unknown extension '" + extension + "'");
+
+    // Write the file
+    std::ofstream file(filename, std::ios::out | std::ios::binary);
+    if (!file.is_open())
+    {
+        stringstream err;
+        err << "Error: Unable to open file '" << filename << "' for writing" << endl;
+        throw std::runtime_error(err.str());
+    }
+    if (extension == ".dds")
+        writeDds(file, levels);
+    else
+        writeKtx2(file, levels);
+}
+
+void TextureFile::parseDds(const string& filename)
+{
+    mType = TEXTURE_FILE_DDS;
+    const DdsHeader* header =
+        reinterpret_cast<const DdsHeader*>(mFile.getData() + sizeof(uint32_t));
+    if (header->size != sizeof(DdsHeader) || header->pixelFormat.size != sizeof(DdsPixelFormat))
+        throwFormatError(filename, "bad header size");
+    if (!(header->pixelFormat.flags & DDS_PIXEL_FORMAT_FOURCC))
+        throwFormatError(filename, "uncompressed formats are not supported");
+
+    // Find the format, either from the FourCC or from the DX10 header
+    uint64_t offset = sizeof(uint32_t) + sizeof(DdsHeader);
+    uint32_t fourCC = header->pixelFormat.fourCC;
+    const FormatInfo* info = nullptr;
+    if (fourCC == makeFourCC('D', 'X', '1', '0'))
+    {
+        if (mFile.getSize() < offset + sizeof(DdsHeaderDx10))
+            throwFormatError(filename, "file is too small");
+        const DdsHeaderDx10* dx10 =
+            reinterpret_cast<const DdsHeaderDx10*>(mFile.getData() + offset);
+        if (dx10->resourceDimension != DDS_DXGI_TEXTURE_2D || dx10->arraySize > 1)
+            throwFormatError(filename, "only single 2D textures are supported");
+        for (uint i = 0; i < kFormatCount; i++)
+        {
+            if (kFormats[i].dxgiFormat == dx10->dxgiFormat)
+                info = &kFormats[i];
+        }
+        offset += sizeof(DdsHeaderDx10);
+    }
+    else
+    {
+        for (uint i = 0; i < kFormatCount; i++)
+        {
+            if (kFormats[i].fourCC == fourCC || kFormats[i].alternateFourCC == fourCC)
+                info = &kFormats[i];
+        }
+    }
+    if (!info)
+        throwFormatError(filename, "unsupported format");
+    mFormat = info->format;
+
+    // Levels follow the header, largest first
+    uint levelCount = glm::max(header->mipMapCount, 1u);
+    validateDimensions(filename, header->width, header->height, levelCount);
+    for (uint i = 0; i < levelCount; i++)
+    {
+        uint width = glm::max(header->width >> i, 1u);
+        uint height = glm::max(header->height >> i, 1u);
+        uint size = compressor::getCompressedSize(mFormat, width, height);
+        addLevel(filename, width, height, offset, size);
+        offset += size;
+    }
+}
+
+void TextureFile::parseKtx2(const string& filename)
+{
+    mType = TEXTURE_FILE_KTX2;
+    const Ktx2Header* header = reinterpret_cast<const Ktx2Header*>(mFile.getData());
+    if (header->supercompressionScheme != 0)
+        throwFormatError(filename, "supercompression is not supported");
+    if (header->pixelDepth > 0 || header->layerCount > 1 || header->faceCount != 1)
+        throwFormatError(filename, "only single 2D textures are supported");
+
+    const FormatInfo* info = nullptr;
+    for (uint i = 0; i < kFormatCount; i++)
+    {
+        if (kFormats[i].vkFormat == header->vkFormat)
+            info = &kFormats[i];
+    }
+    if (!info)
+        throwFormatError(filename, "unsupported format");
+    mFormat = info->format;
+
+    // A level count of 0 asks the loader to generate mips, which isn't supported here
+    if (header->levelCount == 0)
+        throwFormatError(filename, "generating mip levels on load is not supported");
+    uint levelCount = header->levelCount;
+    validateDimensions(filename, header->pixelWidth, header->pixelHeight, levelCount);
+    if (mFile.getSize() < sizeof(Ktx2Header) + sizeof(Ktx2Level) * levelCount)
+        throwFormatError(filename, "file is too small");
+    const Ktx2Level* index =
+        reinterpret_cast<const Ktx2Level*>(mFile.getData() + sizeof(Ktx2Header));
+    for (uint i = 0; i < levelCount; i++)
+    {
+        uint width = glm::max(header->pixelWidth >> i, 1u);
+        uint height = glm::max(header->pixelHeight >> i, 1u);
+        addLevel(filename, width, height, index[i].byteOffset, index[i].byteLength);
+    }
+}
+
+void TextureFile::addLevel(const string& filename, uint width, uint height, uint64_t offset,
+                           uint64_t size)
+{
+    uint requiredSize = compressor::getCompressedSize(mFormat, width, height);
+    if (size < requiredSize)
+        throwFormatError(filename, "level is truncated");
+    if (offset > mFile.getSize() || requiredSize > mFile.getSize() - offset)
+        throwFormatError(filename, "level exceeds the size of the file");
+
+    TextureFileLevel level = {width, height, mFile.getData() + offset, requiredSize};
+    mLevels.push_back(level);
+}
@@ -0,0 +1,60 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include "MappedFile.h"
+#include "TextureCompressor.h"
+
+enum TextureFileType
+{
+    TEXTURE_FILE_DDS,
+    TEXTURE_FILE_KTX2
+};
+
+// A single mip level, pointing into the file mapping
+struct TextureFileLevel
+{
+    uint width;
+    uint height;
+    const uint8_t* data;
+    uint size;
+};
+
+// A DDS or KTX2 container holding a block compressed mip chain. The file is memory mapped and
+// each level is validated against the size its format requires, so the levels can be handed to
+// GL straight from the mapping. Only single 2D images in BC1, BC3, BC4 or BC5 and up to 16384
+// texels on each side are supported
+class TextureFile
+{
+public:
+    // Map and validate a texture file. The container is detected from its contents
+    TextureFile(const string& filename);
+    ~TextureFile();
+
+    TextureFileType getType() const;
+    BlockFormat getFormat() const;
+    uint getWidth() const;
+    uint getHeight() const;
+    uint getLevelCount() const;
+    const TextureFileLevel& getLevel(uint level) const;
+    size_t getSize() const;
+
+    // True if the filename has the extension of a container TextureFile can read
+    static bool isTextureFile(const string& filename);
+
+    // Write a mip chain, largest level first, in the container matching the filename's extension
+    static void write(const string& filename, const vector<CompressedImage>& levels);
+
+private:
+    MappedFile mFile;
+    TextureFileType mType;
+    BlockFormat mFormat;
+    vector<TextureFileLevel> mLevels;
+
+    void parseDds(const string& filename);
+    void parseKtx2(const string& filename);
+    void addLevel(const string& filename, uint width, uint height, uint64_t offset,
+                  uint64_t size);
+};
@@ -0,0 +1,263 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "ResourceRegistry.h"
+#include "TextureArray.h"
+#include "TexturePacker.h"
+
+#include <tuple>
+#include <stb_image.h>
+
+namespace
+{
+
+uint getMaxLayers()
+{
+    GLint maxLayers;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    return maxLayers;
+}
+
+}
+
+bool TextureArrayFormat::operator<(const TextureArrayFormat& other) const
+{
+    return std::tie(internalFormat, width, height, levels) <
+           std::tie(other.internalFormat, other.width, other.height, other.levels);
+}
+
+TextureLayerAllocator::TextureLayerAllocator(uint maxLayers) : mMaxLayers(maxLayers)
+{
+    assert(maxLayers > 0);
+}
+
+TextureLayer TextureLayerAllocator::allocate(const TextureArrayFormat& format)
+{
+    // Start a new array if there isn't one for this format, or it has run out of layers
+    auto open = mOpenArrays.find(format);
+    if (open == mOpenArrays.end() || mArrays[open->second].layerCount == mMaxLayers)
+    {
+        AllocatedArray allocated = {format, 0};
+        mArrays.push_back(allocated);
+        mOpenArrays[format] = mArrays.size() - 1;
+        open = mOpenArrays.find(format);
+    }
+
+    TextureLayer layer = {open->second, mArrays[open->second].layerCount++};
+    return layer;
+}
+
+void TextureLayerAllocator::close()
+{
+    mOpenArrays.clear();
+}
+
+uint TextureLayerAllocator::getArrayCount() const
+{
+    return mArrays.size();
+}
+
+const TextureArrayFormat& TextureLayerAllocator::getFormat(uint array) const
+{
+    return mArrays[array].format;
+}
+
+uint TextureLayerAllocator::getLayerCount(uint array) const
+{
+    return mArrays[array].layerCount;
+}
+
+TexturePacker::TexturePacker(MipFilter filter, bool compression, uint maxLayers)
+    : mMipFilter(filter),
+      mCompression(compression),
+      mAllocator(maxLayers > 0 ? maxLayers : getMaxLayers()),
+      mTextureCount(0)
+{
+}
+
+TexturePacker::~TexturePacker()
+{
+    for (auto i = mArrays.begin(); i != mArrays.end(); i++)
+        delete i->array;
+}
+
+TextureLayer TexturePacker::add(const string& filename)
+{
+    // Texture files already hold their final levels
+    if (TextureFile::isTextureFile(filename))
+    {
+        PendingTexture texture;
+        texture.file.reset(new TextureFile(filename));
+        BlockFormat blockFormat = texture.file->getFormat();
+        if (!compressor::isFormatSupported(blockFormat))
+        {
+            stringstream err;
+            err << "Error: Failed to pack texture '" << filename << "': "
+                << compressor::getFormatName(blockFormat)
+                << " textures aren't supported by this driver" << endl;
+            throw std::runtime_error(err.str());
+        }
+        TextureArrayFormat format = {compressor::getInternalFormat(blockFormat),
+                                     texture.file->getWidth(), texture.file->getHeight(),
+                                     texture.file->getLevelCount()};
+        texture.layer = allocateLayer(format, true, blockFormat);
+        TextureLayer layer = texture.layer;
+        mPending.push_back(std::move(texture));
+        return layer;
+    }
+
+    // Load the image file
+    int width, height, numComponents;
+    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &numComponents, 4);
+    if (!data)
+    {
+        stringstream err;
+        err << "Error: Failed to load texture '" << filename << "': " << stbi_failure_reason()
+            << endl;
+        throw std::runtime_error(err.str());
+    }
+    TextureLayer layer = add(data, width, height);
+    stbi_image_free(data);
+    return layer;
+}
+
+TextureLayer TexturePacker::add(const uint8_t* pixels, uint width, uint height)
+{
+    PendingTexture texture;
+    texture.mips = mipgen::generateMipChain(pixels, width, height, mMipFilter);
+    uint levels = texture.mips.size() + 1;
+
+    BlockFormat blockFormat =
+        compressor::chooseFormat(compressor::analyseChannels(pixels, width, height));
+    if (mCompression && compressor::isFormatSupported(blockFormat))
+    {
+        texture.compressed.push_back(compressor::compress(pixels, width, height, blockFormat));
+        for (auto i = texture.mips.begin(); i != texture.mips.end(); i++)
+            texture.compressed.push_back(
+                compressor::compress(i->pixels.data(), i->width, i->height, blockFormat));
+        texture.mips.clear();
+
+        TextureArrayFormat format = {compressor::getInternalFormat(blockFormat), width, height,
+                                     levels};
+        texture.layer = allocateLayer(format, true, blockFormat);
+    }
+    else
+    {
+        texture.pixels.assign(pixels, pixels + width * height * 4);
+
+        TextureArrayFormat format = {GL_RGBA8, width, height, levels};
+        texture.layer = allocateLayer(format, false, BLOCK_FORMAT_BC1);
+    }
+
+    TextureLayer layer = texture.layer;
+    mPending.push_back(std::move(texture));
+    return layer;
+}
+
+void TexturePacker::build()
+{
+    // Each array is created with exactly as many layers as it was given
+    for (uint i = 0; i < mArrays.size(); i++)
+    {
+        PackedArray& packed = mArrays[i];
+        if (packed.array)
+            continue;
+        const TextureArrayFormat& format = mAllocator.getFormat(i);
+        packed.array = new TextureArray(format.width, format.height, mAllocator.getLayerCount(i),
+                                        format.levels, format.internalFormat);
+        if (packed.compressed)
+        {
+            GLint swizzle[4];
+            compressor::getSwizzle(packed.blockFormat, swizzle);
+            packed.array->setSwizzle(swizzle);
+        }
+    }
+    mAllocator.close();
+
+    for (auto i = mPending.begin(); i != mPending.end(); i++)
+        upload(*i);
+    mPending.clear();
+}
+
+uint TexturePacker::getArrayCount() const
+{
+    return mArrays.size();
+}
+
+TextureArray* TexturePacker::getArray(uint index) const
+{
+    return mArrays[index].array;
+}
+
+TextureArray* TexturePacker::getArray(const TextureLayer& layer) const
+{
+    return mArrays[layer.array].array;
+}
+
+uint TexturePacker::getTextureCount() const
+{
+    return mTextureCount;
+}
+
+void TexturePacker::printReport() const
+{
+    INFO << "Texture packer: " << mTextureCount << " textures in " << mArrays.size()
+         << " arrays, " << mPending.size() << " waiting to be built" << endl;
+    for (uint i = 0; i < mArrays.size(); i++)
+    {
+        const PackedArray& packed = mArrays[i];
+        const TextureArrayFormat& format = mAllocator.getFormat(i);
+        uint layerCount = mAllocator.getLayerCount(i);
+        uint64 size = ResourceRegistry::getTextureSize(format.internalFormat, format.width,
+                                                       format.height, format.levels) *
+                      layerCount;
+        INFO << "    Array " << i << ": " << format.width << "x" << format.height << ", "
+             << format.levels << " levels, "
+             << (packed.compressed ? compressor::getFormatName(packed.blockFormat) : "RGBA8")
+             << ", " << layerCount << " layers, " << size / 1024 << " KB" << endl;
+    }
+}
+
+TextureLayer TexturePacker::allocateLayer(const TextureArrayFormat& format, bool compressed,
+                                          BlockFormat blockFormat)
+{
+    TextureLayer layer = mAllocator.allocate(format);
+    if (layer.array == mArrays.size())
+    {
+        PackedArray packed = {compressed, blockFormat, nullptr};
+        mArrays.push_back(packed);
+    }
+    mTextureCount++;
+    return layer;
+}
+
+void TexturePacker::upload(PendingTexture& texture)
+{
+    TextureArray* array = mArrays[texture.layer.array].array;
+    uint layer = texture.layer.layer;
+    if (texture.file)
+    {
+        // Straight from the file mapping
+        for (uint i = 0; i < texture.file->getLevelCount(); i++)
+        {
+            const TextureFileLevel& level = texture.file->getLevel(i);
+            array->setCompressedLayer(layer, i, level.size, level.data);
+        }
+    }
+    else if (!texture.compressed.empty())
+    {
+        for (uint i = 0; i < texture.compressed.size(); i++)
+        {
+            const vector<uint8_t>& data = texture.compressed[i].data;
+            array->setCompressedLayer(layer, i, data.size(), data.data());
+        }
+    }
+    else
+    {
+        array->setLayer(layer, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.pixels.data());
+        for (uint i = 0; i < texture.mips.size(); i++)
+            array->setLayer(layer, i + 1, GL_RGBA, GL_UNSIGNED_BYTE, texture.mips[i].pixels.data());
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <map>
+
+#include "MipGenerator.h"
+#include "TextureCompressor.h"
+#include "TextureFile.h"
+
+class TextureArray;
+
+// Where a packed texture ended up. Sample the array with vec3(uv, layer)
+struct TextureLayer
+{
+    uint array; // Index passed to TexturePacker::getArray
+    uint layer;
+};
+
+// Textures must match in all of these to share an array
+struct TextureArrayFormat
+{
+    GLenum internalFormat;
+    uint width;
+    uint height;
+    uint levels;
+
+    bool operator<(const TextureArrayFormat& other) const;
+};
+
+// Decides which array and layer each texture goes in, without touching GL. Textures with the same
+// format share an array until it reaches 'maxLayers', and then a new one is started
+class TextureLayerAllocator
+{
+public:
+    TextureLayerAllocator(uint maxLayers);
+
+    TextureLayer allocate(const TextureArrayFormat& format);
+
+    // Stop adding to the existing arrays, once they have been created with their final layer
+    // count. Later textures go into new arrays
+    void close();
+
+    uint getArrayCount() const;
+    const TextureArrayFormat& getFormat(uint array) const;
+    uint getLayerCount(uint array) const;
+
+private:
+    struct AllocatedArray
+    {
+        TextureArrayFormat format;
+        uint layerCount;
+    };
+
+    uint mMaxLayers;
+    vector<AllocatedArray> mArrays;
+    std::map<TextureArrayFormat, uint> mOpenArrays; // Arrays with room for more layers, by format
+};
+
+// Groups textures which share a format, size and level count into texture arrays, so a whole
+// group is bound once instead of once per draw. Draws which sample the same array can then be
+// merged, for example through GeometryPool with the layer passed as a per-instance attribute
+// selected by baseInstance, which needs GL 4.2.
+//
+// Handles are assigned as soon as a texture is added, but the arrays only exist once build has
+// been called. Textures added after a build go into new arrays
+class TexturePacker
+{
+public:
+    // Images are given a mip chain with 'filter', and block compressed if 'compression' is set and
+    // the driver supports the chosen format. DDS and KTX2 files are packed as they are stored.
+    // Arrays hold up to 'maxLayers' textures, or as many as the driver allows if it's 0
+    TexturePacker(MipFilter filter = MIP_FILTER_KAISER, bool compression = true,
+                  uint maxLayers = 0);
+    ~TexturePacker();
+
+    // Load an image file. Throws if it can't be loaded
+    TextureLayer add(const string& filename);
+
+    // Pack an RGBA8 image
+    TextureLayer add(const uint8_t* pixels, uint width, uint height);
+
+    // Create the arrays for every texture added since the last build and upload them
+    void build();
+
+    uint getArrayCount() const;
+
+    // Null until the texture array has been built
+    TextureArray* getArray(uint index) const;
+    TextureArray* getArray(const TextureLayer& layer) const;
+
+    uint getTextureCount() const;
+
+    // Log each array's format and layers
+    void printReport() const;
+
+private:
+    struct PackedArray
+    {
+        bool compressed;
+        BlockFormat blockFormat;
+        TextureArray* array;
+    };
+
+    // The levels of a texture waiting to be uploaded, as RGBA8 pixels, compressed blocks or a
+    // texture file
+    struct PendingTexture
+    {
+        TextureLayer layer;
+        vector<uint8_t> pixels;
+        vector<MipLevel> mips;
+        vector<CompressedImage> compressed;
+        unique_ptr<TextureFile> file;
+    };
+
+    MipFilter mMipFilter;
+    bool mCompression;
+
+    TextureLayerAllocator mAllocator;
+    vector<PackedArray> mArrays; // In step with the allocator's arrays
+    vector<PendingTexture> mPending;
+    uint mTextureCount;
+
+    // Find or start an array with room for another layer
+    TextureLayer allocateLayer(const TextureArrayFormat& format, bool compressed,
+                               BlockFormat blockFormat);
+    void upload(PendingTexture& texture);
+};
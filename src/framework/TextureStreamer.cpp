@@ -0,0 +1,341 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "ResourceRegistry.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include "TextureStreamer.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace
+{
+
+// Levels this size and smaller are always resident
+const uint kTailSize = 64;
+
+const uint kPageSize = 4096;
+
+float toMegabytes(uint64 bytes)
+{
+    return bytes / (1024.0f * 1024.0f);
+}
+
+}
+
+namespace streaming
+{
+
+uint selectLevel(uint size, float distance, float uvDensity, float pixelsPerUnit, uint tailLevel)
+{
+    // Texels of the first level covered by one pixel. Each level halves this, so the level where
+    // it falls to one texel per pixel is the finest one that can be seen
+    float texelsPerPixel = uvDensity * size * distance / pixelsPerUnit;
+    uint level = texelsPerPixel > 1.0f ? (uint)floor(log2(texelsPerPixel)) : 0;
+    return glm::min(level, tailLevel);
+}
+
+uint64 fitBudget(vector<BudgetEntry>& entries, uint64 budget)
+{
+    uint64 total = 0;
+    for (auto i = entries.begin(); i != entries.end(); i++)
+    {
+        for (uint level = i->targetLevel; level < i->levelCount; level++)
+            total += i->levelSizes[level];
+    }
+
+    // Drop levels from the farthest texture until the rest fit. Each level dropped halves a
+    // texture's distance for the purpose of dropping another, as it's now blurrier than the
+    // textures around it
+    std::priority_queue<pair<float, BudgetEntry*>> farthest;
+    for (auto i = entries.begin(); i != entries.end(); i++)
+    {
+        if (i->targetLevel < i->tailLevel)
+            farthest.push(make_pair(i->distance, &*i));
+    }
+    while (total > budget && !farthest.empty())
+    {
+        float distance = farthest.top().first;
+        BudgetEntry& entry = *farthest.top().second;
+        farthest.pop();
+        total -= entry.levelSizes[entry.targetLevel];
+        entry.targetLevel++;
+        if (entry.targetLevel < entry.tailLevel)
+            farthest.push(make_pair(distance * 0.5f, &entry));
+    }
+    return total;
+}
+
+}
+
+TextureStreamer::TextureStreamer(ThreadPool& pool, uint64 budget, uint uploadBudget)
+    : mPool(pool),
+      mBudget(budget),
+      mUploadBudget(uploadBudget),
+      mPixelsPerUnit(0.0f),
+      mStatistics(TextureStreamerStatistics())
+{
+    setViewport(720, glm::radians(45.0f));
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // Prefetches read from the file mappings, so they must finish before the files are closed
+    for (auto i = mTextures.begin(); i != mTextures.end(); i++)
+    {
+        if ((*i)->prefetch.valid())
+            (*i)->prefetch.wait();
+        delete (*i)->texture;
+    }
+}
+
+Texture* TextureStreamer::add(const string& filename)
+{
+    unique_ptr<StreamedTexture> streamed(new StreamedTexture);
+    streamed->file.reset(new TextureFile(filename));
+    const TextureFile& file = *streamed->file;
+    BlockFormat format = file.getFormat();
+    if (!compressor::isFormatSupported(format))
+    {
+        stringstream err;
+        err << "Error: Failed to stream texture '" << filename << "': "
+            << compressor::getFormatName(format) << " textures aren't supported by this driver"
+            << endl;
+        throw std::runtime_error(err.str());
+    }
+
+    // The tail is every level of kTailSize or smaller, or the smallest level if there are none
+    uint tailLevel = file.getLevelCount() - 1;
+    while (tailLevel > 0 && glm::max(file.getLevel(tailLevel - 1).width,
+                                     file.getLevel(tailLevel - 1).height) <= kTailSize)
+        tailLevel--;
+
+    // Only the tail is uploaded, the finer levels are left empty until they're needed
+    Texture* texture =
+        new Texture(format, file.getWidth(), file.getHeight(), file.getLevelCount());
+    for (uint level = tailLevel; level < file.getLevelCount(); level++)
+    {
+        const TextureFileLevel& data = file.getLevel(level);
+        texture->setCompressedMipLevel(level, data.width, data.height, texture->getInternalFormat(),
+                                       data.size, data.data);
+    }
+    texture->setBaseLevel(tailLevel);
+    ResourceRegistry::track(RESOURCE_TEXTURE, texture, getSizeFrom(*streamed, tailLevel),
+                            filename);
+
+    for (uint level = 0; level < file.getLevelCount(); level++)
+        streamed->levelSizes.push_back(file.getLevel(level).size);
+
+    streamed->texture = texture;
+    streamed->tailLevel = tailLevel;
+    streamed->residentLevel = tailLevel;
+    streamed->requiredLevel = tailLevel;
+    streamed->targetLevel = tailLevel;
+    streamed->distance = std::numeric_limits<float>::max();
+    streamed->used = false;
+    streamed->prefetchLevel = 0;
+    mTextureMap[texture] = streamed.get();
+    mTextures.push_back(std::move(streamed));
+    mStatistics.textureCount++;
+    return texture;
+}
+
+void TextureStreamer::setViewport(uint height, float fovY)
+{
+    mPixelsPerUnit = height / (2.0f * tan(fovY * 0.5f));
+}
+
+void TextureStreamer::setBudget(uint64 bytes)
+{
+    mBudget = bytes;
+}
+
+void TextureStreamer::use(Texture* texture, float distance, float uvDensity)
+{
+    StreamedTexture* streamed = find(texture);
+    uint level = streaming::selectLevel(
+        glm::max(streamed->file->getWidth(), streamed->file->getHeight()), distance, uvDensity,
+        mPixelsPerUnit, streamed->tailLevel);
+
+    if (!streamed->used)
+    {
+        streamed->used = true;
+        streamed->requiredLevel = level;
+        streamed->distance = distance;
+    }
+    else
+    {
+        streamed->requiredLevel = glm::min(streamed->requiredLevel, level);
+        streamed->distance = glm::min(streamed->distance, distance);
+    }
+}
+
+void TextureStreamer::update()
+{
+    // Textures which weren't used this frame only need their tail
+    mStatistics.requestedBytes = 0;
+    for (auto i = mTextures.begin(); i != mTextures.end(); i++)
+    {
+        StreamedTexture& texture = **i;
+        if (!texture.used)
+        {
+            texture.requiredLevel = texture.tailLevel;
+            texture.distance = std::numeric_limits<float>::max();
+        }
+        texture.targetLevel = texture.requiredLevel;
+        mStatistics.requestedBytes += getSizeFrom(texture, texture.requiredLevel);
+    }
+    fitBudget();
+
+    // Free memory before any more is needed
+    for (auto i = mTextures.begin(); i != mTextures.end(); i++)
+    {
+        if ((*i)->residentLevel < (*i)->targetLevel)
+            evict(**i);
+    }
+
+    // Queue textures with missing levels, nearest first
+    std::priority_queue<pair<float, StreamedTexture*>> queue;
+    for (auto i = mTextures.begin(); i != mTextures.end(); i++)
+    {
+        StreamedTexture& texture = **i;
+        if (texture.residentLevel > texture.targetLevel)
+        {
+            startPrefetch(texture, texture.residentLevel - 1);
+            queue.push(make_pair(-texture.distance, &texture));
+        }
+    }
+
+    // Upload the next level of each texture whose pages have been read in
+    uint64 uploaded = 0;
+    while (!queue.empty() && uploaded < mUploadBudget)
+    {
+        StreamedTexture& texture = *queue.top().second;
+        queue.pop();
+        uint level = texture.residentLevel - 1;
+        if (!isPrefetched(texture, level))
+            continue;
+
+        const TextureFileLevel& data = texture.file->getLevel(level);
+        texture.texture->setCompressedMipLevel(level, data.width, data.height,
+                                               texture.texture->getInternalFormat(), data.size,
+                                               data.data);
+        texture.texture->setBaseLevel(level);
+        texture.residentLevel = level;
+        uploaded += data.size;
+        if (level > texture.targetLevel)
+            startPrefetch(texture, level - 1);
+    }
+    mStatistics.uploadedBytes += uploaded;
+
+    mStatistics.residentBytes = 0;
+    mStatistics.pendingLevels = 0;
+    for (auto i = mTextures.begin(); i != mTextures.end(); i++)
+    {
+        StreamedTexture& texture = **i;
+        mStatistics.residentBytes += getSizeFrom(texture, texture.residentLevel);
+        if (texture.residentLevel > texture.targetLevel)
+            mStatistics.pendingLevels += texture.residentLevel - texture.targetLevel;
+        texture.used = false;
+    }
+}
+
+uint TextureStreamer::getResidentLevel(Texture* texture) const
+{
+    return find(texture)->residentLevel;
+}
+
+uint TextureStreamer::getTargetLevel(Texture* texture) const
+{
+    return find(texture)->targetLevel;
+}
+
+const TextureStreamerStatistics& TextureStreamer::getStatistics() const
+{
+    return mStatistics;
+}
+
+void TextureStreamer::printReport() const
+{
+    INFO << "Texture streaming: " << mStatistics.textureCount << " textures, "
+         << toMegabytes(mStatistics.residentBytes) << " MB resident, "
+         << toMegabytes(mStatistics.requestedBytes) << " MB requested, "
+         << toMegabytes(mStatistics.targetBytes) << " MB within the "
+         << toMegabytes(mBudget) << " MB budget" << endl;
+    INFO << "    " << mStatistics.pendingLevels << " levels pending, "
+         << toMegabytes(mStatistics.uploadedBytes) << " MB uploaded, "
+         << toMegabytes(mStatistics.evictedBytes) << " MB evicted" << endl;
+}
+
+TextureStreamer::StreamedTexture* TextureStreamer::find(const Texture* texture) const
+{
+    auto streamed = mTextureMap.find(texture);
+    assert(streamed != mTextureMap.end());
+    return streamed->second;
+}
+
+uint64 TextureStreamer::getSizeFrom(const StreamedTexture& texture, uint level) const
+{
+    uint64 size = 0;
+    for (uint i = level; i < texture.file->getLevelCount(); i++)
+        size += texture.file->getLevel(i).size;
+    return size;
+}
+
+void TextureStreamer::fitBudget()
+{
+    vector<streaming::BudgetEntry> entries;
+    for (auto i = mTextures.begin(); i != mTextures.end(); i++)
+    {
+        streaming::BudgetEntry entry = {(*i)->distance, (*i)->targetLevel, (*i)->tailLevel,
+                                        (uint)(*i)->levelSizes.size(), (*i)->levelSizes.data()};
+        entries.push_back(entry);
+    }
+    mStatistics.targetBytes = streaming::fitBudget(entries, mBudget);
+    for (uint i = 0; i < mTextures.size(); i++)
+        mTextures[i]->targetLevel = entries[i].targetLevel;
+}
+
+void TextureStreamer::evict(StreamedTexture& texture)
+{
+    // Stop sampling the levels before releasing them
+    texture.texture->setBaseLevel(texture.targetLevel);
+    for (uint level = texture.residentLevel; level < texture.targetLevel; level++)
+    {
+        texture.texture->clearMipLevel(level);
+        mStatistics.evictedBytes += texture.file->getLevel(level).size;
+    }
+    texture.residentLevel = texture.targetLevel;
+}
+
+void TextureStreamer::startPrefetch(StreamedTexture& texture, uint level)
+{
+    // A prefetch still reading a level which is no longer wanted has to finish first, as the file
+    // must outlive it
+    if (texture.prefetch.valid() &&
+        (texture.prefetchLevel == level ||
+         texture.prefetch.wait_for(std::chrono::seconds(0)) != std::future_status::ready))
+        return;
+
+    // Touch every page of the level, so that the upload doesn't block on disk reads
+    const TextureFileLevel& data = texture.file->getLevel(level);
+    const uint8_t* pages = data.data;
+    uint size = data.size;
+    texture.prefetch = mPool.submit([pages, size]() {
+        const volatile uint8_t* data = pages;
+        for (uint offset = 0; offset < size; offset += kPageSize)
+            data[offset];
+    });
+    texture.prefetchLevel = level;
+}
+
+bool TextureStreamer::isPrefetched(StreamedTexture& texture, uint level)
+{
+    return texture.prefetch.valid() && texture.prefetchLevel == level &&
+           texture.prefetch.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
@@ -0,0 +1,131 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <future>
+#include <map>
+
+#include "TextureFile.h"
+
+class Texture;
+class ThreadPool;
+
+struct TextureStreamerStatistics
+{
+    uint textureCount;
+    uint64 residentBytes;  // Levels held by GL textures
+    uint64 requestedBytes; // Levels the last update's uses asked for
+    uint64 targetBytes;    // Requested levels after fitting into the budget
+    uint64 uploadedBytes;  // Total since the streamer was created
+    uint64 evictedBytes;   // Total since the streamer was created
+    uint pendingLevels;    // Levels between the resident and target levels of every texture
+};
+
+// The level selection and budget fitting used by TextureStreamer, which don't need GL
+namespace streaming
+{
+
+// A texture's levels as seen by fitBudget. Every level from the tail level down is always resident
+struct BudgetEntry
+{
+    float distance;
+    uint targetLevel;
+    uint tailLevel;
+    uint levelCount;
+    const uint* levelSizes;
+};
+
+// Finest level of a texture 'size' texels across which can be seen 'distance' units away with
+// 'uvDensity' UV units per world unit, no coarser than 'tailLevel'
+uint selectLevel(uint size, float distance, float uvDensity, float pixelsPerUnit, uint tailLevel);
+
+// Coarsen target levels until the levels from each target level down fit in 'budget', farthest
+// texture first. Returns the bytes needed afterwards, which is over budget only if the tails alone
+// don't fit
+uint64 fitBudget(vector<BudgetEntry>& entries, uint64 budget);
+
+}
+
+// Keeps only the mip levels which are needed on screen resident, within a memory budget. Textures
+// are streamed from DDS and KTX2 files, so each level can be read from the file mapping on its own.
+//
+// Every frame, each use of a texture gives the finest level it needs from its distance and UV
+// density. If the levels needed don't fit in the budget, the farthest textures are coarsened
+// first. Levels no longer needed are freed straight away, then the missing levels are loaded
+// nearest texture first, one level per texture per update so that textures sharpen
+// progressively. A worker thread reads each level's pages in before it is uploaded, and
+// GL_TEXTURE_BASE_LEVEL limits sampling to the levels which are resident. Levels of 64x64 and
+// smaller are always resident, so a texture can be sampled as soon as it is added
+class TextureStreamer
+{
+public:
+    // 'uploadBudget' limits the bytes uploaded per update. The first upload of an update is always
+    // allowed
+    TextureStreamer(ThreadPool& pool, uint64 budget, uint uploadBudget = 4 * 1024 * 1024);
+    ~TextureStreamer();
+
+    // Open a texture file. The texture is owned by the streamer
+    Texture* add(const string& filename);
+
+    // Viewport height in pixels and vertical field of view in radians, used to turn distances
+    // into screen space texel density
+    void setViewport(uint height, float fovY);
+
+    void setBudget(uint64 bytes);
+
+    // Report that 'texture' is drawn this frame 'distance' units from the camera, with 'uvDensity'
+    // UV units per world unit across its surface. Call this for every draw, the finest level
+    // needed wins
+    void use(Texture* texture, float distance, float uvDensity = 1.0f);
+
+    // Fit this frame's uses into the budget, free levels which aren't needed and upload missing
+    // ones. Call once per frame, after the uses
+    void update();
+
+    uint getResidentLevel(Texture* texture) const;
+    uint getTargetLevel(Texture* texture) const;
+    const TextureStreamerStatistics& getStatistics() const;
+
+    // Log the resident and requested sizes
+    void printReport() const;
+
+private:
+    struct StreamedTexture
+    {
+        unique_ptr<TextureFile> file;
+        vector<uint> levelSizes;
+        Texture* texture;
+        uint tailLevel;     // Finest level which is always resident
+        uint residentLevel; // Finest level held by the texture
+        uint requiredLevel; // Finest level needed by this frame's uses
+        uint targetLevel;   // Required level after fitting into the budget
+        float distance;     // Nearest use this frame
+        bool used;
+
+        // Reading in the pages of the next level to upload
+        std::future<void> prefetch;
+        uint prefetchLevel;
+    };
+
+    ThreadPool& mPool;
+    uint64 mBudget;
+    uint mUploadBudget;
+    float mPixelsPerUnit; // Screen pixels covered by one world unit, one unit from the camera
+
+    vector<unique_ptr<StreamedTexture>> mTextures;
+    std::map<const Texture*, StreamedTexture*> mTextureMap;
+
+    TextureStreamerStatistics mStatistics;
+
+    StreamedTexture* find(const Texture* texture) const;
+
+    // Size of the levels from 'level' down to the smallest
+    uint64 getSizeFrom(const StreamedTexture& texture, uint level) const;
+
+    void fitBudget();
+    void evict(StreamedTexture& texture);
+    void startPrefetch(StreamedTexture& texture, uint level);
+    bool isPrefetched(StreamedTexture& texture, uint level);
+};
@@ -0,0 +1,62 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint threadCount) : mStopping(false)
+{
+    if (threadCount == 0)
+        threadCount = glm::max(std::thread::hardware_concurrency(), 2u) - 1;
+    for (uint i = 0; i < threadCount; i++)
+        mThreads.push_back(std::thread(&ThreadPool::workerMain, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    for (auto i = mThreads.begin(); i != mThreads.end(); i++)
+        i->join();
+}
+
+uint ThreadPool::getThreadCount() const
+{
+    return mThreads.size();
+}
+
+ThreadPool& ThreadPool::getDefault()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push(task);
+    }
+    mCondition.notify_one();
+}
+
+void ThreadPool::workerMain()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            if (mTasks.empty())
+                return;
+            task = mTasks.front();
+            mTasks.pop();
+        }
+        task();
+    }
+}
@@ -0,0 +1,54 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+
+// A fixed set of worker threads which run queued tasks in order of submission. Tasks must not
+// make GL calls, as the context is only current on the main thread
+class ThreadPool
+{
+public:
+    // A thread count of 0 uses one thread per hardware thread, leaving one for the main thread
+    ThreadPool(uint threadCount = 0);
+
+    // Finishes every queued task before returning
+    ~ThreadPool();
+
+    // Queue a task. Its result, or any exception it throws, is delivered through the future
+    template <class F> std::future<typename std::result_of<F()>::type> submit(F task);
+
+    uint getThreadCount() const;
+
+    // A pool shared by the framework's background loaders
+    static ThreadPool& getDefault();
+
+private:
+    vector<std::thread> mThreads;
+    std::queue<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    bool mStopping;
+
+    void enqueue(std::function<void()> task);
+    void workerMain();
+};
+
+template <class F> std::future<typename std::result_of<F()>::type> ThreadPool::submit(F task)
+{
+    typedef typename std::result_of<F()>::type Result;
+
+    // std::function must be copyable, so the packaged task is shared rather than moved in
+    auto packagedTask = std::make_shared<std::packaged_task<Result()>>(task);
+    std::future<Result> future = packagedTask->get_future();
+    enqueue([packagedTask]() { (*packagedTask)(); });
+    return future;
+}
@@ -0,0 +1,61 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "ResourceRegistry.h"
+#include "UniformBuffer.h"
+
+UniformBuffer::UniformBuffer(uint size) : mBuffer(0), mSize(size)
+{
+    glGenBuffers(1, &mBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    ResourceRegistry::track(RESOURCE_BUFFER, this, size, "UniformBuffer");
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    if (mBuffer)
+        glDeleteBuffers(1, &mBuffer);
+    ResourceRegistry::release(this);
+}
+
+void UniformBuffer::update(const void* data, uint size)
+{
+    if (size > mSize)
+    {
+        stringstream err;
+        err << "Error: Updating a " << mSize << " byte uniform buffer with " << size << " bytes"
+            << endl;
+        throw std::runtime_error(err.str());
+    }
+
+    // Orphan the old storage so the driver doesn't wait for draws still reading from it
+    glBindBuffer(GL_UNIFORM_BUFFER, mBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, mSize, nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data);
+}
+
+void UniformBuffer::bindBase(GLuint index)
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, index, mBuffer);
+}
+
+GLuint UniformBuffer::getBuffer() const
+{
+    return mBuffer;
+}
+
+uint UniformBuffer::getSize() const
+{
+    return mSize;
+}
+
+uint UniformBuffer::getOffsetAlignment()
+{
+    static GLint alignment = 0;
+    if (alignment == 0)
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    return alignment;
+}
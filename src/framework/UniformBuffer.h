@@ -0,0 +1,54 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+#include <cstddef>
+
+// Compile time checks that a C++ struct matches the std140 layout of a GLSL uniform block. In
+// std140, vec3 and vec4 members are 16 byte aligned, so a vec3 must be followed by a float or
+// explicit padding, and arrays of scalars use a 16 byte stride
+#define STD140_OFFSET(type, member, offset) \
+    static_assert(offsetof(type, member) == offset, #type "::" #member " does not match its std140 offset")
+#define STD140_SIZE(type, size) \
+    static_assert(sizeof(type) == size && size % 16 == 0, #type " does not match its std140 size")
+
+// Binding points shared by every program which declares these blocks
+enum UniformBlockBinding
+{
+    UNIFORM_BLOCK_PER_FRAME = 0,
+    UNIFORM_BLOCK_PER_VIEW = 1,
+    UNIFORM_BLOCK_PER_OBJECT = 2
+};
+
+// A uniform buffer holding data which changes at most a few times per frame, such as the camera.
+// Per-object data should be streamed through a StreamBuffer instead, binding a range per draw
+class UniformBuffer
+{
+public:
+    UniformBuffer(uint size);
+    ~UniformBuffer();
+
+    // Replace the contents of the buffer. 'size' must be at most the size of the buffer
+    void update(const void* data, uint size);
+    template <class T> void update(const T& block);
+
+    // Attach the whole buffer to a binding point
+    void bindBase(GLuint index);
+
+    GLuint getBuffer() const;
+    uint getSize() const;
+
+    // Required alignment of offsets passed to glBindBufferRange
+    static uint getOffsetAlignment();
+
+private:
+    GLuint mBuffer;
+    uint mSize;
+};
+
+template <class T> void UniformBuffer::update(const T& block)
+{
+    update(&block, sizeof(T));
+}
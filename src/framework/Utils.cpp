@@ -2,6 +2,14 @@
  * GL Framework
  * Copyright (c) David Avedissian 2014-2015
  */
+#ifdef _WIN32
+#   include <direct.h>
+#else
+#   include <sys/stat.h>
+#endif
+
+#include <cerrno>
+
 #include "Common.h"
 #include "Utils.h"
 
@@ -31,4 +39,14 @@ string readEntireFile(const string& file)
     return fileData;
 }
 
+bool createDirectory(const string& path)
+{
+#ifdef _WIN32
+    int result = _mkdir(path.c_str());
+#else
+    int result = mkdir(path.c_str(), 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
 }
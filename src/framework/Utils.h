@@ -9,4 +9,7 @@ namespace utils {
 // Read a file entirely into a string buffer
 string readEntireFile(const string& file);
 
+// Create a directory if it doesn't already exist. Returns false if it couldn't be created
+bool createDirectory(const string& path);
+
 }
@@ -0,0 +1,102 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#include "Common.h"
+#include "VertexLayout.h"
+
+VertexAttribute::VertexAttribute(uint count, GLenum type, bool normalised)
+    : count(count),
+      type(type),
+      normalised(normalised)
+{
+}
+
+VertexLayout::VertexLayout() : mStride(0)
+{
+}
+
+VertexLayout::VertexLayout(const vector<VertexAttribute>& attributes) : mStride(0)
+{
+    for (auto i = attributes.begin(); i != attributes.end(); i++)
+        add(*i);
+}
+
+VertexLayout& VertexLayout::add(uint count, GLenum type, bool normalised)
+{
+    return add(VertexAttribute(count, type, normalised));
+}
+
+VertexLayout& VertexLayout::add(const VertexAttribute& attribute)
+{
+    // Packed formats only exist as 4 component vectors
+    bool packed = attribute.type == GL_INT_2_10_10_10_REV ||
+                  attribute.type == GL_UNSIGNED_INT_2_10_10_10_REV;
+    if (attribute.count < 1 || attribute.count > 4 || (packed && attribute.count != 4))
+    {
+        stringstream err;
+        err << "Invalid vertex attribute: " << attribute.count << " components of type 0x"
+            << std::hex << attribute.type << endl;
+        throw std::runtime_error(err.str());
+    }
+
+    uint offset = alignOffset(mStride);
+    mAttributes.push_back(attribute);
+    mOffsets.push_back(offset);
+    mStride = alignOffset(offset + getAttributeSize(attribute.count, attribute.type));
+    return *this;
+}
+
+void VertexLayout::apply(uint firstLocation, uint divisor) const
+{
+    for (uint i = 0; i < mAttributes.size(); i++)
+    {
+        const VertexAttribute& attribute = mAttributes[i];
+        glEnableVertexAttribArray(firstLocation + i);
+        glVertexAttribPointer(firstLocation + i, attribute.count, attribute.type,
+                              attribute.normalised ? GL_TRUE : GL_FALSE, mStride,
+                              (void*)(size_t)mOffsets[i]);
+        glVertexAttribDivisor(firstLocation + i, divisor);
+    }
+}
+
+uint VertexLayout::getAttributeCount() const
+{
+    return mAttributes.size();
+}
+
+const VertexAttribute& VertexLayout::getAttribute(uint i) const
+{
+    return mAttributes[i];
+}
+
+uint VertexLayout::getOffset(uint i) const
+{
+    return mOffsets[i];
+}
+
+uint VertexLayout::getStride() const
+{
+    return mStride;
+}
+
+bool VertexLayout::operator==(const VertexLayout& other) const
+{
+    if (mAttributes.size() != other.mAttributes.size())
+        return false;
+
+    for (uint i = 0; i < mAttributes.size(); i++)
+    {
+        const VertexAttribute& a = mAttributes[i];
+        const VertexAttribute& b = other.mAttributes[i];
+        if (a.count != b.count || a.type != b.type || a.normalised != b.normalised)
+            return false;
+    }
+
+    return true;
+}
+
+bool VertexLayout::operator!=(const VertexLayout& other) const
+{
+    return !(*this == other);
+}
@@ -0,0 +1,68 @@
+/*
+ * GL Framework
+ * Copyright (c) David Avedissian 2014-2015
+ */
+#pragma once
+
+struct VertexAttribute
+{
+    VertexAttribute(uint count, GLenum type, bool normalised = false);
+
+    uint count;
+    GLenum type;
+    bool normalised;
+};
+
+// Describes the packed byte layout of a single interleaved vertex. Each attribute is placed at
+// the next 4 byte aligned offset, as GL drivers fall back to slow paths for misaligned data.
+class VertexLayout
+{
+public:
+    VertexLayout();
+    VertexLayout(const vector<VertexAttribute>& attributes);
+
+    // Append an attribute to the end of the layout
+    VertexLayout& add(uint count, GLenum type, bool normalised = false);
+    VertexLayout& add(const VertexAttribute& attribute);
+
+    // Set up the attribute pointers for the currently bound vertex buffer, starting at
+    // the specified attribute location. A non-zero divisor makes the attributes per-instance
+    void apply(uint firstLocation = 0, uint divisor = 0) const;
+
+    uint getAttributeCount() const;
+    const VertexAttribute& getAttribute(uint i) const;
+    uint getOffset(uint i) const;
+    uint getStride() const;
+
+    bool operator==(const VertexLayout& other) const;
+    bool operator!=(const VertexLayout& other) const;
+
+    // Size in bytes of an attribute with 'count' components of 'type'. Packed formats
+    // store all components in a single 32 bit word
+    static constexpr uint getAttributeSize(uint count, GLenum type)
+    {
+        return type == GL_INT_2_10_10_10_REV || type == GL_UNSIGNED_INT_2_10_10_10_REV ? 4 :
+            count * (type == GL_BYTE || type == GL_UNSIGNED_BYTE ? 1 :
+                     type == GL_SHORT || type == GL_UNSIGNED_SHORT || type == GL_HALF_FLOAT ? 2 :
+                     type == GL_DOUBLE ? 8 : 4);
+    }
+
+    // Round an offset up to the alignment required for the start of an attribute
+    static constexpr uint alignOffset(uint offset)
+    {
+        return (offset + 3) & ~3u;
+    }
+
+private:
+    vector<VertexAttribute> mAttributes;
+    vector<uint> mOffsets;
+    uint mStride;
+};
+
+static_assert(VertexLayout::getAttributeSize(3, GL_FLOAT) == 12, "Unexpected float3 size");
+static_assert(VertexLayout::getAttributeSize(2, GL_HALF_FLOAT) == 4, "Unexpected half2 size");
+static_assert(VertexLayout::getAttributeSize(4, GL_UNSIGNED_BYTE) == 4, "Unexpected ubyte4 size");
+static_assert(VertexLayout::getAttributeSize(3, GL_SHORT) == 6, "Unexpected short3 size");
+static_assert(VertexLayout::getAttributeSize(4, GL_INT_2_10_10_10_REV) == 4,
+              "Unexpected 10_10_10_2 size");
+static_assert(VertexLayout::alignOffset(6) == 8, "Attribute offsets must be 4 byte aligned");
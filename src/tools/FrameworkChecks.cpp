@@ -0,0 +1,440 @@
+/*
+ * Framework Checks
+ * Copyright (c) David Avedissian 2014-2015
+ *
+ * Known answer checks for the parts of the framework which run on the CPU. No GL context is
+ * created, so nothing checked here may call GL. Exits with a non-zero code if any check fails.
+ *
+ * Usage: FrameworkChecks
+ */
+#define SDL_MAIN_HANDLED
+
+#include "framework/Common.h"
+#include "framework/Frustum.h"
+#include "framework/IndexCodec.h"
+#include "framework/Meshlets.h"
+#include "framework/MipGenerator.h"
+#include "framework/Shader.h"
+#include "framework/TextureFile.h"
+#include "framework/TexturePacker.h"
+#include "framework/TextureStreamer.h"
+#include "framework/VertexLayout.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define EXPECT(condition) check((condition), #condition, __LINE__)
+
+namespace
+{
+
+uint gCheckCount = 0;
+uint gFailureCount = 0;
+
+void check(bool passed, const char* condition, int line)
+{
+    gCheckCount++;
+    if (!passed)
+    {
+        ERROR << "Check failed on line " << line << ": " << condition << endl;
+        gFailureCount++;
+    }
+}
+
+// Relative to the size of 'expected', as far plane distances lose precision
+bool isNear(const glm::vec4& actual, const glm::vec4& expected)
+{
+    return glm::length(actual - expected) < 1e-4f * glm::max(glm::length(expected), 1.0f);
+}
+
+void checkVertexLayouts()
+{
+    // Position, octahedral normal, UV and tangent, as written by the quantiser
+    VertexLayout mixed;
+    mixed.add(3, GL_FLOAT)
+        .add(2, GL_SHORT, true)
+        .add(2, GL_HALF_FLOAT)
+        .add(4, GL_INT_2_10_10_10_REV, true);
+    EXPECT(mixed.getAttributeCount() == 4);
+    EXPECT(mixed.getOffset(0) == 0);
+    EXPECT(mixed.getOffset(1) == 12);
+    EXPECT(mixed.getOffset(2) == 16);
+    EXPECT(mixed.getOffset(3) == 20);
+    EXPECT(mixed.getStride() == 24);
+
+    // Attributes which don't end on a 4 byte boundary push the next one along, and the stride
+    // is padded to match
+    VertexLayout padded;
+    padded.add(3, GL_UNSIGNED_BYTE, true).add(1, GL_FLOAT).add(3, GL_SHORT);
+    EXPECT(padded.getOffset(1) == 4);
+    EXPECT(padded.getOffset(2) == 8);
+    EXPECT(padded.getStride() == 16);
+
+    VertexLayout same(vector<VertexAttribute>{VertexAttribute(3, GL_FLOAT),
+                                              VertexAttribute(2, GL_SHORT, true),
+                                              VertexAttribute(2, GL_HALF_FLOAT),
+                                              VertexAttribute(4, GL_INT_2_10_10_10_REV, true)});
+    EXPECT(same == mixed);
+    EXPECT(same != padded);
+
+    // Packed formats only exist as 4 component vectors
+    bool threw = false;
+    try
+    {
+        VertexLayout().add(3, GL_INT_2_10_10_10_REV);
+    }
+    catch (std::runtime_error&)
+    {
+        threw = true;
+    }
+    EXPECT(threw);
+}
+
+void checkIndexCodec()
+{
+    const GLuint values[] = {0, 1, 2, 2, 1, 3, 70000, 3, 0, 0xFFFFFFFE};
+    vector<GLuint> indices(values, values + 10);
+    vector<uint8_t> data = codec::encodeIndices(indices);
+    vector<GLuint> decoded;
+    EXPECT(codec::decodeIndices(data.data(), data.size(), 10, 0xFFFFFFFF, decoded));
+    EXPECT(decoded == indices);
+
+    // Every index must refer to a vertex
+    EXPECT(!codec::decodeIndices(data.data(), data.size(), 10, 70000, decoded));
+
+    // Truncated, trailing and overlong data
+    EXPECT(!codec::decodeIndices(data.data(), data.size() - 1, 10, 0xFFFFFFFF, decoded));
+    EXPECT(!codec::decodeIndices(data.data(), data.size(), 9, 0xFFFFFFFF, decoded));
+    const uint8_t overflow[] = {0x81, 0x80, 0x80, 0x80, 0x10};
+    EXPECT(!codec::decodeIndices(overflow, 5, 1, 0xFFFFFFFF, decoded));
+    const uint8_t largest[] = {0x81, 0x80, 0x80, 0x80, 0x0F};
+    EXPECT(codec::decodeIndices(largest, 5, 1, 0xFFFFFFFF, decoded));
+}
+
+void checkFrustum()
+{
+    // An orthographic frustum looking down -Z from the origin, so every plane is axis aligned
+    Frustum box(glm::ortho(-2.0f, 4.0f, -1.0f, 3.0f, 1.0f, 11.0f));
+    EXPECT(isNear(box.getPlane(0), glm::vec4(1.0f, 0.0f, 0.0f, 2.0f)));
+    EXPECT(isNear(box.getPlane(1), glm::vec4(-1.0f, 0.0f, 0.0f, 4.0f)));
+    EXPECT(isNear(box.getPlane(2), glm::vec4(0.0f, 1.0f, 0.0f, 1.0f)));
+    EXPECT(isNear(box.getPlane(3), glm::vec4(0.0f, -1.0f, 0.0f, 3.0f)));
+    EXPECT(isNear(box.getPlane(4), glm::vec4(0.0f, 0.0f, -1.0f, -1.0f)));
+    EXPECT(isNear(box.getPlane(5), glm::vec4(0.0f, 0.0f, 1.0f, 11.0f)));
+
+    // A 90 degree field of view puts the side planes at 45 degrees through the eye
+    float d = sqrtf(0.5f);
+    Frustum perspective(glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f));
+    EXPECT(isNear(perspective.getPlane(0), glm::vec4(d, 0.0f, -d, 0.0f)));
+    EXPECT(isNear(perspective.getPlane(1), glm::vec4(-d, 0.0f, -d, 0.0f)));
+    EXPECT(isNear(perspective.getPlane(2), glm::vec4(0.0f, d, -d, 0.0f)));
+    EXPECT(isNear(perspective.getPlane(3), glm::vec4(0.0f, -d, -d, 0.0f)));
+    EXPECT(isNear(perspective.getPlane(4), glm::vec4(0.0f, 0.0f, -1.0f, -1.0f)));
+    EXPECT(isNear(perspective.getPlane(5), glm::vec4(0.0f, 0.0f, 1.0f, 100.0f)));
+
+    // Moving the camera back along +Z moves the near plane with it
+    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f));
+    Frustum moved(glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f) * view);
+    EXPECT(isNear(moved.getPlane(4), glm::vec4(0.0f, 0.0f, -1.0f, 4.0f)));
+
+    EXPECT(perspective.containsSphere(glm::vec3(0.0f, 0.0f, -50.0f), 0.0f));
+    EXPECT(!perspective.containsSphere(glm::vec3(0.0f, 0.0f, -0.5f), 0.4f));
+    EXPECT(perspective.containsSphere(glm::vec3(0.0f, 0.0f, -0.5f), 0.6f));
+    EXPECT(!perspective.containsSphere(glm::vec3(60.0f, 0.0f, -50.0f), 1.0f));
+    EXPECT(!perspective.containsSphere(glm::vec3(0.0f, 0.0f, -102.0f), 1.0f));
+}
+
+void checkNormalCones()
+{
+    // A unit quad in the XY plane, facing +Z
+    const GLfloat positions[] = {0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+                                 1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f};
+    const GLuint quadIndices[] = {0, 1, 2, 0, 2, 3};
+    MeshletData quad =
+        meshlets::buildMeshlets(vector<GLuint>(quadIndices, quadIndices + 6), positions, 3, 4);
+    EXPECT(quad.meshlets.size() == 1);
+    const Meshlet& flat = quad.meshlets[0];
+    EXPECT(flat.triangleCount == 2);
+    EXPECT(isNear(glm::vec4(flat.centre, flat.radius), glm::vec4(0.5f, 0.5f, 0.0f, sqrtf(0.5f))));
+    EXPECT(isNear(glm::vec4(flat.coneAxis, flat.coneCutoff), glm::vec4(0.0f, 0.0f, 1.0f, 0.0f)));
+
+    // Seen from in front, from behind, and from behind but close enough to edge on that the
+    // bounding sphere makes the test conservative
+    Frustum everything(glm::ortho(-100.0f, 100.0f, -100.0f, 100.0f, -100.0f, 100.0f));
+    EXPECT(meshlets::isVisible(flat, everything, glm::vec3(0.5f, 0.5f, 10.0f)));
+    EXPECT(!meshlets::isVisible(flat, everything, glm::vec3(0.5f, 0.5f, -10.0f)));
+    EXPECT(meshlets::isVisible(flat, everything, glm::vec3(10.5f, 0.5f, -0.5f)));
+    EXPECT(!meshlets::isVisible(flat, everything, glm::vec3(10.5f, 0.5f, -1.0f)));
+
+    // The same quad with one triangle flipped faces both ways, so it can never be back facing
+    const GLuint foldedIndices[] = {0, 1, 2, 0, 3, 2};
+    MeshletData folded =
+        meshlets::buildMeshlets(vector<GLuint>(foldedIndices, foldedIndices + 6), positions, 3, 4);
+    EXPECT(folded.meshlets[0].coneCutoff >= 1.0f);
+    EXPECT(meshlets::isVisible(folded.meshlets[0], everything, glm::vec3(0.5f, 0.5f, -10.0f)));
+}
+
+void checkUniformNames()
+{
+    // FNV-1a test vector, whether the name is hashed at compile time or at run time
+    EXPECT(UNIFORM_NAME("foobar").getHash() == 0xbf9cf968u);
+    EXPECT(UniformName("foobar").getHash() == 0xbf9cf968u);
+    EXPECT(UniformName(string("foobar")).getHash() == 0xbf9cf968u);
+    EXPECT(UniformName("gb0").getHash() != UniformName("gb1").getHash());
+}
+
+vector<uint8_t> readFile(const string& filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    return vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Write 'contents' with one 32 bit field replaced, and check that TextureFile refuses to open it
+bool isRejected(const string& filename, vector<uint8_t> contents, uint offset, uint32_t value)
+{
+    memcpy(&contents[offset], &value, sizeof(value));
+    std::ofstream(filename, std::ios::binary)
+        .write(reinterpret_cast<const char*>(contents.data()), contents.size());
+    try
+    {
+        TextureFile file(filename);
+    }
+    catch (std::runtime_error&)
+    {
+        return true;
+    }
+    return false;
+}
+
+void checkTextureFiles()
+{
+    // A full mip chain of an odd sized gradient, so that the smallest levels are partial blocks
+    const uint width = 37, height = 12;
+    vector<uint8_t> pixels(width * height * 4);
+    for (uint i = 0; i < width * height; i++)
+    {
+        pixels[i * 4] = (uint8_t)(i % width * 7);
+        pixels[i * 4 + 1] = (uint8_t)(i / width * 21);
+        pixels[i * 4 + 2] = (uint8_t)(i * 3);
+        pixels[i * 4 + 3] = (uint8_t)(255 - i % 64);
+    }
+    vector<MipLevel> mips = mipgen::generateMipChain(pixels.data(), width, height);
+
+    const BlockFormat formats[] = {BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC4,
+                                   BLOCK_FORMAT_BC5};
+    const char* filenames[] = {"FrameworkChecks.dds", "FrameworkChecks.ktx2"};
+    for (uint f = 0; f < 4; f++)
+    {
+        vector<CompressedImage> levels;
+        levels.push_back(compressor::compress(pixels.data(), width, height, formats[f]));
+        for (auto i = mips.begin(); i != mips.end(); i++)
+        {
+            levels.push_back(
+                compressor::compress(i->pixels.data(), i->width, i->height, formats[f]));
+        }
+
+        for (uint type = 0; type < 2; type++)
+        {
+            TextureFile::write(filenames[type], levels);
+            {
+                TextureFile file(filenames[type]);
+                EXPECT(file.getType() == (type == 0 ? TEXTURE_FILE_DDS : TEXTURE_FILE_KTX2));
+                EXPECT(file.getFormat() == formats[f]);
+                EXPECT(file.getWidth() == width && file.getHeight() == height);
+                EXPECT(file.getLevelCount() == mipgen::getLevelCount(width, height));
+                bool identical = file.getLevelCount() == levels.size();
+                for (uint l = 0; identical && l < levels.size(); l++)
+                {
+                    const TextureFileLevel& level = file.getLevel(l);
+                    identical = level.width == levels[l].width &&
+                                level.height == levels[l].height &&
+                                level.size == levels[l].data.size() &&
+                                memcmp(level.data, levels[l].data.data(), level.size) == 0;
+                }
+                EXPECT(identical);
+            }
+        }
+    }
+
+    // Headers which don't match the data. The fields are at the same offsets for every format
+    vector<uint8_t> dds = readFile(filenames[0]);
+    const uint ddsHeight = 12, ddsWidth = 16, ddsMipMapCount = 28;
+    EXPECT(!isRejected(filenames[0], dds, ddsMipMapCount, 1));
+    EXPECT(isRejected(filenames[0], dds, ddsMipMapCount, 7));
+    EXPECT(isRejected(filenames[0], dds, ddsWidth, 0));
+    EXPECT(isRejected(filenames[0], dds, ddsHeight, 0));
+    EXPECT(isRejected(filenames[0], dds, ddsWidth, 0xFFFFFFFF));
+    EXPECT(isRejected(filenames[0], dds, ddsHeight, 16385));
+
+    vector<uint8_t> ktx2 = readFile(filenames[1]);
+    const uint ktx2Width = 20, ktx2Height = 24, ktx2LevelCount = 40;
+    EXPECT(isRejected(filenames[1], ktx2, ktx2LevelCount, 0));
+    EXPECT(isRejected(filenames[1], ktx2, ktx2LevelCount, 7));
+    EXPECT(isRejected(filenames[1], ktx2, ktx2LevelCount, 0xFFFFFFFF));
+    EXPECT(isRejected(filenames[1], ktx2, ktx2Width, 0));
+    EXPECT(isRejected(filenames[1], ktx2, ktx2Height, 0x40000000));
+
+    remove(filenames[0]);
+    remove(filenames[1]);
+}
+
+void checkTexturePacker()
+{
+    // Arrays split at the layer limit, and formats which differ in anything never share one
+    TextureLayerAllocator allocator(3);
+    const TextureArrayFormat rgba = {GL_RGBA8, 64, 64, 7};
+    const TextureArrayFormat bc1 = {GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 64, 64, 7};
+    const TextureArrayFormat smaller = {GL_RGBA8, 32, 64, 7};
+    const TextureArrayFormat fewerLevels = {GL_RGBA8, 64, 64, 1};
+    vector<TextureLayer> layers;
+    for (uint i = 0; i < 7; i++)
+        layers.push_back(allocator.allocate(rgba));
+    TextureLayer bc1Layer = allocator.allocate(bc1);
+    TextureLayer smallerLayer = allocator.allocate(smaller);
+    TextureLayer fewerLevelsLayer = allocator.allocate(fewerLevels);
+    bool packed = true;
+    for (uint i = 0; i < 7; i++)
+        packed = packed && layers[i].array == layers[i / 3 * 3].array && layers[i].layer == i % 3;
+    EXPECT(packed);
+    EXPECT(layers[0].array != layers[3].array && layers[3].array != layers[6].array);
+    EXPECT(allocator.getArrayCount() == 6);
+    EXPECT(allocator.getLayerCount(layers[6].array) == 1);
+    EXPECT(bc1Layer.layer == 0 && smallerLayer.layer == 0 && fewerLevelsLayer.layer == 0);
+    EXPECT(bc1Layer.array != smallerLayer.array && smallerLayer.array != fewerLevelsLayer.array);
+    EXPECT(allocator.getFormat(fewerLevelsLayer.array).levels == 1);
+
+    // Once the arrays have been built, even the one with free layers can't grow
+    allocator.close();
+    TextureLayer rebuilt = allocator.allocate(rgba);
+    EXPECT(rebuilt.array == 6 && rebuilt.layer == 0);
+    EXPECT(allocator.getLayerCount(layers[6].array) == 1);
+    EXPECT(allocator.allocate(rgba).array == 6);
+
+    // The packer groups RGBA8 images by size and level count. Without compression and with a
+    // fixed layer limit, adding textures doesn't need GL
+    TexturePacker packer(MIP_FILTER_BOX, false, 2);
+    vector<uint8_t> pixels(16 * 16 * 4, 255);
+    TextureLayer first = packer.add(pixels.data(), 16, 16);
+    TextureLayer other = packer.add(pixels.data(), 8, 16);
+    TextureLayer second = packer.add(pixels.data(), 16, 16);
+    TextureLayer third = packer.add(pixels.data(), 16, 16);
+    EXPECT(first.array == second.array && first.layer == 0 && second.layer == 1);
+    EXPECT(other.array != first.array && third.array != first.array && third.layer == 0);
+    EXPECT(packer.getArrayCount() == 3 && packer.getTextureCount() == 4);
+    EXPECT(packer.getArray(first) == nullptr);
+}
+
+uint64 getTargetBytes(const vector<streaming::BudgetEntry>& entries)
+{
+    uint64 total = 0;
+    for (auto i = entries.begin(); i != entries.end(); i++)
+    {
+        for (uint level = i->targetLevel; level < i->levelCount; level++)
+            total += i->levelSizes[level];
+    }
+    return total;
+}
+
+void checkTextureStreaming()
+{
+    // A 1024x1024 texture seen with one screen pixel per world unit at a distance of 1024 units
+    const float pixelsPerUnit = 1024.0f;
+    EXPECT(streaming::selectLevel(1024, 0.5f, 1.0f, pixelsPerUnit, 6) == 0);
+    EXPECT(streaming::selectLevel(1024, 1.0f, 1.0f, pixelsPerUnit, 6) == 0);
+    EXPECT(streaming::selectLevel(1024, 3.0f, 1.0f, pixelsPerUnit, 6) == 1);
+    EXPECT(streaming::selectLevel(1024, 4.0f, 1.0f, pixelsPerUnit, 6) == 2);
+    EXPECT(streaming::selectLevel(1024, 2.0f, 2.0f, pixelsPerUnit, 6) == 2);
+    EXPECT(streaming::selectLevel(512, 4.0f, 1.0f, pixelsPerUnit, 6) == 1);
+    EXPECT(streaming::selectLevel(1024, 1e6f, 1.0f, pixelsPerUnit, 4) == 4);
+    uint previous = 0;
+    bool monotonic = true;
+    for (float distance = 0.25f; distance < 1000.0f; distance *= 1.1f)
+    {
+        uint level = streaming::selectLevel(1024, distance, 1.0f, pixelsPerUnit, 6);
+        monotonic = monotonic && level >= previous && level <= 6;
+        previous = level;
+    }
+    EXPECT(monotonic);
+
+    // BC1 levels of a 1024x1024 texture, with the tail starting at 64x64
+    vector<uint> levelSizes;
+    for (uint size = 1024; size > 0; size /= 2)
+        levelSizes.push_back(glm::max((size + 3) / 4, 1u) * glm::max((size + 3) / 4, 1u) * 8);
+    const uint levelCount = levelSizes.size(), tailLevel = 4;
+    const float distances[] = {10.0f, 20.0f, 40.0f};
+    vector<streaming::BudgetEntry> requested;
+    for (uint i = 0; i < 3; i++)
+    {
+        streaming::BudgetEntry entry = {distances[i], 0, tailLevel, levelCount,
+                                        levelSizes.data()};
+        requested.push_back(entry);
+    }
+    uint64 requestedBytes = getTargetBytes(requested);
+    vector<streaming::BudgetEntry> tails = requested;
+    for (auto i = tails.begin(); i != tails.end(); i++)
+        i->targetLevel = tailLevel;
+    uint64 tailBytes = getTargetBytes(tails);
+
+    // Everything fits, so nothing changes
+    vector<streaming::BudgetEntry> entries = requested;
+    EXPECT(streaming::fitBudget(entries, requestedBytes) == requestedBytes);
+    EXPECT(entries[0].targetLevel == 0 && entries[1].targetLevel == 0 &&
+           entries[2].targetLevel == 0);
+
+    // One byte over drops only the finest level of the farthest texture
+    entries = requested;
+    uint64 targetBytes = streaming::fitBudget(entries, requestedBytes - 1);
+    EXPECT(targetBytes == requestedBytes - levelSizes[0]);
+    EXPECT(entries[0].targetLevel == 0 && entries[1].targetLevel == 0 &&
+           entries[2].targetLevel == 1);
+
+    // Across every budget the result fits, is what the levels add up to, and a farther texture is
+    // never sharper than a nearer one
+    bool fits = true, ordered = true;
+    for (uint64 budget = tailBytes; budget <= requestedBytes; budget += 1024)
+    {
+        entries = requested;
+        targetBytes = streaming::fitBudget(entries, budget);
+        fits = fits && targetBytes <= budget && targetBytes == getTargetBytes(entries);
+        ordered = ordered && entries[0].targetLevel <= entries[1].targetLevel &&
+                  entries[1].targetLevel <= entries[2].targetLevel &&
+                  entries[2].targetLevel <= tailLevel;
+    }
+    EXPECT(fits);
+    EXPECT(ordered);
+
+    // If even the tails don't fit, everything stops at its tail
+    entries = requested;
+    EXPECT(streaming::fitBudget(entries, 0) == tailBytes);
+    EXPECT(entries[0].targetLevel == tailLevel && entries[2].targetLevel == tailLevel);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    INFO << "Checking vertex layouts" << endl;
+    checkVertexLayouts();
+    INFO << "Checking index compression" << endl;
+    checkIndexCodec();
+    INFO << "Checking frustum culling" << endl;
+    checkFrustum();
+    INFO << "Checking normal cone culling" << endl;
+    checkNormalCones();
+    INFO << "Checking uniform names" << endl;
+    checkUniformNames();
+    INFO << "Checking texture files" << endl;
+    checkTextureFiles();
+    INFO << "Checking texture packing" << endl;
+    checkTexturePacker();
+    INFO << "Checking texture streaming" << endl;
+    checkTextureStreaming();
+
+    if (gFailureCount > 0)
+    {
+        ERROR << gFailureCount << " of " << gCheckCount << " checks failed" << endl;
+        return 1;
+    }
+    INFO << "All " << gCheckCount << " checks passed" << endl;
+    return 0;
+}
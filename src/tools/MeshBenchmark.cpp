@@ -0,0 +1,315 @@
+/*
+ * Mesh Benchmark
+ * Copyright (c) David Avedissian 2014-2015
+ *
+ * Runs the mesh processing stages over a fixed set of generated meshes and reports their results,
+ * so that changes to them can be compared run to run. The meshes are generated here rather than
+ * loaded, and everything runs on the CPU.
+ *
+ * Usage: MeshBenchmark [quantisation|optimisation|lod]
+ */
+#define SDL_MAIN_HANDLED
+
+#include "framework/Common.h"
+#include "framework/Frustum.h"
+#include "framework/MeshOptimiser.h"
+#include "framework/MeshQuantiser.h"
+#include "framework/MeshSimplifier.h"
+
+#include <algorithm>
+#include <random>
+
+// Interleaved format of the generated meshes: Position | Normal | UV
+#define FLOATS_PER_VERTEX 8
+
+struct BenchmarkMesh
+{
+    string name;
+    vector<GLfloat> vertexData;
+    vector<GLuint> indices;
+
+    uint getVertexCount() const
+    {
+        return vertexData.size() / FLOATS_PER_VERTEX;
+    }
+};
+
+void addVertex(BenchmarkMesh& mesh, const glm::vec3& position, const glm::vec3& normal,
+               const glm::vec2& texcoord)
+{
+    GLfloat vertex[FLOATS_PER_VERTEX] = {position.x, position.y, position.z, normal.x,
+                                         normal.y,   normal.z,   texcoord.x, texcoord.y};
+    mesh.vertexData.insert(mesh.vertexData.end(), vertex, vertex + FLOATS_PER_VERTEX);
+}
+
+// Index a grid of (columns + 1) x (rows + 1) vertices starting at 'firstVertex'
+void addGridIndices(BenchmarkMesh& mesh, uint firstVertex, uint columns, uint rows)
+{
+    for (uint y = 0; y < rows; y++)
+    {
+        for (uint x = 0; x < columns; x++)
+        {
+            GLuint a = firstVertex + y * (columns + 1) + x;
+            GLuint b = a + columns + 1;
+            GLuint quad[6] = {a, b, a + 1, a + 1, b, b + 1};
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+}
+
+BenchmarkMesh generateSphere(uint rings, uint segments)
+{
+    BenchmarkMesh mesh;
+    mesh.name = "sphere";
+    for (uint r = 0; r <= rings; r++)
+    {
+        float phi = glm::pi<float>() * r / rings;
+        for (uint s = 0; s <= segments; s++)
+        {
+            float theta = 2.0f * glm::pi<float>() * s / segments;
+            glm::vec3 normal(sin(phi) * cos(theta), cos(phi), sin(phi) * sin(theta));
+            addVertex(mesh, normal, normal, glm::vec2((float)s / segments, (float)r / rings));
+        }
+    }
+    addGridIndices(mesh, 0, segments, rings);
+    return mesh;
+}
+
+BenchmarkMesh generateBox(uint divisions)
+{
+    BenchmarkMesh mesh;
+    mesh.name = "box";
+    const glm::vec3 normals[6] = {{1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f},
+                                  {0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}};
+    for (uint face = 0; face < 6; face++)
+    {
+        // Each face is its own grid, so the corners are split along the normal seams
+        glm::vec3 normal = normals[face];
+        glm::vec3 u = glm::abs(normal.y) > 0.5f ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                                : glm::cross(glm::vec3(0.0f, 1.0f, 0.0f), normal);
+        glm::vec3 v = glm::cross(normal, u);
+        uint firstVertex = mesh.getVertexCount();
+        for (uint y = 0; y <= divisions; y++)
+        {
+            for (uint x = 0; x <= divisions; x++)
+            {
+                glm::vec2 texcoord((float)x / divisions, (float)y / divisions);
+                glm::vec3 position =
+                    (normal + u * (texcoord.x * 2.0f - 1.0f) + v * (texcoord.y * 2.0f - 1.0f)) *
+                    0.5f;
+                addVertex(mesh, position, normal, texcoord);
+            }
+        }
+        addGridIndices(mesh, firstVertex, divisions, divisions);
+    }
+    return mesh;
+}
+
+BenchmarkMesh generateTerrain(uint cells)
+{
+    BenchmarkMesh mesh;
+    mesh.name = "terrain";
+
+    // A few octaves of sine waves, with normals from the analytic derivatives
+    const float frequencies[3] = {0.05f, 0.13f, 0.41f};
+    const float amplitudes[3] = {4.0f, 1.5f, 0.3f};
+    for (uint z = 0; z <= cells; z++)
+    {
+        for (uint x = 0; x <= cells; x++)
+        {
+            float height = 0.0f, dx = 0.0f, dz = 0.0f;
+            for (uint i = 0; i < 3; i++)
+            {
+                float f = frequencies[i], a = amplitudes[i];
+                height += a * sin(x * f) * cos(z * f * 1.3f);
+                dx += a * f * cos(x * f) * cos(z * f * 1.3f);
+                dz -= a * f * 1.3f * sin(x * f) * sin(z * f * 1.3f);
+            }
+            glm::vec3 position((float)x, height, (float)z);
+            glm::vec3 normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+            addVertex(mesh, position, normal, glm::vec2(x, z) / 8.0f);
+        }
+    }
+    addGridIndices(mesh, 0, cells, cells);
+    return mesh;
+}
+
+vector<BenchmarkMesh> generateMeshes()
+{
+    vector<BenchmarkMesh> meshes;
+    meshes.push_back(generateSphere(64, 128));
+    meshes.push_back(generateBox(32));
+    meshes.push_back(generateTerrain(255));
+    return meshes;
+}
+
+void benchmarkQuantisation(const vector<BenchmarkMesh>& meshes)
+{
+    INFO << "Quantisation: bytes per vertex and worst case error" << endl;
+    FloatVertexFormat format = {FLOATS_PER_VERTEX, 0, 3, 6};
+    for (auto i = meshes.begin(); i != meshes.end(); i++)
+    {
+        uint64 startTime = SDL_GetPerformanceCounter();
+        QuantisedVertices quantised = quantiser::quantiseVertices(i->vertexData, format);
+        float seconds =
+            (float)(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+
+        // Position error is relative to the largest dimension of the bounds
+        float extent = glm::max(glm::max(quantised.positionScale.x, quantised.positionScale.y),
+                                quantised.positionScale.z);
+        INFO << "    " << i->name << ": " << quantised.vertexCount << " vertices, "
+             << quantised.originalVertexSize << " -> " << quantised.quantisedVertexSize
+             << " bytes per vertex, " << seconds * 1000.0f << "ms" << endl;
+        INFO << "        Max error: position " << quantised.error.maxPosition << " ("
+             << quantised.error.maxPosition / extent * 100.0f << "% of the bounds), normal "
+             << quantised.error.maxNormalAngle << " degrees, texcoord "
+             << quantised.error.maxTexcoord << endl;
+    }
+}
+
+void printCacheStatistics(const string& name, const vector<GLuint>& indices, uint vertexCount)
+{
+    VertexCacheStatistics statistics = optimiser::analyseVertexCache(indices, vertexCount);
+    INFO << "        " << name << ": ACMR " << statistics.acmr << ", ATVR " << statistics.atvr
+         << endl;
+}
+
+void benchmarkOptimisation(const vector<BenchmarkMesh>& meshes)
+{
+    INFO << "Optimisation: post-transform cache efficiency with a 16 entry FIFO" << endl;
+    for (auto i = meshes.begin(); i != meshes.end(); i++)
+    {
+        uint vertexCount = i->getVertexCount();
+        INFO << "    " << i->name << ": " << vertexCount << " vertices, " << i->indices.size() / 3
+             << " triangles" << endl;
+        printCacheStatistics("Generated", i->indices, vertexCount);
+
+        // The generators emit triangles in grid order, which is already fairly cache friendly.
+        // Shuffling them with a fixed seed gives the worst case an exporter might produce
+        vector<GLuint> indices = i->indices;
+        vector<uint> triangles(indices.size() / 3);
+        for (uint t = 0; t < triangles.size(); t++)
+            triangles[t] = t;
+        std::mt19937 random(1234);
+        std::shuffle(triangles.begin(), triangles.end(), random);
+        for (uint t = 0; t < triangles.size(); t++)
+        {
+            for (uint c = 0; c < 3; c++)
+                indices[t * 3 + c] = i->indices[triangles[t] * 3 + c];
+        }
+        printCacheStatistics("Shuffled", indices, vertexCount);
+
+        uint64 startTime = SDL_GetPerformanceCounter();
+        optimiser::optimiseVertexCache(indices, vertexCount);
+        float cacheSeconds =
+            (float)(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+        printCacheStatistics("Vertex cache optimised", indices, vertexCount);
+        INFO << "            Took " << cacheSeconds * 1000.0f << "ms" << endl;
+
+        startTime = SDL_GetPerformanceCounter();
+        optimiser::optimiseOverdraw(indices, i->vertexData.data(), FLOATS_PER_VERTEX,
+                                    vertexCount);
+        float overdrawSeconds =
+            (float)(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+        printCacheStatistics("Overdraw optimised", indices, vertexCount);
+        INFO << "            Took " << overdrawSeconds * 1000.0f << "ms" << endl;
+    }
+}
+
+void benchmarkLod(const vector<BenchmarkMesh>& meshes)
+{
+    INFO << "LOD: triangles drawn during a fly-through of a 10x10 grid of instances" << endl;
+
+    // The camera flies at a fixed height from well outside the grid, through it and out the
+    // other side, with the projection used by the deferred renderer
+    const uint frameCount = 600;
+    const uint gridSize = 10;
+    const float spacing = 20.0f;
+    const float viewportHeight = 768.0f;
+    glm::mat4 projMatrix = glm::perspective(glm::radians(45.0f), 1024.0f / 768.0f, 0.1f, 10000.0f);
+
+    for (auto i = meshes.begin(); i != meshes.end(); i++)
+    {
+        uint vertexCount = i->getVertexCount();
+        vector<GLuint> indices = i->indices;
+        uint64 startTime = SDL_GetPerformanceCounter();
+        vector<LodLevel> levels = simplifier::generateLodChain(indices, i->vertexData.data(),
+                                                               FLOATS_PER_VERTEX, vertexCount);
+        float generateSeconds =
+            (float)(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+        simplifier::printReport(i->name, levels);
+        INFO << "    Generated in " << generateSeconds * 1000.0f << "ms" << endl;
+
+        // Scale each instance to a radius of about 5 units. Instances are placed by the centre of
+        // their bounds
+        glm::vec3 min = glm::make_vec3(i->vertexData.data()), max = min;
+        for (uint v = 0; v < vertexCount; v++)
+        {
+            glm::vec3 position = glm::make_vec3(&i->vertexData[v * FLOATS_PER_VERTEX]);
+            min = glm::min(min, position);
+            max = glm::max(max, position);
+        }
+        float scale = 10.0f / glm::length(max - min);
+        float radius = glm::length(max - min) * 0.5f * scale;
+
+        uint64 fullTriangles = 0, drawnTriangles = 0;
+        vector<uint> levelUses(levels.size(), 0);
+        uint64 selectTicks = 0;
+        for (uint frame = 0; frame < frameCount; frame++)
+        {
+            float t = (float)frame / (frameCount - 1);
+            glm::vec3 cameraPosition(5.0f, 10.0f, glm::mix(600.0f, -300.0f, t));
+            glm::mat4 viewMatrix = glm::lookAt(cameraPosition,
+                                               cameraPosition + glm::vec3(0.0f, -0.1f, -1.0f),
+                                               glm::vec3(0.0f, 1.0f, 0.0f));
+            Frustum frustum(projMatrix * viewMatrix);
+
+            uint64 frameStart = SDL_GetPerformanceCounter();
+            for (uint x = 0; x < gridSize; x++)
+            {
+                for (uint z = 0; z < gridSize; z++)
+                {
+                    glm::vec3 position((x - (gridSize - 1) * 0.5f) * spacing, 0.0f,
+                                       (z - (gridSize - 1) * 0.5f) * spacing);
+                    if (!frustum.containsSphere(position, radius))
+                        continue;
+                    uint level = simplifier::selectLod(levels, position, scale, viewMatrix,
+                                                       projMatrix, viewportHeight);
+                    levelUses[level]++;
+                    fullTriangles += levels[0].indexCount / 3;
+                    drawnTriangles += levels[level].indexCount / 3;
+                }
+            }
+            selectTicks += SDL_GetPerformanceCounter() - frameStart;
+        }
+
+        INFO << "    Fly-through: " << fullTriangles / frameCount << " -> "
+             << drawnTriangles / frameCount << " triangles per frame ("
+             << 100.0f * drawnTriangles / glm::max(fullTriangles, (uint64)1) << "%), "
+             << (float)selectTicks / SDL_GetPerformanceFrequency() * 1e6f / frameCount
+             << "us per frame to cull and select" << endl;
+        stringstream uses;
+        for (uint l = 0; l < levelUses.size(); l++)
+            uses << " " << levelUses[l];
+        INFO << "    Instances drawn at each LOD:" << uses.str() << endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    string stage = argc > 1 ? argv[1] : "";
+    if (!stage.empty() && stage != "quantisation" && stage != "optimisation" && stage != "lod")
+    {
+        cerr << "Usage: " << argv[0] << " [quantisation|optimisation|lod]" << endl;
+        return 1;
+    }
+
+    vector<BenchmarkMesh> meshes = generateMeshes();
+    if (stage.empty() || stage == "quantisation")
+        benchmarkQuantisation(meshes);
+    if (stage.empty() || stage == "optimisation")
+        benchmarkOptimisation(meshes);
+    if (stage.empty() || stage == "lod")
+        benchmarkLod(meshes);
+    return 0;
+}
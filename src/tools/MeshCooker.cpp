@@ -0,0 +1,289 @@
+/*
+ * Mesh Cooker
+ * Copyright (c) David Avedissian 2014-2015
+ *
+ * Converts Wavefront OBJ files into the binary mesh format loaded by MeshFile. The geometry is
+ * optimised for the vertex cache, overdraw and vertex fetch, then optionally quantised.
+ *
+ * Usage: MeshCooker <input.obj> <output.mesh> [--float] [--compress-indices]
+ */
+#define SDL_MAIN_HANDLED
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "framework/Common.h"
+#include "framework/MeshFile.h"
+#include "framework/MeshOptimiser.h"
+#include "framework/MeshQuantiser.h"
+#include "framework/Utils.h"
+
+// Interleaved output format: Position | Normal | UV
+#define FLOATS_PER_VERTEX 8
+
+struct ObjMesh
+{
+    vector<GLfloat> vertexData;
+    vector<GLuint> indices;
+    bool hasNormals;
+    bool hasTexcoords;
+};
+
+// Parse a single 'v', 'v/vt', 'v//vn' or 'v/vt/vn' face reference. Indices are 1 based, and
+// negative indices are relative to the end of the list
+std::tuple<int, int, int> parseFaceVertex(const string& token, int positionCount,
+                                          int texcoordCount, int normalCount)
+{
+    int indices[3] = {0, 0, 0};
+    int counts[3] = {positionCount, texcoordCount, normalCount};
+    size_t start = 0;
+    for (int i = 0; i < 3 && start <= token.size(); i++)
+    {
+        size_t end = token.find('/', start);
+        string part = token.substr(start, end == string::npos ? string::npos : end - start);
+        if (!part.empty())
+        {
+            int index = std::stoi(part);
+            indices[i] = index < 0 ? counts[i] + index : index - 1;
+        }
+        else
+        {
+            indices[i] = -1;
+        }
+        if (end == string::npos)
+        {
+            for (int j = i + 1; j < 3; j++)
+                indices[j] = -1;
+            break;
+        }
+        start = end + 1;
+    }
+    return std::make_tuple(indices[0], indices[1], indices[2]);
+}
+
+ObjMesh loadObj(const string& filename)
+{
+    ObjMesh mesh;
+    mesh.hasNormals = true;
+    mesh.hasTexcoords = true;
+
+    vector<glm::vec3> positions, normals;
+    vector<glm::vec2> texcoords;
+    std::map<std::tuple<int, int, int>, GLuint> vertexMap;
+
+    stringstream stream(utils::readEntireFile(filename));
+    string line;
+    while (getline(stream, line))
+    {
+        stringstream lineStream(line);
+        string type;
+        lineStream >> type;
+        if (type == "v")
+        {
+            glm::vec3 p;
+            lineStream >> p.x >> p.y >> p.z;
+            positions.push_back(p);
+        }
+        else if (type == "vn")
+        {
+            glm::vec3 n;
+            lineStream >> n.x >> n.y >> n.z;
+            normals.push_back(n);
+        }
+        else if (type == "vt")
+        {
+            glm::vec2 t;
+            lineStream >> t.x >> t.y;
+            texcoords.push_back(t);
+        }
+        else if (type == "f")
+        {
+            // Triangulate polygons as a fan
+            vector<GLuint> face;
+            string token;
+            while (lineStream >> token)
+            {
+                std::tuple<int, int, int> key = parseFaceVertex(
+                    token, positions.size(), texcoords.size(), normals.size());
+                auto existing = vertexMap.find(key);
+                if (existing != vertexMap.end())
+                {
+                    face.push_back(existing->second);
+                    continue;
+                }
+
+                int p = std::get<0>(key), t = std::get<1>(key), n = std::get<2>(key);
+                if (p < 0 || p >= (int)positions.size() || t >= (int)texcoords.size() ||
+                    n >= (int)normals.size())
+                {
+                    stringstream err;
+                    err << "Error: Invalid face '" << line << "' in '" << filename << "'" << endl;
+                    throw std::runtime_error(err.str());
+                }
+                mesh.hasTexcoords &= t >= 0;
+                mesh.hasNormals &= n >= 0;
+
+                glm::vec3 normal = n >= 0 ? normals[n] : glm::vec3(0.0f);
+                glm::vec2 texcoord = t >= 0 ? texcoords[t] : glm::vec2(0.0f);
+                GLfloat vertex[FLOATS_PER_VERTEX] = {
+                    positions[p].x, positions[p].y, positions[p].z,
+                    normal.x, normal.y, normal.z,
+                    texcoord.x, texcoord.y};
+                GLuint index = mesh.vertexData.size() / FLOATS_PER_VERTEX;
+                mesh.vertexData.insert(mesh.vertexData.end(), vertex, vertex + FLOATS_PER_VERTEX);
+                vertexMap[key] = index;
+                face.push_back(index);
+            }
+
+            for (uint i = 2; i < face.size(); i++)
+            {
+                mesh.indices.push_back(face[0]);
+                mesh.indices.push_back(face[i - 1]);
+                mesh.indices.push_back(face[i]);
+            }
+        }
+    }
+
+    if (mesh.indices.empty())
+    {
+        stringstream err;
+        err << "Error: '" << filename << "' has no faces" << endl;
+        throw std::runtime_error(err.str());
+    }
+
+    // Generate smooth normals if the file didn't have them for every vertex
+    if (!mesh.hasNormals)
+    {
+        for (uint i = 0; i < mesh.vertexData.size(); i += FLOATS_PER_VERTEX)
+            mesh.vertexData[i + 3] = mesh.vertexData[i + 4] = mesh.vertexData[i + 5] = 0.0f;
+        for (uint i = 0; i < mesh.indices.size(); i += 3)
+        {
+            GLfloat* v[3];
+            for (uint k = 0; k < 3; k++)
+                v[k] = &mesh.vertexData[mesh.indices[i + k] * FLOATS_PER_VERTEX];
+            glm::vec3 faceNormal = glm::cross(glm::make_vec3(v[1]) - glm::make_vec3(v[0]),
+                                              glm::make_vec3(v[2]) - glm::make_vec3(v[0]));
+            for (uint k = 0; k < 3; k++)
+            {
+                v[k][3] += faceNormal.x;
+                v[k][4] += faceNormal.y;
+                v[k][5] += faceNormal.z;
+            }
+        }
+        for (uint i = 0; i < mesh.vertexData.size(); i += FLOATS_PER_VERTEX)
+        {
+            glm::vec3 n = glm::make_vec3(&mesh.vertexData[i + 3]);
+            float length = glm::length(n);
+            n = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+            mesh.vertexData[i + 3] = n.x;
+            mesh.vertexData[i + 4] = n.y;
+            mesh.vertexData[i + 5] = n.z;
+        }
+        mesh.hasNormals = true;
+    }
+
+    return mesh;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: " << argv[0] << " <input.obj> <output.mesh> [--float] [--compress-indices]"
+             << endl;
+        return 1;
+    }
+
+    bool quantise = true;
+    bool compressIndices = false;
+    for (int i = 3; i < argc; i++)
+    {
+        string option = argv[i];
+        if (option == "--float")
+        {
+            quantise = false;
+        }
+        else if (option == "--compress-indices")
+        {
+            compressIndices = true;
+        }
+        else
+        {
+            ERROR << "Unknown option '" << option << "'" << endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        INFO << "Cooking '" << argv[1] << "'" << endl;
+        ObjMesh mesh = loadObj(argv[1]);
+        uint vertexCount = mesh.vertexData.size() / FLOATS_PER_VERTEX;
+
+        // Optimise
+        VertexCacheStatistics before = optimiser::analyseVertexCache(mesh.indices, vertexCount);
+        optimiser::optimiseVertexCache(mesh.indices, vertexCount);
+        optimiser::optimiseOverdraw(mesh.indices, mesh.vertexData.data(), FLOATS_PER_VERTEX,
+                                    vertexCount);
+        vertexCount = optimiser::optimiseVertexFetch(mesh.vertexData.data(), vertexCount,
+                                                     FLOATS_PER_VERTEX * sizeof(GLfloat),
+                                                     mesh.indices);
+        mesh.vertexData.resize(vertexCount * FLOATS_PER_VERTEX);
+        VertexCacheStatistics after = optimiser::analyseVertexCache(mesh.indices, vertexCount);
+        INFO << vertexCount << " vertices, " << mesh.indices.size() / 3 << " triangles, ACMR "
+             << before.acmr << " -> " << after.acmr << endl;
+
+        // Fill in the file contents
+        MeshFileContents contents;
+        contents.vertexCount = vertexCount;
+        contents.indices = mesh.indices;
+        contents.compressIndices = compressIndices;
+        contents.boundsMin = contents.boundsMax = glm::make_vec3(mesh.vertexData.data());
+        for (uint i = 0; i < mesh.vertexData.size(); i += FLOATS_PER_VERTEX)
+        {
+            glm::vec3 position = glm::make_vec3(&mesh.vertexData[i]);
+            contents.boundsMin = glm::min(contents.boundsMin, position);
+            contents.boundsMax = glm::max(contents.boundsMax, position);
+        }
+
+        FloatVertexFormat format = {FLOATS_PER_VERTEX, 0, 3, mesh.hasTexcoords ? 6 : -1};
+        QuantisedVertices quantised;
+        if (quantise)
+        {
+            quantised = quantiser::quantiseVertices(mesh.vertexData, format);
+            quantiser::printReport(argv[1], quantised);
+            contents.layout = quantised.layout;
+            contents.vertexData = quantised.data.data();
+            contents.positionOffset = quantised.positionOffset;
+            contents.positionScale = quantised.positionScale;
+        }
+        else
+        {
+            contents.layout.add(3, GL_FLOAT).add(3, GL_FLOAT);
+            if (mesh.hasTexcoords)
+                contents.layout.add(2, GL_FLOAT);
+
+            // Drop the unused texcoord slots from the interleaved data
+            uint floatsPerVertex = contents.layout.getStride() / sizeof(GLfloat);
+            for (uint v = 0; v < vertexCount; v++)
+            {
+                auto src = mesh.vertexData.begin() + v * FLOATS_PER_VERTEX;
+                std::copy(src, src + floatsPerVertex, mesh.vertexData.begin() + v * floatsPerVertex);
+            }
+            contents.vertexData = mesh.vertexData.data();
+            contents.positionOffset = glm::vec3(0.0f);
+            contents.positionScale = glm::vec3(1.0f);
+        }
+
+        MeshFile::write(argv[2], contents);
+        INFO << "Wrote '" << argv[2] << "'" << endl;
+    }
+    catch (std::exception& e)
+    {
+        ERROR << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Texture Benchmark
+ * Copyright (c) David Avedissian 2014-2015
+ *
+ * Runs the texture processing stages over a set of images on the CPU and reports their
+ * throughput, and the quality of each block compression format. The SSE2 mip chains are checked
+ * byte for byte against the scalar reference, and the tool exits with a non-zero code if they
+ * differ. Without any images, a generated noise image and a non power of two gradient are used
+ * instead. Every stage runs unless some are named.
+ *
+ * Usage: TextureBenchmark [mip] [compression] [image ...]
+ */
+#define SDL_MAIN_HANDLED
+
+#include "framework/Common.h"
+#include "framework/MipGenerator.h"
+#include "framework/TextureCompressor.h"
+
+#include <stb_image.h>
+
+struct BenchmarkImage
+{
+    string name;
+    uint width;
+    uint height;
+    vector<uint8_t> pixels;
+};
+
+BenchmarkImage loadImage(const string& filename)
+{
+    int width, height, numComponents;
+    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &numComponents, 4);
+    if (!data)
+    {
+        stringstream err;
+        err << "Error: Failed to load image '" << filename << "': " << stbi_failure_reason()
+            << endl;
+        throw std::runtime_error(err.str());
+    }
+    BenchmarkImage image = {filename, (uint)width, (uint)height,
+                            vector<uint8_t>(data, data + width * height * 4)};
+    stbi_image_free(data);
+    return image;
+}
+
+vector<BenchmarkImage> generateImages()
+{
+    vector<BenchmarkImage> images;
+
+    // A noisy pattern, so that the filters can't take any shortcuts
+    BenchmarkImage noise = {"noise", 1024, 1024, vector<uint8_t>(1024 * 1024 * 4)};
+    uint seed = 1;
+    for (auto i = noise.pixels.begin(); i != noise.pixels.end(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        *i = (uint8_t)(seed >> 24);
+    }
+    images.push_back(noise);
+
+    // Odd sizes exercise the edges of every level
+    BenchmarkImage gradient = {"gradient", 777, 333, vector<uint8_t>(777 * 333 * 4)};
+    for (uint y = 0; y < gradient.height; y++)
+    {
+        for (uint x = 0; x < gradient.width; x++)
+        {
+            uint8_t* pixel = &gradient.pixels[(y * gradient.width + x) * 4];
+            pixel[0] = (uint8_t)(x * 255 / (gradient.width - 1));
+            pixel[1] = (uint8_t)(y * 255 / (gradient.height - 1));
+            pixel[2] = (uint8_t)((x ^ y) & 0xFF);
+            pixel[3] = (uint8_t)(255 - pixel[0] / 2);
+        }
+    }
+    images.push_back(gradient);
+    return images;
+}
+
+// Time a mip chain, taking the best of a few runs to hide any interruptions
+float timeMipChain(const BenchmarkImage& image, MipFilter filter, bool srgb, bool simd,
+                   vector<MipLevel>& mips)
+{
+    float bestSeconds = 1e9f;
+    for (uint run = 0; run < 3; run++)
+    {
+        uint64 startTime = SDL_GetPerformanceCounter();
+        mips = mipgen::generateMipChain(image.pixels.data(), image.width, image.height, filter,
+                                        srgb, simd);
+        float seconds =
+            (float)(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+        bestSeconds = glm::min(bestSeconds, seconds);
+    }
+    return bestSeconds;
+}
+
+// Returns the number of bytes which differ between two mip chains
+uint compareMipChains(const vector<MipLevel>& a, const vector<MipLevel>& b)
+{
+    if (a.size() != b.size())
+        return ~0u;
+    uint differences = 0;
+    for (uint level = 0; level < a.size(); level++)
+    {
+        if (a[level].width != b[level].width || a[level].height != b[level].height)
+            return ~0u;
+        for (uint i = 0; i < a[level].pixels.size(); i++)
+            differences += a[level].pixels[i] != b[level].pixels[i] ? 1 : 0;
+    }
+    return differences;
+}
+
+// Returns false if the SIMD and scalar chains differ
+bool benchmarkMipGeneration(const vector<BenchmarkImage>& images)
+{
+    INFO << "Mip generation: SSE2 " << (mipgen::isSimdSupported() ? "enabled" : "not compiled in")
+         << ", megapixels per second" << endl;
+    bool matched = true;
+    const MipFilter filters[] = {MIP_FILTER_BOX, MIP_FILTER_KAISER, MIP_FILTER_LANCZOS};
+    for (auto i = images.begin(); i != images.end(); i++)
+    {
+        INFO << "    " << i->name << " (" << i->width << "x" << i->height << ")" << endl;
+        float megapixels = i->width * i->height / 1000000.0f;
+        for (uint f = 0; f < 3; f++)
+        {
+            for (uint srgb = 0; srgb < 2; srgb++)
+            {
+                vector<MipLevel> simdMips, scalarMips;
+                float simdSeconds = timeMipChain(*i, filters[f], srgb == 1, true, simdMips);
+                float scalarSeconds = timeMipChain(*i, filters[f], srgb == 1, false, scalarMips);
+                uint differences = compareMipChains(simdMips, scalarMips);
+                INFO << "        " << mipgen::getFilterName(filters[f])
+                     << (srgb ? " sRGB" : " linear") << ": SIMD " << megapixels / simdSeconds
+                     << ", scalar " << megapixels / scalarSeconds << ", "
+                     << (differences == 0 ? "identical" : "MISMATCH") << endl;
+                if (differences != 0)
+                {
+                    ERROR << "SIMD and scalar " << mipgen::getFilterName(filters[f])
+                          << " chains differ in " << differences << " bytes" << endl;
+                    matched = false;
+                }
+            }
+        }
+    }
+    return matched;
+}
+
+void benchmarkCompression(const vector<BenchmarkImage>& images)
+{
+    INFO << "Block compression: every format, and the one chosen for each image" << endl;
+    const BlockFormat formats[] = {BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC4,
+                                   BLOCK_FORMAT_BC5};
+    for (auto i = images.begin(); i != images.end(); i++)
+    {
+        BlockFormat chosen = compressor::chooseFormat(
+            compressor::analyseChannels(i->pixels.data(), i->width, i->height));
+        INFO << "    " << i->name << " (" << i->width << "x" << i->height << "), "
+             << compressor::getFormatName(chosen) << " chosen" << endl;
+        for (uint f = 0; f < 4; f++)
+        {
+            compressor::printReport(
+                i->name, compressor::benchmark(i->pixels.data(), i->width, i->height, formats[f]));
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool mip = false, compression = false;
+    vector<string> filenames;
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+        if (argument == "mip")
+            mip = true;
+        else if (argument == "compression")
+            compression = true;
+        else
+            filenames.push_back(argument);
+    }
+    if (!mip && !compression)
+        mip = compression = true;
+
+    try
+    {
+        vector<BenchmarkImage> images;
+        for (auto i = filenames.begin(); i != filenames.end(); i++)
+            images.push_back(loadImage(*i));
+        if (images.empty())
+            images = generateImages();
+
+        bool passed = true;
+        if (mip)
+            passed = benchmarkMipGeneration(images) && passed;
+        if (compression)
+            benchmarkCompression(images);
+        return passed ? 0 : 1;
+    }
+    catch (std::exception& e)
+    {
+        ERROR << e.what();
+        return 1;
+    }
+}
@@ -0,0 +1,112 @@
+/*
+ * Texture Cooker
+ * Copyright (c) David Avedissian 2014-2015
+ *
+ * Converts JPEG and PNG images into block compressed DDS or KTX2 files, which Texture uploads
+ * straight from a memory mapping. The mip chain is generated and every level compressed here, so
+ * that loading the file does no work beyond reading it.
+ *
+ * Usage: TextureCooker <input.jpg|png> <output.dds|ktx2> [--format bc1|bc3|bc4|bc5]
+ *                      [--filter box|kaiser|lanczos] [--linear]
+ */
+#define SDL_MAIN_HANDLED
+
+#include "framework/Common.h"
+#include "framework/MipGenerator.h"
+#include "framework/TextureCompressor.h"
+#include "framework/TextureFile.h"
+
+#include <stb_image.h>
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        cerr << "Usage: " << argv[0] << " <input.jpg|png> <output.dds|ktx2> "
+             << "[--format bc1|bc3|bc4|bc5] [--filter box|kaiser|lanczos] [--linear]" << endl;
+        return 1;
+    }
+    if (!TextureFile::isTextureFile(argv[2]))
+    {
+        ERROR << "Output file '" << argv[2] << "' must be a .dds or .ktx2 file" << endl;
+        return 1;
+    }
+
+    bool chooseFormat = true;
+    BlockFormat format = BLOCK_FORMAT_BC1;
+    MipFilter filter = MIP_FILTER_KAISER;
+    bool srgb = true;
+    for (int i = 3; i < argc; i++)
+    {
+        string option = argv[i];
+        string value = i + 1 < argc ? argv[i + 1] : "";
+        if (option == "--format" && (value == "bc1" || value == "bc3" || value == "bc4" ||
+                                     value == "bc5"))
+        {
+            const BlockFormat formats[] = {BLOCK_FORMAT_BC1, BLOCK_FORMAT_BC3, BLOCK_FORMAT_BC4,
+                                           BLOCK_FORMAT_BC5};
+            format = formats[value == "bc1" ? 0 : value == "bc3" ? 1 : value == "bc4" ? 2 : 3];
+            chooseFormat = false;
+            i++;
+        }
+        else if (option == "--filter" && (value == "box" || value == "kaiser" || value == "lanczos"))
+        {
+            filter = value == "box" ? MIP_FILTER_BOX
+                                    : value == "kaiser" ? MIP_FILTER_KAISER : MIP_FILTER_LANCZOS;
+            i++;
+        }
+        else if (option == "--linear")
+        {
+            srgb = false;
+        }
+        else
+        {
+            ERROR << "Unknown option '" << option << "'" << endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        INFO << "Cooking '" << argv[1] << "'" << endl;
+        int width, height, numComponents;
+        unsigned char* pixels = stbi_load(argv[1], &width, &height, &numComponents, 4);
+        if (!pixels)
+        {
+            stringstream err;
+            err << "Error: Failed to load image '" << argv[1] << "': " << stbi_failure_reason()
+                << endl;
+            throw std::runtime_error(err.str());
+        }
+
+        // Pick the smallest format which keeps every channel the image uses
+        if (chooseFormat)
+            format = compressor::chooseFormat(compressor::analyseChannels(pixels, width, height));
+        compressor::printReport(argv[1], compressor::benchmark(pixels, width, height, format));
+
+        // Generate and compress the mip chain
+        vector<CompressedImage> levels;
+        levels.push_back(compressor::compress(pixels, width, height, format));
+        vector<MipLevel> mips = mipgen::generateMipChain(pixels, width, height, filter, srgb);
+        for (auto i = mips.begin(); i != mips.end(); i++)
+            levels.push_back(compressor::compress(i->pixels.data(), i->width, i->height, format));
+        stbi_image_free(pixels);
+
+        uint size = 0;
+        for (auto i = levels.begin(); i != levels.end(); i++)
+            size += i->data.size();
+        INFO << width << "x" << height << ", " << levels.size() << " levels, "
+             << mipgen::getFilterName(filter) << " filter, " << compressor::getFormatName(format)
+             << ", " << size / 1024 << " KB" << endl;
+
+        TextureFile::write(argv[2], levels);
+        INFO << "Wrote '" << argv[2] << "'" << endl;
+    }
+    catch (std::exception& e)
+    {
+        ERROR << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
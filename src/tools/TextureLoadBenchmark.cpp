@@ -0,0 +1,121 @@
+/*
+ * Texture Load Benchmark
+ * Copyright (c) David Avedissian 2014-2015
+ *
+ * Queues a number of texture loads on AsyncTextureLoader at once, then updates it every frame
+ * until they have all been uploaded, and reports the throughput and the latency of each load.
+ * The images are cycled through until the count is reached. Opens a small window for the GL
+ * context and exits once the results have been logged.
+ *
+ * Usage: TextureLoadBenchmark <count> <image> [<image> ...] [--no-compression]
+ */
+#define SDL_MAIN_HANDLED
+
+#include "framework/Common.h"
+#include "framework/Application.h"
+#include "framework/AsyncTextureLoader.h"
+#include "framework/Texture.h"
+#include "framework/ThreadPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#define WIDTH 256
+#define HEIGHT 256
+
+uint gCount = 0;
+vector<string> gFilenames;
+bool gCompression = true;
+
+class TextureLoadBenchmark : public Application
+{
+public:
+    virtual void startup() override
+    {
+        mLoader = new AsyncTextureLoader(ThreadPool::getDefault());
+        mLoader->setCompression(gCompression);
+        INFO << "Loading " << gCount << " textures on "
+             << ThreadPool::getDefault().getThreadCount() << " threads"
+             << (gCompression ? "" : " without compression") << endl;
+
+        mFrames = 0;
+        mStartTime = SDL_GetPerformanceCounter();
+        for (uint i = 0; i < gCount; i++)
+        {
+            uint64 queueTime = SDL_GetPerformanceCounter();
+            Texture* texture = mLoader->load(gFilenames[i % gFilenames.size()],
+                                             [this, queueTime](Texture*) {
+                mLatencies.push_back((float)(SDL_GetPerformanceCounter() - queueTime) /
+                                     SDL_GetPerformanceFrequency());
+            });
+            mTextures.push_back(texture);
+        }
+        mQueueSeconds =
+            (float)(SDL_GetPerformanceCounter() - mStartTime) / SDL_GetPerformanceFrequency();
+    }
+
+    virtual void shutdown() override
+    {
+        for (auto i = mTextures.begin(); i != mTextures.end(); i++)
+            delete *i;
+        delete mLoader;
+    }
+
+    virtual bool render() override
+    {
+        // Uploads are spread over frames by the loader's budget, as they would be in a scene
+        mLoader->update();
+        mFrames++;
+        if (mLoader->getPendingCount() > 0)
+            return true;
+
+        float seconds =
+            (float)(SDL_GetPerformanceCounter() - mStartTime) / SDL_GetPerformanceFrequency();
+        const AsyncTextureStatistics& statistics = mLoader->getStatistics();
+        INFO << "Loaded " << statistics.loadedCount << " textures in " << seconds * 1000.0f
+             << "ms over " << mFrames << " frames, " << mQueueSeconds * 1000.0f
+             << "ms spent queueing" << endl;
+        INFO << "    Throughput: " << statistics.loadedCount / seconds << " textures per second, "
+             << statistics.uploadedBytes / (1024.0f * 1024.0f) / seconds << " MB per second"
+             << endl;
+
+        std::sort(mLatencies.begin(), mLatencies.end());
+        float total = 0.0f;
+        for (auto i = mLatencies.begin(); i != mLatencies.end(); i++)
+            total += *i;
+        INFO << "    Latency: " << mLatencies.front() * 1000.0f << "ms min, "
+             << mLatencies[mLatencies.size() / 2] * 1000.0f << "ms median, "
+             << total * 1000.0f / mLatencies.size() << "ms mean, " << mLatencies.back() * 1000.0f
+             << "ms max" << endl;
+        mLoader->printReport();
+        return false;
+    }
+
+private:
+    AsyncTextureLoader* mLoader;
+    vector<Texture*> mTextures;
+    vector<float> mLatencies;
+    uint64 mStartTime;
+    float mQueueSeconds;
+    uint mFrames;
+};
+
+int main(int argc, char** argv)
+{
+    for (int i = 2; i < argc; i++)
+    {
+        string argument = argv[i];
+        if (argument == "--no-compression")
+            gCompression = false;
+        else
+            gFilenames.push_back(argument);
+    }
+    if (argc < 3 || atoi(argv[1]) <= 0 || gFilenames.empty())
+    {
+        cerr << "Usage: " << argv[0] << " <count> <image> [<image> ...] [--no-compression]"
+             << endl;
+        return 1;
+    }
+    gCount = atoi(argv[1]);
+    return TextureLoadBenchmark().run("TextureLoadBenchmark", WIDTH, HEIGHT);
+}
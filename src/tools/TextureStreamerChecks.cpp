@@ -0,0 +1,221 @@
+/*
+ * Texture Streamer Checks
+ * Copyright (c) David Avedissian 2014-2015
+ *
+ * Streams copies of a cooked texture through TextureStreamer, first up close with no budget to
+ * speak of, then out of view, and finally spread out under a budget too small for all of them.
+ * After every update, the levels GL holds for each copy are checked against the resident level
+ * the streamer reports. Opens a small window for the GL context, and exits with a non-zero code
+ * if any check fails. The texture must be a DDS or KTX2 file larger than 64x64 with a full mip
+ * chain, as written by TextureCooker.
+ *
+ * Usage: TextureStreamerChecks <texture>
+ */
+#define SDL_MAIN_HANDLED
+
+#include "framework/Common.h"
+#include "framework/Application.h"
+#include "framework/Texture.h"
+#include "framework/TextureStreamer.h"
+#include "framework/ThreadPool.h"
+
+#define WIDTH 256
+#define HEIGHT 256
+
+#define EXPECT(condition) check((condition), #condition, __LINE__)
+
+string gFilename;
+uint gCheckCount = 0;
+uint gFailureCount = 0;
+
+void check(bool passed, const char* condition, int line)
+{
+    gCheckCount++;
+    if (!passed)
+    {
+        ERROR << "Check failed on line " << line << ": " << condition << endl;
+        gFailureCount++;
+    }
+}
+
+enum Phase
+{
+    PHASE_NEAR,   // Every copy needs its finest level, and they all fit
+    PHASE_FAR,    // No uses, so only the tails are kept
+    PHASE_BUDGET, // Copies at increasing distances, with a budget too small for what they need
+    PHASE_COUNT
+};
+
+const char* kPhaseNames[PHASE_COUNT] = {"near", "far", "budget"};
+
+const uint kCopyCount = 4;
+
+// A phase which hasn't settled by now is stuck
+const uint kMaxPhaseFrames = 1000;
+
+class TextureStreamerChecks : public Application
+{
+public:
+    virtual void startup() override
+    {
+        mStreamer = new TextureStreamer(ThreadPool::getDefault(), ~0ull);
+        mStreamer->setViewport(HEIGHT, glm::radians(45.0f));
+        for (uint i = 0; i < kCopyCount; i++)
+            mTextures.push_back(mStreamer->add(gFilename));
+        mTailLevel = mStreamer->getResidentLevel(mTextures[0]);
+        if (mTailLevel == 0)
+        {
+            stringstream err;
+            err << "Error: '" << gFilename << "' has no levels above its tail to stream" << endl;
+            throw std::runtime_error(err.str());
+        }
+        EXPECT(glGetError() == GL_NO_ERROR);
+        checkLevels();
+
+        INFO << "Streaming " << kCopyCount << " copies of '" << gFilename << "', "
+             << mTextures[0]->getWidth() << "x" << mTextures[0]->getHeight() << " with "
+             << mTextures[0]->getLevelCount() << " levels" << endl;
+        mPhase = PHASE_NEAR;
+        mPhaseFrames = 0;
+        mPhaseStatistics = mStreamer->getStatistics();
+    }
+
+    virtual void shutdown() override
+    {
+        delete mStreamer;
+    }
+
+    virtual bool render() override
+    {
+        if (mPhase != PHASE_FAR)
+        {
+            for (uint i = 0; i < kCopyCount; i++)
+                mStreamer->use(mTextures[i], getDistance(i));
+        }
+        mStreamer->update();
+        checkLevels();
+
+        // Move on once every level wanted has been uploaded
+        mPhaseFrames++;
+        const TextureStreamerStatistics& statistics = mStreamer->getStatistics();
+        if (statistics.pendingLevels > 0 && mPhaseFrames < kMaxPhaseFrames)
+            return true;
+        INFO << "    " << kPhaseNames[mPhase] << ": settled after " << mPhaseFrames << " updates"
+             << endl;
+        checkPhase();
+        mStreamer->printReport();
+
+        // A quarter of every copy's full chain, which is less than the spread out copies ask for
+        if (mPhase == PHASE_NEAR)
+        {
+            mBudget = statistics.requestedBytes / 4;
+            INFO << "    Budget for the last phase: " << mBudget << " bytes" << endl;
+        }
+        if (mPhase == PHASE_FAR)
+            mStreamer->setBudget(mBudget);
+
+        mPhase = (Phase)(mPhase + 1);
+        mPhaseFrames = 0;
+        mPhaseStatistics = statistics;
+        return mPhase != PHASE_COUNT;
+    }
+
+private:
+    TextureStreamer* mStreamer;
+    vector<Texture*> mTextures;
+    uint mTailLevel;
+    Phase mPhase;
+    uint mPhaseFrames;
+    TextureStreamerStatistics mPhaseStatistics; // As the phase started
+    uint64 mBudget;
+
+    // Close enough for the finest level when near, otherwise doubling with each copy
+    float getDistance(uint copy) const
+    {
+        return mPhase == PHASE_NEAR ? 0.01f : 0.1f * (float)(1 << copy);
+    }
+
+    // GL must hold exactly the levels from the resident level down, and sample from there
+    void checkLevels()
+    {
+        for (uint i = 0; i < kCopyCount; i++)
+        {
+            Texture* texture = mTextures[i];
+            uint resident = mStreamer->getResidentLevel(texture);
+            EXPECT(resident >= mStreamer->getTargetLevel(texture));
+            EXPECT(texture->getBaseLevel() == resident);
+
+            texture->bind(0);
+            bool levelsMatch = true;
+            for (uint level = 0; level < texture->getLevelCount(); level++)
+            {
+                GLint width = 0;
+                glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+                GLint expected =
+                    level < resident ? 0 : glm::max(texture->getWidth() >> level, 1u);
+                levelsMatch = levelsMatch && width == expected;
+            }
+            EXPECT(levelsMatch);
+        }
+
+        // Anything over budget is evicted before uploading, so the target is never exceeded
+        const TextureStreamerStatistics& statistics = mStreamer->getStatistics();
+        EXPECT(statistics.residentBytes <= statistics.targetBytes);
+        EXPECT(glGetError() == GL_NO_ERROR);
+    }
+
+    void checkPhase()
+    {
+        const TextureStreamerStatistics& statistics = mStreamer->getStatistics();
+        EXPECT(statistics.pendingLevels == 0);
+        switch (mPhase)
+        {
+        case PHASE_NEAR:
+            for (uint i = 0; i < kCopyCount; i++)
+                EXPECT(mStreamer->getResidentLevel(mTextures[i]) == 0);
+            EXPECT(statistics.targetBytes == statistics.requestedBytes);
+            EXPECT(statistics.uploadedBytes > mPhaseStatistics.uploadedBytes);
+            break;
+
+        case PHASE_FAR:
+            for (uint i = 0; i < kCopyCount; i++)
+                EXPECT(mStreamer->getResidentLevel(mTextures[i]) == mTailLevel);
+            EXPECT(statistics.evictedBytes - mPhaseStatistics.evictedBytes ==
+                   mPhaseStatistics.residentBytes - statistics.residentBytes);
+            break;
+
+        default:
+            // Levels are uploaded again, but only as far as the budget allows, farthest copy
+            // coarsest
+            EXPECT(statistics.uploadedBytes > mPhaseStatistics.uploadedBytes);
+            EXPECT(statistics.targetBytes < statistics.requestedBytes);
+            EXPECT(statistics.targetBytes <= mBudget);
+            EXPECT(statistics.residentBytes == statistics.targetBytes);
+            for (uint i = 1; i < kCopyCount; i++)
+            {
+                EXPECT(mStreamer->getTargetLevel(mTextures[i]) >=
+                       mStreamer->getTargetLevel(mTextures[i - 1]));
+            }
+            break;
+        }
+    }
+};
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        cerr << "Usage: " << argv[0] << " <texture>" << endl;
+        return 1;
+    }
+    gFilename = argv[1];
+    if (TextureStreamerChecks().run("TextureStreamerChecks", WIDTH, HEIGHT) != 0)
+        return 1;
+    if (gFailureCount > 0)
+    {
+        ERROR << gFailureCount << " of " << gCheckCount << " checks failed" << endl;
+        return 1;
+    }
+    INFO << "All " << gCheckCount << " checks passed" << endl;
+    return 0;
+}
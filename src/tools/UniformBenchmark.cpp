@@ -0,0 +1,91 @@
+/*
+ * Uniform Benchmark
+ * Copyright (c) David Avedissian 2014-2015
+ *
+ * Times the ways of setting a uniform, from a driver lookup by string every call to a handle
+ * resolved once. Opens a small window for the GL context and exits once the timings have been
+ * logged. Build in release, as debug builds compare names on every cached lookup.
+ *
+ * Usage: UniformBenchmark [iterations]
+ */
+#define SDL_MAIN_HANDLED
+
+#include "framework/Common.h"
+#include "framework/Application.h"
+#include "framework/Shader.h"
+
+#include <cstdlib>
+
+#define WIDTH 256
+#define HEIGHT 256
+
+uint gIterations = 1000000;
+
+class UniformBenchmark : public Application
+{
+public:
+    virtual void startup() override
+    {
+        Shader shader("media/sample.vs", "media/sample.fs",
+                      ShaderDefines().set("QUANTISED_VERTICES"));
+        shader.bind();
+        GLint program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        INFO << "Setting a vec3 uniform " << gIterations << " times" << endl;
+
+        // What Shader::setUniform used to do: build a string and ask the driver every call
+        uint64 startTime = SDL_GetPerformanceCounter();
+        for (uint i = 0; i < gIterations; i++)
+        {
+            string name("positionScale");
+            glUniform3fv(glGetUniformLocation(program, name.c_str()), 1,
+                         glm::value_ptr(glm::vec3((float)i)));
+        }
+        report("glGetUniformLocation", startTime);
+
+        startTime = SDL_GetPerformanceCounter();
+        for (uint i = 0; i < gIterations; i++)
+            shader.setUniform(UniformName(string("positionScale")), glm::vec3((float)i));
+        report("Name hashed at run time", startTime);
+
+        startTime = SDL_GetPerformanceCounter();
+        for (uint i = 0; i < gIterations; i++)
+            shader.setUniform("positionScale", glm::vec3((float)i));
+        report("String literal", startTime);
+
+        startTime = SDL_GetPerformanceCounter();
+        for (uint i = 0; i < gIterations; i++)
+            shader.setUniform(UNIFORM_NAME("positionScale"), glm::vec3((float)i));
+        report("UNIFORM_NAME", startTime);
+
+        UniformHandle<glm::vec3> handle = shader.getUniform<glm::vec3>("positionScale");
+        startTime = SDL_GetPerformanceCounter();
+        for (uint i = 0; i < gIterations; i++)
+            shader.setUniform(handle, glm::vec3((float)i));
+        report("UniformHandle", startTime);
+    }
+
+    virtual void shutdown() override
+    {
+    }
+
+    virtual bool render() override
+    {
+        return false;
+    }
+
+private:
+    void report(const string& method, uint64 startTime)
+    {
+        float seconds =
+            (float)(SDL_GetPerformanceCounter() - startTime) / SDL_GetPerformanceFrequency();
+        INFO << "    " << method << ": " << seconds * 1e9f / gIterations << "ns per call" << endl;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    if (argc > 1)
+        gIterations = glm::max(atoi(argv[1]), 1);
+    return UniformBenchmark().run("UniformBenchmark", WIDTH, HEIGHT);
+}